@@ -0,0 +1,122 @@
+#ifndef KNOWHERE_KERNEL_BENCH_UTIL_H_
+#define KNOWHERE_KERNEL_BENCH_UTIL_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "graph_types.h"
+
+namespace knowhere_bench {
+
+using knowhere_demo::GraphNode;
+using knowhere_demo::NodeId;
+
+inline std::vector<float> RandomEmbedding(std::mt19937* rng, const std::size_t dim) {
+    std::uniform_real_distribution<float> dist(0.0F, 1.0F);
+    std::vector<float> vec(dim, 0.0F);
+    for (float& value : vec) {
+        value = dist(*rng);
+    }
+    return vec;
+}
+
+inline std::vector<GraphNode> BuildRandomGraph(
+    const std::size_t n,
+    const std::size_t dim,
+    const std::size_t degree,
+    const std::uint32_t seed = 42) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<std::uint32_t> id_dist(0, static_cast<std::uint32_t>(n - 1));
+
+    std::vector<GraphNode> graph;
+    graph.reserve(n);
+    for (NodeId id = 0; id < n; ++id) {
+        std::vector<NodeId> neighbors;
+        neighbors.reserve(degree);
+        while (neighbors.size() < degree) {
+            const NodeId next = id_dist(rng);
+            if (next != id) {
+                neighbors.push_back(next);
+            }
+        }
+        graph.push_back(GraphNode{
+            .id = id,
+            .embedding = RandomEmbedding(&rng, dim),
+            .neighbors = std::move(neighbors),
+        });
+    }
+    return graph;
+}
+
+// Row-major `count` x `dim` Gaussian blobs around `clusters` uniform centers,
+// closer to real embedding distributions than uniform noise.
+inline std::vector<float> ClusteredVectors(
+    std::mt19937* rng,
+    const std::size_t count,
+    const std::size_t dim,
+    const std::size_t clusters,
+    const float spread) {
+    std::vector<std::vector<float>> centers;
+    for (std::size_t c = 0; c < clusters; ++c) {
+        centers.push_back(RandomEmbedding(rng, dim));
+    }
+    std::uniform_int_distribution<std::size_t> pick(0, clusters - 1);
+    std::normal_distribution<float> noise(0.0F, spread);
+    std::vector<float> vectors;
+    vectors.reserve(count * dim);
+    for (std::size_t row = 0; row < count; ++row) {
+        const std::vector<float>& center = centers[pick(*rng)];
+        for (std::size_t d = 0; d < dim; ++d) {
+            vectors.push_back(center[d] + noise(*rng));
+        }
+    }
+    return vectors;
+}
+
+inline float SquaredL2(const std::vector<float>& lhs, const std::vector<float>& rhs) {
+    float sum = 0.0F;
+    for (std::size_t idx = 0; idx < lhs.size(); ++idx) {
+        const float diff = lhs[idx] - rhs[idx];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+inline double Recall(const std::vector<knowhere_demo::Candidate>& result, const std::vector<knowhere_demo::Candidate>& truth) {
+    if (truth.empty()) {
+        return 1.0;
+    }
+    std::size_t hits = 0;
+    for (const auto& candidate : result) {
+        for (const auto& expected : truth) {
+            if (expected.id == candidate.id) {
+                ++hits;
+                break;
+            }
+        }
+    }
+    return static_cast<double>(hits) / static_cast<double>(truth.size());
+}
+
+inline std::uint64_t Percentile(std::vector<std::uint64_t> values, const double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    const std::size_t idx = static_cast<std::size_t>((values.size() - 1) * p);
+    return values[idx];
+}
+
+inline std::uint64_t ElapsedUs(const std::chrono::steady_clock::time_point start) {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+}  // namespace knowhere_bench
+
+#endif  // KNOWHERE_KERNEL_BENCH_UTIL_H_
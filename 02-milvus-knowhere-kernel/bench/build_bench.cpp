@@ -0,0 +1,71 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "async_graph_searcher.h"
+#include "bench_util.h"
+#include "vamana_builder.h"
+
+// Vamana build time and recall@10 (best-first from the medoid vs brute force)
+// for several builder thread counts. Usage: knowhere_build_bench [threads...]
+int main(int argc, char** argv) {
+    using knowhere_demo::AsyncGraphSearcher;
+    using knowhere_demo::SearchParams;
+    using knowhere_demo::SearchRequest;
+    using knowhere_demo::SearchStats;
+    using knowhere_demo::VamanaBuilder;
+
+    constexpr std::size_t kNodeCount = 10000;
+    constexpr std::size_t kDim = 64;
+    constexpr std::size_t kQueries = 100;
+
+    std::vector<std::size_t> thread_counts = {1, 2, 4, 8};
+    if (argc > 1) {
+        thread_counts.clear();
+        for (int arg = 1; arg < argc; ++arg) {
+            thread_counts.push_back(static_cast<std::size_t>(std::strtoul(argv[arg], nullptr, 10)));
+        }
+    }
+
+    std::mt19937 rng(42);
+    std::vector<float> vectors;
+    vectors.reserve(kNodeCount * kDim);
+    for (std::size_t id = 0; id < kNodeCount; ++id) {
+        const auto row = knowhere_bench::RandomEmbedding(&rng, kDim);
+        vectors.insert(vectors.end(), row.begin(), row.end());
+    }
+    std::vector<SearchRequest> requests(kQueries);
+    for (SearchRequest& request : requests) {
+        request.query = knowhere_bench::RandomEmbedding(&rng, kDim);
+        request.top_k = 10;
+    }
+
+    std::cout << "threads,build_ms,avg_degree,medoid,recall@10,visited\n";
+    for (const std::size_t threads : thread_counts) {
+        const VamanaBuilder builder({.max_degree = 32, .build_list_size = 64, .alpha = 1.2F, .num_threads = threads});
+        const auto start = std::chrono::steady_clock::now();
+        auto index = builder.Build(vectors.data(), kNodeCount, kDim);
+        const std::uint64_t build_us = knowhere_bench::ElapsedUs(start);
+
+        const double avg_degree = static_cast<double>(index.graph.EdgeCount()) / static_cast<double>(kNodeCount);
+        const knowhere_demo::NodeId medoid = index.medoid;
+        const AsyncGraphSearcher searcher(std::move(index.graph));
+        double recall = 0.0;
+        std::size_t visited = 0;
+        for (const SearchRequest& request : requests) {
+            SearchStats stats;
+            const auto result =
+                searcher.SearchBestFirst(request, medoid, SearchParams{.max_visit = 2000, .batch_size = 8, .ef = 64}, &stats);
+            recall += knowhere_bench::Recall(result, searcher.SearchFilteredBruteForce(request));
+            visited += stats.visited;
+        }
+        std::cout << threads << "," << build_us / 1000 << "," << std::fixed << std::setprecision(2) << avg_degree << ","
+                  << medoid << "," << std::setprecision(3) << recall / kQueries << "," << visited / kQueries << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "async_graph_searcher.h"
+#include "bench_util.h"
+#include "flat_graph.h"
+
+namespace {
+
+// Flushes the file and asks the kernel to drop its cached pages so the next
+// mapping starts cold.
+void EvictPageCache(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    ::fsync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+}
+
+}  // namespace
+
+// Cold start of a saved graph: rebuilding the FlatGraph from nodes vs mapping
+// the file with each warm-up mode, and the latency of the first queries served
+// from the fresh mapping. Usage: knowhere_cold_start_bench [nodes] [path]
+int main(int argc, char** argv) {
+    using knowhere_demo::AsyncGraphSearcher;
+    using knowhere_demo::FlatGraph;
+    using knowhere_demo::MapOptions;
+    using knowhere_demo::MapWarmup;
+    using knowhere_demo::SearchParams;
+    using knowhere_demo::SearchRequest;
+
+    const std::size_t node_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    const std::string path = argc > 2 ? argv[2] : "knowhere_graph.bin";
+    constexpr std::size_t kDim = 128;
+    constexpr std::size_t kDegree = 32;
+    constexpr std::size_t kFirstQueries = 10;
+    constexpr std::size_t kWarmQueries = 100;
+
+    const auto nodes = knowhere_bench::BuildRandomGraph(node_count, kDim, kDegree);
+    auto start = std::chrono::steady_clock::now();
+    const FlatGraph heap_graph = FlatGraph::FromNodes(nodes);
+    const std::uint64_t rebuild_us = knowhere_bench::ElapsedUs(start);
+    start = std::chrono::steady_clock::now();
+    heap_graph.Save(path);
+    const std::uint64_t save_us = knowhere_bench::ElapsedUs(start);
+    std::cout << "nodes=" << node_count << " file_mb=" << heap_graph.MemoryBytes() / (1024 * 1024)
+              << " from_nodes_ms=" << rebuild_us / 1000 << " save_ms=" << save_us / 1000 << "\n";
+
+    std::mt19937 rng(5);
+    std::vector<SearchRequest> requests(kFirstQueries + kWarmQueries);
+    for (SearchRequest& request : requests) {
+        request.query = knowhere_bench::RandomEmbedding(&rng, kDim);
+    }
+    const SearchParams params{.max_visit = 700, .batch_size = 8, .ef = 64};
+
+    std::cout << "warmup,map_us,first_query_us,first10_avg_us,warm_p50_us,checksum_ok\n";
+    const std::pair<const char*, MapWarmup> modes[] = {
+        {"none", MapWarmup::kNone},
+        {"willneed", MapWarmup::kWillNeed},
+        {"populate", MapWarmup::kPopulate},
+    };
+    for (const auto& [name, warmup] : modes) {
+        EvictPageCache(path);
+        start = std::chrono::steady_clock::now();
+        const AsyncGraphSearcher searcher(FlatGraph::Map(path, MapOptions{.warmup = warmup}));
+        const std::uint64_t map_us = knowhere_bench::ElapsedUs(start);
+
+        std::vector<std::uint64_t> latency;
+        for (const SearchRequest& request : requests) {
+            const auto query_start = std::chrono::steady_clock::now();
+            const auto result = searcher.Search(request, params);
+            latency.push_back(knowhere_bench::ElapsedUs(query_start));
+            (void)result;
+        }
+        std::uint64_t first_sum = 0;
+        for (std::size_t q = 0; q < kFirstQueries; ++q) {
+            first_sum += latency[q];
+        }
+        const std::vector<std::uint64_t> warm(latency.begin() + kFirstQueries, latency.end());
+
+        bool checksum_ok = true;
+        try {
+            (void)FlatGraph::Map(path, MapOptions{.verify_checksum = true});
+        } catch (const std::runtime_error&) {
+            checksum_ok = false;
+        }
+        std::cout << name << "," << map_us << "," << latency.front() << "," << first_sum / kFirstQueries << ","
+                  << knowhere_bench::Percentile(warm, 0.5) << "," << (checksum_ok ? "yes" : "no") << "\n";
+    }
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "async_graph_searcher.h"
+#include "bench_util.h"
+#include "work_stealing_executor.h"
+
+// QPS of SearchOptimized under 1/8/32 concurrent callers sharing one searcher,
+// for a few executor sizes. Usage: knowhere_concurrency_bench [workers...]
+int main(int argc, char** argv) {
+    using knowhere_demo::AsyncGraphSearcher;
+    using knowhere_demo::ExecutorOptions;
+    using knowhere_demo::SearchRequest;
+    using knowhere_demo::WorkStealingExecutor;
+
+    constexpr std::size_t kNodeCount = 5000;
+    constexpr std::size_t kDim = 128;
+    constexpr std::size_t kDegree = 16;
+    constexpr std::size_t kQueriesPerCaller = 8;
+    constexpr std::size_t kMaxVisit = 700;
+    constexpr std::size_t kBatchSize = 64;
+
+    std::vector<std::size_t> worker_counts = {2, 8, 32};
+    if (argc > 1) {
+        worker_counts.clear();
+        for (int arg = 1; arg < argc; ++arg) {
+            worker_counts.push_back(static_cast<std::size_t>(std::strtoul(argv[arg], nullptr, 10)));
+        }
+    }
+    const std::vector<std::size_t> caller_counts = {1, 8, 32};
+
+    const auto nodes = knowhere_bench::BuildRandomGraph(kNodeCount, kDim, kDegree);
+    const auto flat = knowhere_demo::FlatGraph::FromNodes(nodes);
+
+    SearchRequest request;
+    request.query = std::vector<float>(kDim, 0.45F);
+    request.top_k = 10;
+
+    std::cout << "workers,callers,queries,wall_ms,qps,p50_us,p95_us,p99_us\n";
+    for (const std::size_t workers : worker_counts) {
+        auto executor = std::make_shared<WorkStealingExecutor>(ExecutorOptions{.num_workers = workers});
+        const AsyncGraphSearcher searcher(flat, executor);
+
+        for (const std::size_t callers : caller_counts) {
+            std::vector<std::vector<std::uint64_t>> latency(callers);
+            const auto wall_start = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            threads.reserve(callers);
+            for (std::size_t caller = 0; caller < callers; ++caller) {
+                threads.emplace_back([&, caller] {
+                    for (std::size_t q = 0; q < kQueriesPerCaller; ++q) {
+                        const auto start = std::chrono::steady_clock::now();
+                        const auto entry = static_cast<knowhere_demo::NodeId>((caller * kQueriesPerCaller + q) % 100);
+                        auto result = searcher.SearchOptimized(request, entry, kMaxVisit, kBatchSize);
+                        (void)result;
+                        latency[caller].push_back(knowhere_bench::ElapsedUs(start));
+                    }
+                });
+            }
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+            const std::uint64_t wall_us = knowhere_bench::ElapsedUs(wall_start);
+
+            std::vector<std::uint64_t> all;
+            for (const auto& per_caller : latency) {
+                all.insert(all.end(), per_caller.begin(), per_caller.end());
+            }
+            const double qps = wall_us > 0 ? static_cast<double>(all.size()) * 1e6 / static_cast<double>(wall_us) : 0.0;
+            std::cout << workers << "," << callers << "," << all.size() << "," << wall_us / 1000 << ","
+                      << std::fixed << std::setprecision(1) << qps << "," << knowhere_bench::Percentile(all, 0.5)
+                      << "," << knowhere_bench::Percentile(all, 0.95) << ","
+                      << knowhere_bench::Percentile(all, 0.99) << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "async_graph_searcher.h"
+#include "bench_util.h"
+#include "entry_point_selector.h"
+#include "vamana_builder.h"
+
+// Nodes scored to reach a target recall@10 when best-first search starts from
+// a fixed node, the medoid, an HNSW-style upper-layer descent or the nearest
+// k-means centroid. Entry-selection distance evaluations count toward the cost.
+int main() {
+    using knowhere_demo::AsyncGraphSearcher;
+    using knowhere_demo::EntryPointMode;
+    using knowhere_demo::EntryPointOptions;
+    using knowhere_demo::SearchParams;
+    using knowhere_demo::SearchRequest;
+    using knowhere_demo::SearchStats;
+
+    constexpr std::size_t kNodeCount = 20000;
+    constexpr std::size_t kDim = 32;
+    constexpr std::size_t kQueries = 200;
+    const std::vector<std::size_t> ef_values = {10, 16, 24, 32, 48, 64, 96, 128, 192, 256};
+    const std::vector<double> targets = {0.90, 0.95};
+
+    std::mt19937 rng(42);
+    const std::vector<float> rows =
+        knowhere_bench::ClusteredVectors(&rng, kNodeCount + kQueries, kDim, /*clusters=*/100, /*spread=*/0.05F);
+    auto index = knowhere_demo::VamanaBuilder({.max_degree = 24, .build_list_size = 48}).Build(rows.data(), kNodeCount, kDim);
+    AsyncGraphSearcher searcher(std::move(index.graph));
+
+    std::vector<SearchRequest> requests(kQueries);
+    std::vector<std::vector<knowhere_demo::Candidate>> truth;
+    for (std::size_t q = 0; q < kQueries; ++q) {
+        const float* row = rows.data() + (kNodeCount + q) * kDim;
+        requests[q].query.assign(row, row + kDim);
+        requests[q].top_k = 10;
+        truth.push_back(searcher.SearchFilteredBruteForce(requests[q]));
+    }
+
+    struct Config {
+        std::string name;
+        bool fixed;
+        EntryPointMode mode;
+    };
+    const std::vector<Config> configs = {
+        {"fixed_node0", true, EntryPointMode::kMedoid},
+        {"medoid", false, EntryPointMode::kMedoid},
+        {"hierarchy", false, EntryPointMode::kHierarchy},
+        {"centroids", false, EntryPointMode::kCentroids},
+    };
+
+    std::cout << "entry,ef,recall@10,visited,entry_evals\n";
+    std::vector<std::vector<double>> best_cost(configs.size(), std::vector<double>(targets.size(), -1.0));
+    for (std::size_t c = 0; c < configs.size(); ++c) {
+        searcher.BuildEntryPoints(EntryPointOptions{.mode = configs[c].mode});
+        for (const std::size_t ef : ef_values) {
+            const SearchParams params{.max_visit = std::numeric_limits<std::size_t>::max(), .batch_size = 1, .ef = ef};
+            double recall = 0.0;
+            std::size_t visited = 0;
+            std::size_t entry_evals = 0;
+            for (std::size_t q = 0; q < kQueries; ++q) {
+                SearchStats stats;
+                const auto result = configs[c].fixed ? searcher.Search(requests[q], /*entrypoint=*/0, params, &stats)
+                                                     : searcher.Search(requests[q], params, &stats);
+                recall += knowhere_bench::Recall(result, truth[q]);
+                visited += stats.visited;
+                entry_evals += stats.entry_evaluations;
+            }
+            recall /= kQueries;
+            const double cost = static_cast<double>(visited + entry_evals) / kQueries;
+            for (std::size_t t = 0; t < targets.size(); ++t) {
+                if (recall >= targets[t] && best_cost[c][t] < 0.0) {
+                    best_cost[c][t] = cost;
+                }
+            }
+            std::cout << configs[c].name << "," << ef << "," << std::fixed << std::setprecision(3) << recall << ","
+                      << visited / kQueries << "," << entry_evals / kQueries << "\n";
+        }
+    }
+
+    std::cout << "\ntarget_recall,entry,nodes_scored,vs_fixed\n";
+    for (std::size_t t = 0; t < targets.size(); ++t) {
+        for (std::size_t c = 0; c < configs.size(); ++c) {
+            std::cout << std::setprecision(2) << targets[t] << "," << configs[c].name << ",";
+            if (best_cost[c][t] < 0.0) {
+                std::cout << "unreached,-\n";
+                continue;
+            }
+            std::cout << std::setprecision(0) << best_cost[c][t] << ",";
+            if (best_cost[0][t] > 0.0) {
+                std::cout << std::setprecision(2) << best_cost[c][t] / best_cost[0][t] << "x\n";
+            } else {
+                std::cout << "-\n";
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "async_graph_searcher.h"
+#include "bench_util.h"
+#include "filter_bitmap.h"
+#include "vamana_builder.h"
+
+// Recall and latency of filtered search at 1%, 10% and 90% pass rates for the
+// graph, brute-force and selectivity-adaptive strategies.
+int main() {
+    using knowhere_demo::AsyncGraphSearcher;
+    using knowhere_demo::FilterBitmap;
+    using knowhere_demo::FilterStrategy;
+    using knowhere_demo::SearchParams;
+    using knowhere_demo::SearchRequest;
+    using knowhere_demo::SearchStats;
+
+    constexpr std::size_t kNodeCount = 5000;
+    constexpr std::size_t kDim = 128;
+    constexpr std::size_t kQueries = 20;
+
+    std::mt19937 data_rng(42);
+    std::vector<std::vector<float>> vectors;
+    for (std::size_t id = 0; id < kNodeCount; ++id) {
+        vectors.push_back(knowhere_bench::RandomEmbedding(&data_rng, kDim));
+    }
+    auto index = knowhere_demo::VamanaBuilder({.max_degree = 16, .build_list_size = 48}).Build(vectors);
+    const knowhere_demo::NodeId entrypoint = index.medoid;
+    const AsyncGraphSearcher searcher(std::move(index.graph));
+
+    std::mt19937 rng(3);
+    std::vector<std::vector<float>> queries;
+    for (std::size_t q = 0; q < kQueries; ++q) {
+        queries.push_back(knowhere_bench::RandomEmbedding(&rng, kDim));
+    }
+
+    std::cout << "pass_rate,encoding,bitmap_bytes,byte_per_node_bytes,strategy,recall,visited,p50_us,p95_us\n";
+    for (const double pass_rate : {0.01, 0.10, 0.90}) {
+        std::bernoulli_distribution keep(pass_rate);
+        std::vector<std::uint32_t> ids;
+        for (std::uint32_t id = 0; id < kNodeCount; ++id) {
+            if (keep(rng)) {
+                ids.push_back(id);
+            }
+        }
+        const FilterBitmap filter = FilterBitmap::FromIds(kNodeCount, ids);
+
+        std::vector<SearchRequest> requests;
+        std::vector<std::vector<knowhere_demo::Candidate>> truth;
+        for (const auto& query : queries) {
+            SearchRequest request;
+            request.query = query;
+            request.top_k = 10;
+            request.filter_bitmap = filter;
+            truth.push_back(searcher.SearchFilteredBruteForce(request));
+            requests.push_back(std::move(request));
+        }
+
+        const std::pair<const char*, FilterStrategy> strategies[] = {
+            {"graph", FilterStrategy::kGraph},
+            {"brute_force", FilterStrategy::kBruteForce},
+            {"auto", FilterStrategy::kAuto},
+        };
+        for (const auto& [name, strategy] : strategies) {
+            const SearchParams params{.max_visit = 700, .batch_size = 8, .ef = 128, .filter_strategy = strategy};
+            std::vector<std::uint64_t> latency;
+            double recall = 0.0;
+            std::size_t visited = 0;
+            for (std::size_t q = 0; q < kQueries; ++q) {
+                SearchStats stats;
+                const auto start = std::chrono::steady_clock::now();
+                const auto result = searcher.Search(requests[q], entrypoint, params, &stats);
+                latency.push_back(knowhere_bench::ElapsedUs(start));
+                recall += knowhere_bench::Recall(result, truth[q]);
+                visited += stats.visited;
+            }
+            std::cout << std::fixed << std::setprecision(2) << pass_rate << ","
+                      << (filter.GetEncoding() == FilterBitmap::Encoding::kRoaring ? "roaring" : "packed") << ","
+                      << filter.MemoryBytes() << "," << kNodeCount << "," << name << "," << std::setprecision(3)
+                      << recall / kQueries << "," << visited / kQueries << ","
+                      << knowhere_bench::Percentile(latency, 0.5) << "," << knowhere_bench::Percentile(latency, 0.95)
+                      << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+#ifndef KNOWHERE_KERNEL_PERF_COUNTER_H_
+#define KNOWHERE_KERNEL_PERF_COUNTER_H_
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace knowhere_bench {
+
+// One hardware cache event counted for this process and every thread it
+// creates afterwards. Counts of inherited threads are folded in when those
+// threads exit, so read only after worker pools have been torn down.
+class PerfCounter {
+public:
+    PerfCounter(const std::uint32_t type, const std::uint64_t config) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        error_ = fd_ < 0 ? errno : 0;
+        if (fd_ >= 0) {
+            ::ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    ~PerfCounter() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+
+    static PerfCounter LlcReadMisses() { return {PERF_TYPE_HW_CACHE, LlcReadConfig(PERF_COUNT_HW_CACHE_RESULT_MISS)}; }
+    static PerfCounter LlcReads() { return {PERF_TYPE_HW_CACHE, LlcReadConfig(PERF_COUNT_HW_CACHE_RESULT_ACCESS)}; }
+
+    bool Available() const { return fd_ >= 0; }
+    const char* Error() const { return std::strerror(error_); }
+
+    std::uint64_t Read() const {
+        std::uint64_t value = 0;
+        if (fd_ < 0 || ::read(fd_, &value, sizeof(value)) != static_cast<ssize_t>(sizeof(value))) {
+            return 0;
+        }
+        return value;
+    }
+
+    // Events per `units` (e.g. per visited node), or "n/a" without a PMU.
+    std::string PerUnit(const std::size_t units) const {
+        if (!Available() || units == 0) {
+            return "n/a";
+        }
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2) << static_cast<double>(Read()) / static_cast<double>(units);
+        return out.str();
+    }
+
+private:
+    static constexpr std::uint64_t LlcReadConfig(const std::uint64_t result) {
+        return PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+    }
+
+    int fd_{-1};
+    int error_{0};
+};
+
+}  // namespace knowhere_bench
+
+#endif  // KNOWHERE_KERNEL_PERF_COUNTER_H_
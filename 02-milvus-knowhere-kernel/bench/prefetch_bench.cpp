@@ -0,0 +1,94 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "async_graph_searcher.h"
+#include "bench_util.h"
+#include "perf_counter.h"
+#include "work_stealing_executor.h"
+
+// Software prefetch depth vs memory stalls on a graph larger than the LLC. For
+// each prefetch distance, runs best-first and breadth-first searches and
+// reports time per visited node and LLC read misses per visited node (the
+// counters read "n/a" where the PMU is not exposed, as in most VMs).
+// Usage: knowhere_prefetch_bench [nodes] [queries] [distances...]
+int main(int argc, char** argv) {
+    using knowhere_demo::AsyncGraphSearcher;
+    using knowhere_demo::ExecutorOptions;
+    using knowhere_demo::SearchMode;
+    using knowhere_demo::SearchParams;
+    using knowhere_demo::SearchRequest;
+    using knowhere_demo::SearchStats;
+    using knowhere_demo::WorkStealingExecutor;
+
+    const std::size_t node_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 400000;
+    const std::size_t query_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+    std::vector<std::size_t> distances = {0, 2, 4, 8};
+    if (argc > 3) {
+        distances.clear();
+        for (int arg = 3; arg < argc; ++arg) {
+            distances.push_back(std::strtoul(argv[arg], nullptr, 10));
+        }
+    }
+    constexpr std::size_t kDim = 128;
+    constexpr std::size_t kDegree = 32;
+
+    // Random edges defeat the hardware prefetchers, which is the case software
+    // prefetch is meant for; the graph is sized past the LLC by default.
+    const auto flat = knowhere_demo::FlatGraph::FromNodes(knowhere_bench::BuildRandomGraph(node_count, kDim, kDegree));
+    std::cout << "nodes=" << node_count << " graph_mb=" << flat.MemoryBytes() / (1024 * 1024) << "\n";
+
+    std::mt19937 rng(7);
+    std::vector<SearchRequest> requests(query_count);
+    std::vector<knowhere_demo::NodeId> entries(query_count);
+    std::uniform_int_distribution<knowhere_demo::NodeId> entry_dist(
+        0, static_cast<knowhere_demo::NodeId>(node_count - 1));
+    for (std::size_t q = 0; q < query_count; ++q) {
+        requests[q].query = knowhere_bench::RandomEmbedding(&rng, kDim);
+        entries[q] = entry_dist(rng);
+    }
+
+    {
+        const auto probe = knowhere_bench::PerfCounter::LlcReadMisses();
+        if (!probe.Available()) {
+            std::cerr << "perf_event_open: " << probe.Error() << "; reporting timings only\n";
+        }
+    }
+    std::cout << "mode,prefetch_distance,us_per_query,ns_per_visited,llc_miss_per_visited,llc_load_per_visited\n";
+    for (const SearchMode mode : {SearchMode::kBestFirst, SearchMode::kBreadthFirst}) {
+        for (const std::size_t distance : distances) {
+            const SearchParams params{
+                .max_visit = 2000, .batch_size = 16, .ef = 64, .mode = mode, .prefetch_distance = distance};
+            const auto misses = knowhere_bench::PerfCounter::LlcReadMisses();
+            const auto loads = knowhere_bench::PerfCounter::LlcReads();
+            std::size_t visited = 0;
+            std::uint64_t elapsed_us = 0;
+            {
+                // Workers are created after the counters so they inherit them.
+                auto executor = std::make_shared<WorkStealingExecutor>(ExecutorOptions{.num_workers = 2});
+                const AsyncGraphSearcher searcher(flat, executor);
+                const auto start = std::chrono::steady_clock::now();
+                for (std::size_t q = 0; q < query_count; ++q) {
+                    SearchStats stats;
+                    const auto result = searcher.Search(requests[q], entries[q], params, &stats);
+                    visited += stats.visited;
+                    (void)result;
+                }
+                elapsed_us = knowhere_bench::ElapsedUs(start);
+            }
+            std::cout << (mode == SearchMode::kBestFirst ? "best_first" : "bfs") << "," << distance << ","
+                      << std::fixed << std::setprecision(1) << static_cast<double>(elapsed_us) / query_count << ","
+                      << static_cast<double>(elapsed_us) * 1e3 / static_cast<double>(visited) << ","
+                      << misses.PerUnit(visited) << ","
+                      << loads.PerUnit(visited) << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "async_graph_searcher.h"
+#include "bench_util.h"
+#include "quantized_codes.h"
+#include "vamana_builder.h"
+
+// Recall@10 and latency of best-first search on float embeddings vs
+// navigation on SQ8 / SQ4 / PQ codes with exact rerank, for a few rerank
+// depths. Bytes per node counts the embedding representation traversal reads
+// (adjacency is the same for all). Usage: knowhere_quantized_bench [nodes] [queries]
+int main(int argc, char** argv) {
+    using knowhere_demo::AsyncGraphSearcher;
+    using knowhere_demo::CodeType;
+    using knowhere_demo::QuantizerOptions;
+    using knowhere_demo::SearchParams;
+    using knowhere_demo::SearchRequest;
+    using knowhere_demo::SearchStats;
+
+    const std::size_t node_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50000;
+    const std::size_t query_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+    constexpr std::size_t kDim = 128;
+    constexpr std::size_t kTopK = 10;
+
+    std::mt19937 rng(42);
+    const std::vector<float> rows =
+        knowhere_bench::ClusteredVectors(&rng, node_count + query_count, kDim, /*clusters=*/16, /*spread=*/0.5F);
+    auto index =
+        knowhere_demo::VamanaBuilder({.max_degree = 32, .build_list_size = 64}).Build(rows.data(), node_count, kDim);
+    AsyncGraphSearcher searcher(std::move(index.graph));
+
+    std::vector<SearchRequest> requests(query_count);
+    std::vector<std::vector<knowhere_demo::Candidate>> truth;
+    for (std::size_t q = 0; q < query_count; ++q) {
+        const float* row = rows.data() + (node_count + q) * kDim;
+        requests[q].query.assign(row, row + kDim);
+        requests[q].top_k = kTopK;
+        truth.push_back(searcher.SearchFilteredBruteForce(requests[q]));
+    }
+
+    struct Config {
+        std::string name;
+        bool codes;
+        QuantizerOptions options;
+    };
+    const std::vector<Config> configs = {
+        {"float", false, {}},
+        {"sq8", true, {.type = CodeType::kSq8}},
+        {"sq4", true, {.type = CodeType::kSq4}},
+        {"pq32", true, {.type = CodeType::kPq, .pq_subspaces = 32}},
+        {"pq16", true, {.type = CodeType::kPq, .pq_subspaces = 16}},
+    };
+    const std::size_t float_bytes = searcher.Graph().Stride() * sizeof(float);
+
+    std::cout << "codes,bytes_per_node,compression,encode_ms,rerank_depth,recall@10,p50_us,p95_us,visited\n";
+    for (const Config& config : configs) {
+        std::size_t bytes_per_node = float_bytes;
+        std::uint64_t encode_ms = 0;
+        if (config.codes) {
+            const auto start = std::chrono::steady_clock::now();
+            searcher.BuildCodes(config.options);
+            encode_ms = knowhere_bench::ElapsedUs(start) / 1000;
+            bytes_per_node = searcher.Codes().CodeBytes();
+        }
+        const std::vector<std::size_t> depths = config.codes ? std::vector<std::size_t>{kTopK, 50, 100, 200}
+                                                             : std::vector<std::size_t>{0};
+        for (const std::size_t depth : depths) {
+            const SearchParams params{
+                .max_visit = 4000, .batch_size = 4, .ef = 100, .use_codes = config.codes, .rerank_depth = depth};
+            std::vector<std::uint64_t> latency;
+            double recall = 0.0;
+            std::size_t visited = 0;
+            for (std::size_t q = 0; q < query_count; ++q) {
+                SearchStats stats;
+                const auto start = std::chrono::steady_clock::now();
+                const auto result = searcher.Search(requests[q], params, &stats);
+                latency.push_back(knowhere_bench::ElapsedUs(start));
+                recall += knowhere_bench::Recall(result, truth[q]);
+                visited += stats.visited;
+            }
+            std::cout << config.name << "," << bytes_per_node << "," << std::fixed << std::setprecision(1)
+                      << static_cast<double>(float_bytes) / static_cast<double>(bytes_per_node) << "," << encode_ms
+                      << "," << depth << "," << std::setprecision(3) << recall / static_cast<double>(query_count)
+                      << "," << knowhere_bench::Percentile(latency, 0.5) << ","
+                      << knowhere_bench::Percentile(latency, 0.95) << "," << visited / query_count << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "async_graph_searcher.h"
+#include "bench_util.h"
+#include "graph_reorder.h"
+#include "perf_counter.h"
+#include "vamana_builder.h"
+#include "work_stealing_executor.h"
+
+// Search latency and memory behaviour of a Vamana graph in insertion order vs
+// BFS / RCM / Gorder renumbering. Every query runs unfiltered and with a ~30%
+// filter; results are mapped back to original ids and must match the
+// insertion-order run. Usage: knowhere_reorder_bench [nodes] [queries]
+int main(int argc, char** argv) {
+    using knowhere_demo::AsyncGraphSearcher;
+    using knowhere_demo::Candidate;
+    using knowhere_demo::ExecutorOptions;
+    using knowhere_demo::FilterBitmap;
+    using knowhere_demo::ReorderMethod;
+    using knowhere_demo::SearchParams;
+    using knowhere_demo::SearchRequest;
+    using knowhere_demo::SearchStats;
+    using knowhere_demo::WorkStealingExecutor;
+
+    const std::size_t node_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    const std::size_t query_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 500;
+    constexpr std::size_t kDim = 128;
+
+    // Cluster membership is random in id order, like rows appended over time.
+    std::mt19937 rng(42);
+    const std::vector<float> rows =
+        knowhere_bench::ClusteredVectors(&rng, node_count + query_count, kDim, /*clusters=*/512, /*spread=*/0.05F);
+    auto start = std::chrono::steady_clock::now();
+    const auto index =
+        knowhere_demo::VamanaBuilder({.max_degree = 32, .build_list_size = 64}).Build(rows.data(), node_count, kDim);
+    std::cout << "nodes=" << node_count << " graph_mb=" << index.graph.MemoryBytes() / (1024 * 1024)
+              << " build_s=" << knowhere_bench::ElapsedUs(start) / 1000000 << "\n";
+
+    std::vector<std::uint32_t> passing;
+    std::bernoulli_distribution keep(0.3);
+    for (std::uint32_t id = 0; id < node_count; ++id) {
+        if (keep(rng)) {
+            passing.push_back(id);
+        }
+    }
+    const FilterBitmap filter = FilterBitmap::FromIds(node_count, passing);
+    std::vector<SearchRequest> requests(2 * query_count);
+    for (std::size_t q = 0; q < query_count; ++q) {
+        const float* row = rows.data() + (node_count + q) * kDim;
+        requests[2 * q].query.assign(row, row + kDim);
+        requests[2 * q + 1].query = requests[2 * q].query;
+        requests[2 * q + 1].filter_bitmap = filter;
+    }
+    const SearchParams params{.max_visit = 1000, .batch_size = 8, .ef = 64, .filter_strategy = knowhere_demo::FilterStrategy::kGraph};
+
+    struct Config {
+        const char* name;
+        bool reorder;
+        ReorderMethod method;
+    };
+    const Config configs[] = {
+        {"insertion", false, ReorderMethod::kBfs},
+        {"bfs", true, ReorderMethod::kBfs},
+        {"rcm", true, ReorderMethod::kRcm},
+        {"gorder", true, ReorderMethod::kGorder},
+    };
+
+    {
+        const auto probe = knowhere_bench::PerfCounter::LlcReadMisses();
+        if (!probe.Available()) {
+            std::cerr << "perf_event_open: " << probe.Error() << "; reporting timings only\n";
+        }
+    }
+    std::cout << "order,reorder_ms,avg_edge_gap,p50_us,p95_us,ns_per_visited,llc_miss_per_visited,same_results\n";
+    std::vector<std::vector<Candidate>> reference;
+    for (const Config& config : configs) {
+        start = std::chrono::steady_clock::now();
+        knowhere_demo::ReorderedGraph reordered{index.graph, {}};
+        if (config.reorder) {
+            reordered = knowhere_demo::ReorderGraph(index.graph, {.method = config.method, .root = index.medoid});
+        }
+        const std::uint64_t reorder_ms = knowhere_bench::ElapsedUs(start) / 1000;
+        const knowhere_demo::IdMap& ids = reordered.ids;
+
+        std::vector<SearchRequest> mapped = requests;
+        for (SearchRequest& request : mapped) {
+            request.filter_bitmap = ids.ToReordered(request.filter_bitmap);
+        }
+        const knowhere_demo::NodeId entry = ids.ToReordered(index.medoid);
+
+        const auto misses = knowhere_bench::PerfCounter::LlcReadMisses();
+        std::vector<std::uint64_t> latency;
+        std::vector<std::vector<Candidate>> results;
+        std::size_t visited = 0;
+        std::uint64_t total_us = 0;
+        {
+            auto executor = std::make_shared<WorkStealingExecutor>(ExecutorOptions{.num_workers = 1});
+            const AsyncGraphSearcher searcher(reordered.graph, executor);
+            for (const SearchRequest& request : mapped) {
+                SearchStats stats;
+                const auto query_start = std::chrono::steady_clock::now();
+                auto result = searcher.Search(request, entry, params, &stats);
+                latency.push_back(knowhere_bench::ElapsedUs(query_start));
+                total_us += latency.back();
+                visited += stats.visited;
+                ids.ToOriginal(&result);
+                results.push_back(std::move(result));
+            }
+        }
+        if (reference.empty()) {
+            reference = results;
+        }
+        std::size_t same = 0;
+        for (std::size_t q = 0; q < results.size(); ++q) {
+            same += knowhere_bench::Recall(results[q], reference[q]) == 1.0 ? 1 : 0;
+        }
+        std::cout << config.name << "," << reorder_ms << "," << std::fixed << std::setprecision(0)
+                  << knowhere_demo::AverageEdgeGap(reordered.graph) << ","
+                  << knowhere_bench::Percentile(latency, 0.5) << "," << knowhere_bench::Percentile(latency, 0.95)
+                  << "," << std::setprecision(1) << static_cast<double>(total_us) * 1e3 / static_cast<double>(visited)
+                  << "," << misses.PerUnit(visited) << "," << same << "/" << results.size() << "\n";
+    }
+    return 0;
+}
@@ -1,16 +1,45 @@
 #ifndef KNOWHERE_KERNEL_ASYNC_GRAPH_SEARCHER_H_
 #define KNOWHERE_KERNEL_ASYNC_GRAPH_SEARCHER_H_
 
+#include <chrono>
 #include <cstddef>
+#include <memory>
 #include <vector>
 
+#include "entry_point_selector.h"
+#include "flat_graph.h"
 #include "graph_types.h"
+#include "quantized_codes.h"
+#include "span.h"
+#include "work_stealing_executor.h"
 
 namespace knowhere_demo {
 
 class AsyncGraphSearcher {
 public:
-    explicit AsyncGraphSearcher(std::vector<GraphNode> graph);
+    // Without an injected executor the searcher owns a default-sized pool.
+    explicit AsyncGraphSearcher(FlatGraph graph, std::shared_ptr<WorkStealingExecutor> executor = nullptr);
+    // Converts the per-node input into the contiguous FlatGraph layout.
+    explicit AsyncGraphSearcher(
+        const std::vector<GraphNode>& graph,
+        std::shared_ptr<WorkStealingExecutor> executor = nullptr);
+
+    const FlatGraph& Graph() const { return graph_; }
+    WorkStealingExecutor& Executor() const { return *executor_; }
+
+    // Builds the entry-point selector. Until it is called automatic entry is
+    // node 0, so constructing a searcher never scans the embeddings (a mapped
+    // graph stays cold). Must not run concurrently with searches.
+    void BuildEntryPoints(const EntryPointOptions& options = {});
+    const EntryPointSelector& EntryPoints() const { return entry_points_; }
+    // Start node for `query` picked by the entry-point selector.
+    NodeId SelectEntryPoint(const std::vector<float>& query, std::size_t* evaluations = nullptr) const;
+
+    // Encodes every embedding for SearchParams::use_codes. Once built, the
+    // float rows are only read for rerank and entry selection, so they can
+    // stay in a cold file mapping. Must not run concurrently with searches.
+    void BuildCodes(const QuantizerOptions& options = {});
+    const QuantizedCodes& Codes() const { return codes_; }
 
     std::vector<Candidate> SearchBaseline(
         const SearchRequest& request,
@@ -23,8 +52,30 @@ public:
         NodeId entrypoint,
         std::size_t max_visit = 256,
         std::size_t batch_size = 32,
+        SearchStats* stats = nullptr,
+        std::size_t prefetch_distance = kDefaultPrefetchDistance) const;
+
+    // Expands up to `params.batch_size` closest unexpanded candidates per step
+    // and stops once no unexpanded candidate is left inside the ef-best pool.
+    std::vector<Candidate> SearchBestFirst(
+        const SearchRequest& request,
+        NodeId entrypoint,
+        const SearchParams& params,
         SearchStats* stats = nullptr) const;
 
+    // Best-first search over a micro-batch (queries with very selective filters
+    // take the brute-force path, as in Search). Groups of queries run as executor
+    // tasks with per-thread scratch; inside a group, queries advance in
+    // lock-step so a node reached by several queries has its neighbors fetched
+    // once and its embedding scored against all of them together.
+    // `entrypoints` holds one entry per request, a single shared entry, or
+    // nothing to let SelectEntryPoint pick one per request.
+    std::vector<std::vector<Candidate>> SearchBatch(
+        Span<const SearchRequest> requests,
+        Span<const NodeId> entrypoints,
+        const SearchParams& params,
+        std::vector<SearchStats>* stats = nullptr) const;
+
     std::vector<Candidate> Search(
         const SearchRequest& request,
         NodeId entrypoint,
@@ -32,12 +83,51 @@ public:
         std::size_t batch_size = 32,
         SearchStats* stats = nullptr) const;
 
+    // Exact top-k over the ids passing `request.filter_bitmap` (all nodes if
+    // there is no filter).
+    std::vector<Candidate> SearchFilteredBruteForce(const SearchRequest& request, SearchStats* stats = nullptr) const;
+
+    // Picks brute force or graph search from the filter selectivity (see
+    // FilterStrategy), then dispatches graph search on `params.mode`.
+    std::vector<Candidate> Search(
+        const SearchRequest& request,
+        NodeId entrypoint,
+        const SearchParams& params,
+        SearchStats* stats = nullptr) const;
+
+    // Same as above, starting from SelectEntryPoint(request.query).
+    std::vector<Candidate> Search(
+        const SearchRequest& request,
+        const SearchParams& params,
+        SearchStats* stats = nullptr) const;
+
 private:
-    float L2Distance(const std::vector<float>& lhs, const std::vector<float>& rhs) const;
+    void SearchBatchGroup(
+        Span<const SearchRequest> requests,
+        Span<const NodeId> entrypoints,
+        std::size_t begin,
+        std::size_t end,
+        const SearchParams& params,
+        std::chrono::steady_clock::time_point batch_start,
+        std::vector<std::vector<Candidate>>* results,
+        std::vector<SearchStats>* stats) const;
+    bool PreferBruteForce(const SearchRequest& request, const SearchParams& params) const;
+    // Exact distances for `candidates`, sorted and cut to `top_k`.
+    std::vector<Candidate> Rerank(const SearchRequest& request, std::vector<Candidate> candidates) const;
     bool PassFilter(NodeId node_id, const SearchRequest& request) const;
-    std::vector<NodeId> PrefetchNeighbors(NodeId node_id) const;
+    // Squared L2 from `query` to each of `ids`, prefetching `prefetch_distance`
+    // rows ahead.
+    void GatherDistances(
+        const float* query,
+        const NodeId* ids,
+        std::size_t count,
+        std::size_t prefetch_distance,
+        float* out) const;
 
-    std::vector<GraphNode> graph_;
+    FlatGraph graph_;
+    std::shared_ptr<WorkStealingExecutor> executor_;
+    EntryPointSelector entry_points_;
+    QuantizedCodes codes_;
 };
 
 }  // namespace knowhere_demo
@@ -0,0 +1,95 @@
+#ifndef KNOWHERE_KERNEL_CANDIDATE_POOL_H_
+#define KNOWHERE_KERNEL_CANDIDATE_POOL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "graph_types.h"
+
+namespace knowhere_demo {
+
+// Distance-ordered candidate list capped at `capacity` entries, as in the
+// NSG/DiskANN search list. Entries past the cap can never be expanded, which is
+// what bounds best-first search.
+class CandidatePool {
+public:
+    explicit CandidatePool(const std::size_t capacity) { Reset(capacity); }
+
+    void Reset(const std::size_t capacity) {
+        capacity_ = capacity;
+        first_unexpanded_ = 0;
+        entries_.clear();
+        entries_.reserve(capacity + 1);
+    }
+
+    void Insert(const NodeId id, const float distance) {
+        // A zero-capacity pool stays empty (and has no back() to compare to).
+        if (capacity_ == 0) {
+            return;
+        }
+        if (entries_.size() == capacity_ && distance >= entries_.back().distance) {
+            return;
+        }
+        const auto pos = std::upper_bound(
+            entries_.begin(), entries_.end(), distance, [](const float value, const Entry& entry) {
+                return value < entry.distance;
+            });
+        const auto offset = static_cast<std::size_t>(pos - entries_.begin());
+        entries_.insert(pos, Entry{.id = id, .distance = distance, .expanded = false});
+        if (entries_.size() > capacity_) {
+            entries_.pop_back();
+        }
+        first_unexpanded_ = std::min(first_unexpanded_, offset);
+    }
+
+    // Marks up to `limit` closest unexpanded entries as expanded and returns
+    // them (and their distances, if requested).
+    void PopUnexpanded(const std::size_t limit, std::vector<NodeId>* out, std::vector<float>* distances = nullptr) {
+        out->clear();
+        if (distances) {
+            distances->clear();
+        }
+        std::size_t idx = first_unexpanded_;
+        for (; idx < entries_.size() && out->size() < limit; ++idx) {
+            if (!entries_[idx].expanded) {
+                entries_[idx].expanded = true;
+                out->push_back(entries_[idx].id);
+                if (distances) {
+                    distances->push_back(entries_[idx].distance);
+                }
+            }
+        }
+        while (first_unexpanded_ < entries_.size() && entries_[first_unexpanded_].expanded) {
+            ++first_unexpanded_;
+        }
+    }
+
+    // Calls fn(id) for up to `limit` closest unexpanded entries, i.e. what the
+    // next PopUnexpanded would return if nothing were inserted before it.
+    template <typename Fn>
+    void ForEachUnexpanded(const std::size_t limit, Fn&& fn) const {
+        std::size_t seen = 0;
+        for (std::size_t idx = first_unexpanded_; idx < entries_.size() && seen < limit; ++idx) {
+            if (!entries_[idx].expanded) {
+                fn(entries_[idx].id);
+                ++seen;
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        NodeId id{};
+        float distance{0.0F};
+        bool expanded{false};
+    };
+
+    std::size_t capacity_{0};
+    std::size_t first_unexpanded_{0};
+    std::vector<Entry> entries_;
+};
+
+}  // namespace knowhere_demo
+
+#endif  // KNOWHERE_KERNEL_CANDIDATE_POOL_H_
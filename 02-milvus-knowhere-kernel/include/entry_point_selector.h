@@ -0,0 +1,70 @@
+#ifndef KNOWHERE_KERNEL_ENTRY_POINT_SELECTOR_H_
+#define KNOWHERE_KERNEL_ENTRY_POINT_SELECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "flat_graph.h"
+#include "graph_types.h"
+
+namespace knowhere_demo {
+
+enum class EntryPointMode {
+    // Always the dataset medoid.
+    kMedoid,
+    // HNSW-style sparse upper layers descended greedily.
+    kHierarchy,
+    // Entry node of the nearest k-means centroid.
+    kCentroids,
+};
+
+struct EntryPointOptions {
+    EntryPointMode mode{EntryPointMode::kHierarchy};
+    // kHierarchy: each layer keeps a random 1/level_fanout of the one below
+    // (the HNSW level distribution with mL = 1 / ln(level_fanout)).
+    std::size_t level_fanout{16};
+    // kHierarchy: out-degree of the upper-layer graphs.
+    std::size_t layer_degree{16};
+    // kCentroids: number of clusters and Lloyd iterations.
+    std::size_t num_centroids{64};
+    std::size_t kmeans_iterations{10};
+    std::uint32_t seed{42};
+};
+
+// Picks a per-query start node for base-graph search so max_visit is spent
+// near the query instead of walking toward it from a fixed node.
+class EntryPointSelector {
+public:
+    EntryPointSelector() = default;
+
+    static EntryPointSelector Build(const FlatGraph& graph, const EntryPointOptions& options = {});
+
+    EntryPointMode Mode() const { return mode_; }
+    NodeId Medoid() const { return medoid_; }
+    // Number of upper layers (kHierarchy) or centroids (kCentroids).
+    std::size_t Levels() const { return layers_.size(); }
+    std::size_t Centroids() const { return centroid_entries_.size(); }
+
+    // Entry node for `query` (dim floats). `evaluations`, if set, receives the
+    // number of distance computations spent choosing it.
+    NodeId Select(const float* query, std::size_t* evaluations = nullptr) const;
+
+    std::size_t MemoryBytes() const;
+
+private:
+    EntryPointMode mode_{EntryPointMode::kMedoid};
+    std::size_t dim_{0};
+    NodeId medoid_{0};
+    // Base ids ordered so that layer l (1-based) holds the first
+    // layers_[l - 1].Size() of them; a node keeps its local id in every layer.
+    std::vector<NodeId> members_;
+    std::vector<FlatGraph> layers_;
+    NodeId top_entry_{0};
+    std::vector<float> centroids_;
+    std::vector<NodeId> centroid_entries_;
+};
+
+}  // namespace knowhere_demo
+
+#endif  // KNOWHERE_KERNEL_ENTRY_POINT_SELECTOR_H_
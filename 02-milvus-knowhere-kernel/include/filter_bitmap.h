@@ -0,0 +1,73 @@
+#ifndef KNOWHERE_KERNEL_FILTER_BITMAP_H_
+#define KNOWHERE_KERNEL_FILTER_BITMAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace knowhere_demo {
+
+// Set of node ids allowed by a search filter. Packed encoding spends one bit
+// per node; roaring encoding splits ids into 2^16-wide chunks and stores each
+// chunk as a sorted uint16 array when sparse or a 1024-word bitmap when dense.
+// A default-constructed bitmap means "no filter". Ids at or beyond Universe()
+// always pass, matching the old byte-per-node filter semantics.
+class FilterBitmap {
+public:
+    enum class Encoding {
+        kPacked,
+        kRoaring,
+    };
+
+    FilterBitmap() = default;
+
+    // One byte per node; 1 means the node can be returned.
+    static FilterBitmap FromBytes(const std::vector<std::uint8_t>& bytes);
+    // `ids` must be sorted and unique, all below `universe`.
+    static FilterBitmap FromIds(std::size_t universe, const std::vector<std::uint32_t>& ids);
+    static FilterBitmap FromIds(std::size_t universe, const std::vector<std::uint32_t>& ids, Encoding encoding);
+
+    bool Empty() const { return universe_ == 0; }
+    std::size_t Universe() const { return universe_; }
+    // Number of passing ids in [0, Universe()).
+    std::size_t Count() const { return count_; }
+    double PassRatio() const;
+    Encoding GetEncoding() const { return encoding_; }
+    std::size_t MemoryBytes() const;
+
+    bool Contains(const std::uint32_t id) const {
+        if (id >= universe_) {
+            return true;
+        }
+        if (encoding_ == Encoding::kPacked) {
+            return (words_[id >> 6] >> (id & 63U) & 1U) != 0;
+        }
+        return ContainsRoaring(id);
+    }
+
+    // Appends every passing id in ascending order.
+    void CollectIds(std::vector<std::uint32_t>* ids) const;
+
+private:
+    static constexpr std::size_t kChunkBits = 16;
+    static constexpr std::size_t kChunkWords = (std::size_t{1} << kChunkBits) / 64;
+    // Above this many ids a chunk switches from array to bitmap storage.
+    static constexpr std::size_t kArrayLimit = 4096;
+
+    struct Container {
+        std::vector<std::uint16_t> array;
+        std::vector<std::uint64_t> bits;
+    };
+
+    bool ContainsRoaring(std::uint32_t id) const;
+
+    Encoding encoding_{Encoding::kPacked};
+    std::size_t universe_{0};
+    std::size_t count_{0};
+    std::vector<std::uint64_t> words_;
+    std::vector<Container> containers_;
+};
+
+}  // namespace knowhere_demo
+
+#endif  // KNOWHERE_KERNEL_FILTER_BITMAP_H_
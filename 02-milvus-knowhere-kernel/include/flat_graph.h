@@ -0,0 +1,157 @@
+#ifndef KNOWHERE_KERNEL_FLAT_GRAPH_H_
+#define KNOWHERE_KERNEL_FLAT_GRAPH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "distance.h"
+#include "graph_types.h"
+#include "span.h"
+
+namespace knowhere_demo {
+
+template <typename T, std::size_t Alignment>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}  // NOLINT
+
+    T* allocate(std::size_t count) {
+        const std::size_t bytes = (count * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+        void* ptr = std::aligned_alloc(Alignment, bytes);
+        if (ptr == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, std::size_t) { std::free(ptr); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+enum class MapWarmup {
+    // Pages fault in on first touch.
+    kNone,
+    // madvise(MADV_WILLNEED): kernel readahead starts in the background.
+    kWillNeed,
+    // MAP_POPULATE: the whole file is read before Map returns.
+    kPopulate,
+};
+
+struct MapOptions {
+    MapWarmup warmup{MapWarmup::kNone};
+    // Reads every section once to check the stored checksum; costs a full pass
+    // over the file, so cold starts normally skip it. Offsets and neighbor ids
+    // are range-checked either way; embedding values are trusted without it.
+    bool verify_checksum{false};
+};
+
+// Contiguous graph layout: one row-major embedding matrix whose rows are padded
+// to a cache line, plus CSR offsets/adjacency. A hop touches two flat arrays
+// instead of chasing per-node heap allocations.
+//
+// The arrays are immutable and shared between copies; they live either on the
+// heap or in a read-only file mapping (see Save / Map).
+class FlatGraph {
+public:
+    static constexpr std::size_t kAlignment = 64;
+
+    FlatGraph() = default;
+
+    // Node ids must be dense in [0, nodes.size()); out-of-range neighbors are dropped.
+    static FlatGraph FromNodes(const std::vector<GraphNode>& nodes);
+    // `vectors` is row-major `count` x `dim`; adjacency[i] lists node i's neighbors.
+    static FlatGraph FromAdjacency(
+        const float* vectors,
+        std::size_t count,
+        std::size_t dim,
+        const std::vector<std::vector<NodeId>>& adjacency);
+
+    // Heap copy with nodes renumbered: node i of the result is node
+    // new_to_old[i] of this graph, and every edge is rewritten accordingly.
+    // `new_to_old` must be a permutation of [0, Size()).
+    FlatGraph Permute(const std::vector<NodeId>& new_to_old) const;
+
+    // Writes the versioned on-disk format: a 128-byte header, then the
+    // embedding matrix, CSR offsets and adjacency, each 64-byte aligned and
+    // byte-identical to the in-memory arrays, so Map can serve them in place.
+    // Writes to `path`.tmp, fsyncs it and renames; throws std::runtime_error on
+    // I/O errors.
+    void Save(const std::string& path) const;
+    // Maps a file written by Save read-only and serves straight from the
+    // mapping (no deserialization copy). Throws std::runtime_error on I/O
+    // errors, unknown versions, truncated files, offsets or neighbor ids out
+    // of range, or checksum mismatches.
+    static FlatGraph Map(const std::string& path, const MapOptions& options = {});
+
+    std::size_t Size() const { return size_; }
+    bool Empty() const { return Size() == 0; }
+    std::size_t Dim() const { return dim_; }
+    // Floats per embedding row, including alignment padding.
+    std::size_t Stride() const { return stride_; }
+    bool IsMapped() const { return mapped_; }
+
+    const float* Embedding(const NodeId id) const { return embeddings_ + static_cast<std::size_t>(id) * stride_; }
+
+    Span<const NodeId> Neighbors(const NodeId id) const {
+        const std::uint64_t begin = offsets_[id];
+        return {adjacency_ + begin, static_cast<std::size_t>(offsets_[id + 1] - begin)};
+    }
+
+    // Cache hints for an upcoming hop; neither waits for the requested lines.
+    // PrefetchNeighbors loads the node's CSR offsets to locate the list and
+    // hints its first and last line, which covers lists of up to 16 ids fully.
+    void PrefetchEmbedding(const NodeId id) const { ann_common::PrefetchRow(Embedding(id), dim_); }
+    void PrefetchNeighbors(const NodeId id) const {
+        const std::uint64_t begin = offsets_[id];
+        const std::uint64_t end = offsets_[id + 1];
+        if (begin < end) {
+            __builtin_prefetch(adjacency_ + begin);
+            __builtin_prefetch(adjacency_ + end - 1);
+        }
+    }
+
+    std::size_t EdgeCount() const { return edge_count_; }
+    // Bytes of the embedding, offset and adjacency arrays (heap or mapped).
+    std::size_t MemoryBytes() const { return memory_bytes_; }
+
+private:
+    struct HeapStorage;
+
+    static FlatGraph FromHeap(std::shared_ptr<HeapStorage> storage, std::size_t dim, std::size_t stride);
+
+    std::size_t size_{0};
+    std::size_t dim_{0};
+    std::size_t stride_{0};
+    std::size_t edge_count_{0};
+    std::size_t memory_bytes_{0};
+    bool mapped_{false};
+    const float* embeddings_{nullptr};
+    const std::uint64_t* offsets_{nullptr};
+    const NodeId* adjacency_{nullptr};
+    // Keeps the heap arrays or the file mapping alive.
+    std::shared_ptr<const void> storage_;
+};
+
+// Heap footprint of the legacy per-node layout, for comparison with FlatGraph::MemoryBytes.
+std::size_t EstimateNodeListBytes(const std::vector<GraphNode>& nodes);
+
+}  // namespace knowhere_demo
+
+#endif  // KNOWHERE_KERNEL_FLAT_GRAPH_H_
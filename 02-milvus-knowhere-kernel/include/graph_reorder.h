@@ -0,0 +1,79 @@
+#ifndef KNOWHERE_KERNEL_GRAPH_REORDER_H_
+#define KNOWHERE_KERNEL_GRAPH_REORDER_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "filter_bitmap.h"
+#include "flat_graph.h"
+#include "graph_types.h"
+
+namespace knowhere_demo {
+
+enum class ReorderMethod {
+    // Breadth-first along out-edges from `root`: the order search expands in.
+    kBfs,
+    // Reverse Cuthill-McKee on the symmetrized graph; narrows the id gap
+    // between each node and its neighbors.
+    kRcm,
+    // Gorder (Wei et al., SIGMOD'16): greedily places next the node sharing the
+    // most edges and common in-neighbors with the last `gorder_window` nodes.
+    kGorder,
+};
+
+struct ReorderOptions {
+    ReorderMethod method{ReorderMethod::kGorder};
+    // BFS start; usually the search entry point (e.g. VamanaIndex::medoid).
+    NodeId root{0};
+    std::size_t gorder_window{5};
+};
+
+// Bijection between the ids a graph was built with ("original") and the ids
+// of its reordered copy. Searches run on reordered ids: map entry points and
+// filters in with ToReordered, results out with ToOriginal. A default map is
+// the identity.
+class IdMap {
+public:
+    IdMap() = default;
+    // new_to_old[i] is the original id of reordered node i; must be a permutation.
+    explicit IdMap(std::vector<NodeId> new_to_old);
+
+    bool IsIdentity() const { return new_to_old_.empty(); }
+    std::size_t Size() const { return new_to_old_.size(); }
+
+    NodeId ToReordered(const NodeId original) const { return IsIdentity() ? original : old_to_new_[original]; }
+    NodeId ToOriginal(const NodeId reordered) const { return IsIdentity() ? reordered : new_to_old_[reordered]; }
+    const std::vector<NodeId>& NewToOld() const { return new_to_old_; }
+
+    // Rewrites result ids in place from reordered to original ids.
+    void ToOriginal(std::vector<Candidate>* results) const;
+    // Filter over original ids -> the same set over reordered ids. Ids the
+    // source bitmap lets through implicitly (at or beyond its universe) keep
+    // passing; the result covers the whole graph.
+    FilterBitmap ToReordered(const FilterBitmap& filter) const;
+
+private:
+    std::vector<NodeId> new_to_old_;
+    std::vector<NodeId> old_to_new_;
+};
+
+struct ReorderedGraph {
+    FlatGraph graph;
+    IdMap ids;
+};
+
+// New-to-old node order for `graph`. Every node appears once; disconnected
+// parts are appended in ascending id order of their first node.
+std::vector<NodeId> ComputeNodeOrder(const FlatGraph& graph, const ReorderOptions& options = {});
+
+// Offline pass: renumbers nodes by ComputeNodeOrder and rewrites embeddings
+// and adjacency so graph neighbors sit close in memory.
+ReorderedGraph ReorderGraph(const FlatGraph& graph, const ReorderOptions& options = {});
+
+// Mean |u - v| over all edges u -> v; a cheap proxy for the locality a
+// traversal sees.
+double AverageEdgeGap(const FlatGraph& graph);
+
+}  // namespace knowhere_demo
+
+#endif  // KNOWHERE_KERNEL_GRAPH_REORDER_H_
@@ -5,10 +5,15 @@
 #include <cstdint>
 #include <vector>
 
+#include "filter_bitmap.h"
+
 namespace knowhere_demo {
 
 using NodeId = std::uint32_t;
 
+// Nodes ahead of the one being scored whose embeddings are software-prefetched.
+inline constexpr std::size_t kDefaultPrefetchDistance = 4;
+
 struct GraphNode {
     NodeId id{};
     std::vector<float> embedding;
@@ -18,8 +23,8 @@ struct GraphNode {
 struct SearchRequest {
     std::vector<float> query;
     std::size_t top_k{10};
-    // 1 means the node can be returned, 0 means filtered out.
-    std::vector<std::uint8_t> filter_bitmap;
+    // Nodes allowed in the result; empty means no filter.
+    FilterBitmap filter_bitmap;
 };
 
 struct Candidate {
@@ -28,11 +33,56 @@ struct Candidate {
     bool passed_filter{true};
 };
 
+enum class SearchMode {
+    // FIFO expansion in discovery order.
+    kBreadthFirst,
+    // Greedy expansion of the closest unexpanded candidates (ef-bounded pool).
+    kBestFirst,
+};
+
+enum class FilterStrategy {
+    // Brute force when few enough ids pass, graph expansion otherwise.
+    kAuto,
+    // Filter-late graph expansion: filtered nodes are expanded but not returned.
+    kGraph,
+    // Exact scan over the passing ids only.
+    kBruteForce,
+};
+
+struct SearchParams {
+    std::size_t max_visit{256};
+    std::size_t batch_size{32};
+    // Best-first candidate pool width; values below top_k are raised to top_k.
+    std::size_t ef{64};
+    SearchMode mode{SearchMode::kBestFirst};
+    FilterStrategy filter_strategy{FilterStrategy::kAuto};
+    // kAuto scans directly when at most max(max_visit, ratio * graph size) ids
+    // pass: the graph walk would touch at least that many nodes anyway, and
+    // recall of filter-late expansion collapses at low pass rates.
+    double brute_force_pass_ratio{0.05};
+    // Software prefetch depth: distance tasks hint embeddings this many rows
+    // ahead, and the adjacency lists of the next expansion are hinted while the
+    // current one is scored. 0 leaves everything to the hardware prefetchers.
+    std::size_t prefetch_distance{kDefaultPrefetchDistance};
+    // Best-first navigation on the compressed codes from BuildCodes: the best
+    // `rerank_depth` passing candidates (0 means max(ef, top_k)) are re-scored
+    // with exact distances and cut to top_k. Ignored until codes are built and
+    // by breadth-first mode.
+    bool use_codes{false};
+    std::size_t rerank_depth{0};
+};
+
 struct SearchStats {
     std::size_t visited{0};
     std::size_t filtered_nodes{0};
     std::uint64_t prefetch_us{0};
     std::uint64_t compute_us{0};
+    // Time from batch start until this query finished; filled by SearchBatch.
+    std::uint64_t latency_us{0};
+    // Distance computations spent picking the entry node (automatic entry only).
+    std::size_t entry_evaluations{0};
+    // Candidates re-scored with full-precision distances (use_codes only).
+    std::size_t reranked{0};
 };
 
 }  // namespace knowhere_demo
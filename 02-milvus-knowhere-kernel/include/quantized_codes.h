@@ -0,0 +1,87 @@
+#ifndef KNOWHERE_KERNEL_QUANTIZED_CODES_H_
+#define KNOWHERE_KERNEL_QUANTIZED_CODES_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "flat_graph.h"
+#include "graph_types.h"
+
+namespace knowhere_demo {
+
+enum class CodeType {
+    // One byte per dimension over a per-dimension [min, max] range (4x smaller
+    // than float).
+    kSq8,
+    // One nibble per dimension, same ranges (8x smaller).
+    kSq4,
+    // Product quantization: one byte per subspace indexing a 256-entry k-means
+    // codebook trained on that slice of the dimensions.
+    kPq,
+};
+
+struct QuantizerOptions {
+    CodeType type{CodeType::kSq8};
+    // kPq only; must divide the dimension. Bytes per node = pq_subspaces.
+    std::size_t pq_subspaces{32};
+    std::size_t kmeans_iterations{10};
+    // Rows sampled to fit ranges / codebooks.
+    std::size_t train_samples{50000};
+    std::uint32_t seed{42};
+};
+
+// Compressed copy of a graph's embeddings for navigation: one contiguous
+// Size() x CodeBytes() array, so traversal touches codes and adjacency only
+// and the float rows (possibly a cold file mapping) are read just for rerank.
+// Distances are asymmetric: the query stays in float.
+class QuantizedCodes {
+public:
+    // Per-query state: a lookup table of partial distances (kSq4, kPq) or the
+    // query rescaled to code units (kSq8). Reusable across queries.
+    class Query {
+    private:
+        friend class QuantizedCodes;
+        std::vector<float> table_;
+    };
+
+    QuantizedCodes() = default;
+
+    // Fits the quantizer on a sample of `graph` and encodes every node. Throws
+    // std::invalid_argument when kPq subspaces do not divide the dimension.
+    static QuantizedCodes Encode(const FlatGraph& graph, const QuantizerOptions& options = {});
+
+    bool Empty() const { return size_ == 0; }
+    std::size_t Size() const { return size_; }
+    std::size_t Dim() const { return dim_; }
+    CodeType Type() const { return type_; }
+    std::size_t CodeBytes() const { return code_bytes_; }
+    // Codes plus ranges / codebooks.
+    std::size_t MemoryBytes() const;
+
+    void PrepareQuery(const float* query, Query* state) const;
+    // Approximate squared L2 from the prepared query to each of `ids`.
+    void Distances(const Query& state, const NodeId* ids, std::size_t count, float* out) const;
+
+private:
+    const std::uint8_t* Code(const NodeId id) const { return codes_.data() + static_cast<std::size_t>(id) * code_bytes_; }
+    float Distance(const Query& state, const std::uint8_t* code) const;
+
+    CodeType type_{CodeType::kSq8};
+    std::size_t size_{0};
+    std::size_t dim_{0};
+    std::size_t code_bytes_{0};
+    std::size_t subspaces_{0};
+    // kPq: trained centroids per subspace (256 unless the sample was smaller).
+    std::size_t centroids_{0};
+    // kSq8 / kSq4: per-dimension lower bound and step.
+    std::vector<float> min_;
+    std::vector<float> step_;
+    // kPq: subspaces x 256 x (dim / subspaces) centroids.
+    std::vector<float> codebooks_;
+    std::vector<std::uint8_t> codes_;
+};
+
+}  // namespace knowhere_demo
+
+#endif  // KNOWHERE_KERNEL_QUANTIZED_CODES_H_
@@ -0,0 +1,36 @@
+#ifndef KNOWHERE_KERNEL_SPAN_H_
+#define KNOWHERE_KERNEL_SPAN_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace knowhere_demo {
+
+// Minimal non-owning view over contiguous memory (std::span is C++20).
+template <typename T>
+class Span {
+public:
+    constexpr Span() = default;
+    constexpr Span(T* data, std::size_t size) : data_(data), size_(size) {}
+
+    template <typename U>
+    Span(const std::vector<U>& values) : data_(values.data()), size_(values.size()) {}  // NOLINT
+
+    template <typename U>
+    Span(std::vector<U>& values) : data_(values.data()), size_(values.size()) {}  // NOLINT
+
+    constexpr T* data() const { return data_; }
+    constexpr std::size_t size() const { return size_; }
+    constexpr bool empty() const { return size_ == 0; }
+    constexpr T* begin() const { return data_; }
+    constexpr T* end() const { return data_ + size_; }
+    constexpr T& operator[](std::size_t idx) const { return data_[idx]; }
+
+private:
+    T* data_{nullptr};
+    std::size_t size_{0};
+};
+
+}  // namespace knowhere_demo
+
+#endif  // KNOWHERE_KERNEL_SPAN_H_
@@ -2,6 +2,8 @@
 #define KNOWHERE_KERNEL_TOPK_REDUCER_H_
 
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <vector>
 
 #include "graph_types.h"
@@ -13,14 +15,38 @@ class TopKReducer {
 public:
     explicit TopKReducer(std::size_t top_k);
 
+    // Empties the reducer for reuse, keeping the heap allocation.
+    void Reset(std::size_t top_k);
     void AbsorbBatch(const std::vector<Candidate>& batch);
-    std::vector<Candidate> Finalize() const;
+
+    // Batch-select for large blocks of already-filtered candidates: a SIMD
+    // compare against Threshold() drops most of the block before any heap work,
+    // and survivors beyond top_k are cut with nth_element first.
+    void AbsorbBlock(const NodeId* ids, const float* distances, std::size_t count);
+
+    // Combines partial results, e.g. from per-thread or per-shard reducers.
+    void Merge(const TopKReducer& other);
+
+    // Distance a candidate must beat to enter the result; +inf until full, and
+    // always at top_k 0 (Offer drops everything then).
+    float Threshold() const {
+        return top_k_ == 0 || heap_.size() < top_k_ ? std::numeric_limits<float>::infinity()
+                                                     : heap_.front().distance;
+    }
+
+    std::size_t Size() const { return heap_.size(); }
+
+    std::vector<Candidate> Finalize() const&;
+    // Sorts the heap in place and hands it over without copying.
+    std::vector<Candidate> Finalize() &&;
 
 private:
     static bool MaxHeapCmp(const Candidate& left, const Candidate& right);
+    void Offer(const Candidate& candidate);
 
     std::size_t top_k_;
     std::vector<Candidate> heap_;
+    std::vector<std::uint32_t> survivors_;
 };
 
 }  // namespace knowhere_demo
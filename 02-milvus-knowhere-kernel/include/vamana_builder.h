@@ -0,0 +1,50 @@
+#ifndef KNOWHERE_KERNEL_VAMANA_BUILDER_H_
+#define KNOWHERE_KERNEL_VAMANA_BUILDER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "flat_graph.h"
+#include "graph_types.h"
+
+namespace knowhere_demo {
+
+struct VamanaBuildParams {
+    // R: out-degree cap after pruning.
+    std::size_t max_degree{32};
+    // L: candidate list size of the greedy search run for every insertion.
+    std::size_t build_list_size{64};
+    // Second-pass pruning slack; the first pass always uses 1.0.
+    float alpha{1.2F};
+    // 0 picks std::thread::hardware_concurrency().
+    std::size_t num_threads{0};
+    std::uint32_t seed{42};
+};
+
+struct VamanaIndex {
+    FlatGraph graph;
+    // Point closest to the dataset centroid; the natural search entry point.
+    NodeId medoid{0};
+};
+
+// Builds a navigable proximity graph (Vamana / DiskANN) from raw vectors.
+// Points are inserted in random order by `num_threads` threads: each runs a
+// greedy search from the medoid, RNG-prunes the visited set with `alpha` down
+// to `max_degree` neighbors and adds reverse edges, re-pruning neighbors that
+// overflow. Each adjacency list is guarded by its own spinlock.
+class VamanaBuilder {
+public:
+    explicit VamanaBuilder(VamanaBuildParams params = {});
+
+    // `vectors` is row-major `count` x `dim`.
+    VamanaIndex Build(const float* vectors, std::size_t count, std::size_t dim) const;
+    VamanaIndex Build(const std::vector<std::vector<float>>& vectors) const;
+
+private:
+    VamanaBuildParams params_;
+};
+
+}  // namespace knowhere_demo
+
+#endif  // KNOWHERE_KERNEL_VAMANA_BUILDER_H_
@@ -0,0 +1,114 @@
+#ifndef KNOWHERE_KERNEL_WORK_STEALING_EXECUTOR_H_
+#define KNOWHERE_KERNEL_WORK_STEALING_EXECUTOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace knowhere_demo {
+
+struct ExecutorOptions {
+    // 0 picks std::thread::hardware_concurrency() (at least 2).
+    std::size_t num_workers{0};
+    // Capacity of each worker's ring buffer; a full queue runs the task inline.
+    std::size_t queue_capacity{256};
+};
+
+// Completion counter for a set of tasks submitted together.
+class TaskGroup {
+public:
+    bool Done() const { return pending_.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class WorkStealingExecutor;
+    std::atomic<std::size_t> pending_{0};
+};
+
+// Long-lived pool with one bounded task queue per worker. Workers pop their own
+// queue LIFO and steal from the others FIFO; callers blocked in Wait() help
+// drain queues instead of sleeping. Tasks are plain {fn, ctx, range} records,
+// so submission never allocates.
+class WorkStealingExecutor {
+public:
+    using TaskFn = void (*)(void* ctx, std::size_t begin, std::size_t end);
+
+    explicit WorkStealingExecutor(ExecutorOptions options = {});
+    ~WorkStealingExecutor();
+
+    WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+
+    std::size_t NumWorkers() const { return workers_.size(); }
+
+    // `ctx` must outlive the task, i.e. callers Wait() on `group` before
+    // releasing it.
+    void Submit(TaskGroup* group, TaskFn fn, void* ctx, std::size_t begin, std::size_t end);
+
+    template <typename Fn>
+    void Submit(TaskGroup* group, Fn* fn, const std::size_t begin, const std::size_t end) {
+        Submit(
+            group,
+            [](void* ctx, const std::size_t b, const std::size_t e) { (*static_cast<Fn*>(ctx))(b, e); },
+            fn,
+            begin,
+            end);
+    }
+
+    // Splits [0, count) into chunks of `grain` and submits fn(begin, end) per chunk.
+    template <typename Fn>
+    void SubmitRange(TaskGroup* group, Fn* fn, const std::size_t count, const std::size_t grain) {
+        const std::size_t step = grain == 0 ? 1 : grain;
+        for (std::size_t begin = 0; begin < count; begin += step) {
+            Submit(group, fn, begin, begin + step < count ? begin + step : count);
+        }
+    }
+
+    // Runs queued tasks on the calling thread until `group` completes.
+    void Wait(TaskGroup* group);
+
+private:
+    struct Task {
+        TaskGroup* group{nullptr};
+        TaskFn fn{nullptr};
+        void* ctx{nullptr};
+        std::size_t begin{0};
+        std::size_t end{0};
+    };
+
+    class BoundedQueue {
+    public:
+        explicit BoundedQueue(std::size_t capacity) : slots_(capacity) {}
+
+        bool PushBack(const Task& task);
+        bool PopBack(Task* task);
+        bool PopFront(Task* task);
+
+    private:
+        std::mutex mutex_;
+        std::vector<Task> slots_;
+        std::size_t head_{0};
+        std::size_t size_{0};
+    };
+
+    void WorkerLoop(std::size_t worker_index);
+    bool TryRunOne(std::size_t home_queue);
+    static void Run(const Task& task);
+    std::size_t PickQueue();
+
+    std::vector<std::unique_ptr<BoundedQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<std::size_t> queued_{0};
+    std::atomic<std::size_t> next_queue_{0};
+    std::atomic<std::size_t> sleepers_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stop_{false};
+};
+
+}  // namespace knowhere_demo
+
+#endif  // KNOWHERE_KERNEL_WORK_STEALING_EXECUTOR_H_
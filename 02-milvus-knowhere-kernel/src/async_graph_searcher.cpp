@@ -3,19 +3,177 @@
 #include <algorithm>
 #include <chrono>
 #include <cmath>
-#include <future>
-#include <limits>
-#include <queue>
-#include <thread>
-#include <unordered_set>
+#include <memory>
 #include <utility>
 #include <vector>
 
+#include "candidate_pool.h"
+#include "distance.h"
+#include "metrics.h"
 #include "topk_reducer.h"
+#include "visited_table.h"
 
 namespace knowhere_demo {
 
-AsyncGraphSearcher::AsyncGraphSearcher(std::vector<GraphNode> graph) : graph_(std::move(graph)) {}
+namespace {
+
+// Process-wide metrics, resolved once; recording is a relaxed atomic add into
+// the calling thread's shard.
+struct SearchMetrics {
+    ann_common::LatencyHistogram& prefetch = ann_common::StageLatency("knowhere", "prefetch");
+    ann_common::LatencyHistogram& distance = ann_common::StageLatency("knowhere", "distance");
+    ann_common::LatencyHistogram& reduce = ann_common::StageLatency("knowhere", "topk_reduce");
+    ann_common::LatencyHistogram& rerank = ann_common::StageLatency("knowhere", "rerank");
+    ann_common::LatencyHistogram& query = ann_common::StageLatency("knowhere", "query");
+    ann_common::Counter& visited = ann_common::EngineCounter(
+        "ann_search_visited_nodes_total", "knowhere", "Nodes whose distance to the query was computed.");
+    ann_common::Counter& filtered = ann_common::EngineCounter(
+        "ann_search_filtered_nodes_total", "knowhere", "Visited nodes rejected by the query filter.");
+
+    void RecordQuery(const SearchStats& stats, const std::uint64_t nanos) const {
+        query.Record(nanos);
+        visited.Add(stats.visited);
+        filtered.Add(stats.filtered_nodes);
+    }
+};
+
+const SearchMetrics& Metrics() {
+    static const SearchMetrics metrics;
+    return metrics;
+}
+
+std::uint64_t Nanos(const std::chrono::steady_clock::time_point begin, const std::chrono::steady_clock::time_point end) {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+}
+
+// Nodes per distance task; one DistanceGather call amortizes the task overhead.
+constexpr std::size_t kDistanceTaskGrain = 16;
+
+// Traversal ranks on squared L2; only the returned top-k pay for the sqrt.
+std::vector<Candidate> ToL2Distances(std::vector<Candidate> candidates) {
+    for (Candidate& candidate : candidates) {
+        candidate.distance = std::sqrt(candidate.distance);
+    }
+    return candidates;
+}
+
+// Ids per brute-force scan task.
+constexpr std::size_t kBruteForceChunk = 4096;
+
+// Queries per SearchBatch task; larger groups share more expansions, smaller
+// ones spread better across workers.
+constexpr std::size_t kBatchGroupSize = 8;
+
+struct BatchQueryState {
+    CandidatePool pool{0};
+    TopKReducer reducer{0};
+    ann_common::VisitedTable visited;
+    std::vector<Candidate> local_batch;
+    std::vector<NodeId> expand_nodes;
+    bool active{false};
+};
+
+struct ScorePair {
+    NodeId node{};
+    std::uint32_t slot{};
+};
+
+// Per-thread SearchBatch scratch, reused across groups and batches.
+struct BatchScratch {
+    std::vector<BatchQueryState> queries;
+    std::vector<float> query_matrix;
+    std::vector<NodeId> expand_union;
+    std::vector<Span<const NodeId>> union_neighbors;
+    std::vector<ScorePair> pairs;
+    std::vector<std::uint32_t> run_slots;
+    std::vector<float> run_distances;
+};
+
+// Per-thread scratch of SearchBaseline / SearchOptimized, reused across
+// queries so a warm thread searches without touching the allocator.
+struct QueryScratch {
+    TopKReducer reducer{0};
+    // FIFO frontier read from `frontier_head`. A node is pushed at most once
+    // per query, so the vector never needs to wrap.
+    std::vector<NodeId> frontier;
+    std::size_t frontier_head{0};
+    std::vector<Candidate> local_batch;
+    std::vector<NodeId> stage_nodes;
+    std::vector<float> stage_distances;
+};
+
+// Per-thread scratch of SearchBestFirst, reused across queries like
+// QueryScratch.
+struct BestFirstScratch {
+    TopKReducer reducer{0};
+    CandidatePool pool{0};
+    QuantizedCodes::Query code_query;
+    std::vector<Candidate> local_batch;
+    std::vector<NodeId> expand_nodes;
+    std::vector<NodeId> fresh_nodes;
+    std::vector<float> fresh_distances;
+};
+
+// A worker blocked in Wait() may pick up another task that searches too, so
+// scratch is handed out as a per-thread stack rather than a single slot.
+template <typename Scratch>
+class ScopedScratch {
+public:
+    ScopedScratch() {
+        if (depth_ == stack_.size()) {
+            stack_.push_back(std::make_unique<Scratch>());
+        }
+        scratch_ = stack_[depth_++].get();
+    }
+    ~ScopedScratch() { --depth_; }
+
+    ScopedScratch(const ScopedScratch&) = delete;
+    ScopedScratch& operator=(const ScopedScratch&) = delete;
+
+    Scratch& Get() const { return *scratch_; }
+
+private:
+    static thread_local std::vector<std::unique_ptr<Scratch>> stack_;
+    static thread_local std::size_t depth_;
+    Scratch* scratch_{nullptr};
+};
+
+template <typename Scratch>
+thread_local std::vector<std::unique_ptr<Scratch>> ScopedScratch<Scratch>::stack_;
+template <typename Scratch>
+thread_local std::size_t ScopedScratch<Scratch>::depth_ = 0;
+
+}  // namespace
+
+AsyncGraphSearcher::AsyncGraphSearcher(FlatGraph graph, std::shared_ptr<WorkStealingExecutor> executor)
+    : graph_(std::move(graph)), executor_(std::move(executor)) {
+    if (!executor_) {
+        executor_ = std::make_shared<WorkStealingExecutor>();
+    }
+}
+
+AsyncGraphSearcher::AsyncGraphSearcher(
+    const std::vector<GraphNode>& graph,
+    std::shared_ptr<WorkStealingExecutor> executor)
+    : AsyncGraphSearcher(FlatGraph::FromNodes(graph), std::move(executor)) {}
+
+void AsyncGraphSearcher::BuildEntryPoints(const EntryPointOptions& options) {
+    entry_points_ = EntryPointSelector::Build(graph_, options);
+}
+
+void AsyncGraphSearcher::BuildCodes(const QuantizerOptions& options) {
+    codes_ = QuantizedCodes::Encode(graph_, options);
+}
+
+NodeId AsyncGraphSearcher::SelectEntryPoint(const std::vector<float>& query, std::size_t* evaluations) const {
+    if (query.size() != graph_.Dim()) {
+        if (evaluations) {
+            *evaluations = 0;
+        }
+        return entry_points_.Medoid();
+    }
+    return entry_points_.Select(query.data(), evaluations);
+}
 
 std::vector<Candidate> AsyncGraphSearcher::Search(
     const SearchRequest& request,
@@ -26,60 +184,90 @@ std::vector<Candidate> AsyncGraphSearcher::Search(
     return SearchOptimized(request, entrypoint, max_visit, batch_size, stats);
 }
 
+std::vector<Candidate> AsyncGraphSearcher::Search(
+    const SearchRequest& request,
+    const NodeId entrypoint,
+    const SearchParams& params,
+    SearchStats* stats) const {
+    if (PreferBruteForce(request, params)) {
+        return SearchFilteredBruteForce(request, stats);
+    }
+    if (params.mode == SearchMode::kBreadthFirst) {
+        return SearchOptimized(request, entrypoint, params.max_visit, params.batch_size, stats, params.prefetch_distance);
+    }
+    return SearchBestFirst(request, entrypoint, params, stats);
+}
+
+std::vector<Candidate> AsyncGraphSearcher::Search(
+    const SearchRequest& request,
+    const SearchParams& params,
+    SearchStats* stats) const {
+    std::size_t evaluations = 0;
+    const NodeId entrypoint = PreferBruteForce(request, params) ? 0 : SelectEntryPoint(request.query, &evaluations);
+    auto result = Search(request, entrypoint, params, stats);
+    if (stats) {
+        stats->entry_evaluations = evaluations;
+    }
+    return result;
+}
+
 std::vector<Candidate> AsyncGraphSearcher::SearchBaseline(
     const SearchRequest& request,
     const NodeId entrypoint,
     const std::size_t max_visit,
     SearchStats* stats) const {
-    if (graph_.empty() || entrypoint >= graph_.size() || request.query.empty()) {
+    if (graph_.Empty() || entrypoint >= graph_.Size() || request.query.size() != graph_.Dim()) {
         return {};
     }
 
     SearchStats local_stats;
-    TopKReducer reducer(request.top_k);
-    std::queue<NodeId> frontier;
-    std::unordered_set<NodeId> visited;
-    frontier.push(entrypoint);
-    visited.insert(entrypoint);
+    const ScopedScratch<QueryScratch> scratch_guard;
+    QueryScratch& scratch = scratch_guard.Get();
+    TopKReducer& reducer = scratch.reducer;
+    reducer.Reset(request.top_k);
+    std::vector<NodeId>& frontier = scratch.frontier;
+    std::size_t& head = scratch.frontier_head;
+    frontier.clear();
+    head = 0;
+    const ann_common::ScopedVisitedTable visited(graph_.Size());
+    std::vector<Candidate>& single_candidate = scratch.local_batch;
+    single_candidate.resize(1);
+    frontier.push_back(entrypoint);
+    visited->TestAndSet(entrypoint);
 
-    while (!frontier.empty() && local_stats.visited < max_visit) {
-        const NodeId current = frontier.front();
-        frontier.pop();
+    while (head < frontier.size() && local_stats.visited < max_visit) {
+        const NodeId current = frontier[head++];
 
         const auto compute_start = std::chrono::steady_clock::now();
-        const GraphNode& node = graph_[current];
-        const bool passed = PassFilter(node.id, request);
-        const float distance = L2Distance(request.query, node.embedding);
+        const bool passed = PassFilter(current, request);
+        const float distance = ann_common::L2Sqr(request.query.data(), graph_.Embedding(current), graph_.Dim());
         const auto compute_end = std::chrono::steady_clock::now();
 
         local_stats.compute_us +=
             std::chrono::duration_cast<std::chrono::microseconds>(compute_end - compute_start).count();
         local_stats.filtered_nodes += passed ? 0 : 1;
 
-        reducer.AbsorbBatch({Candidate{.id = node.id, .distance = distance, .passed_filter = passed}});
+        single_candidate[0] = Candidate{.id = current, .distance = distance, .passed_filter = passed};
+        reducer.AbsorbBatch(single_candidate);
 
         const auto prefetch_start = std::chrono::steady_clock::now();
-        const std::vector<NodeId> neighbors = PrefetchNeighbors(current);
+        for (const NodeId neighbor : graph_.Neighbors(current)) {
+            if (visited->TestAndSet(neighbor)) {
+                frontier.push_back(neighbor);
+            }
+        }
         const auto prefetch_end = std::chrono::steady_clock::now();
         local_stats.prefetch_us +=
             std::chrono::duration_cast<std::chrono::microseconds>(prefetch_end - prefetch_start).count();
 
-        for (const NodeId neighbor : neighbors) {
-            if (neighbor >= graph_.size()) {
-                continue;
-            }
-            if (visited.insert(neighbor).second) {
-                frontier.push(neighbor);
-            }
-        }
-
         ++local_stats.visited;
     }
 
     if (stats) {
         *stats = local_stats;
     }
-    return reducer.Finalize();
+    // The copy out of the reused reducer is the query's only allocation.
+    return ToL2Distances(reducer.Finalize());
 }
 
 std::vector<Candidate> AsyncGraphSearcher::SearchOptimized(
@@ -87,57 +275,72 @@ std::vector<Candidate> AsyncGraphSearcher::SearchOptimized(
     const NodeId entrypoint,
     const std::size_t max_visit,
     const std::size_t batch_size,
-    SearchStats* stats) const {
-    if (graph_.empty() || entrypoint >= graph_.size() || request.query.empty()) {
+    SearchStats* stats,
+    const std::size_t prefetch_distance) const {
+    if (graph_.Empty() || entrypoint >= graph_.Size() || request.query.size() != graph_.Dim()) {
         return {};
     }
 
+    const auto query_start = std::chrono::steady_clock::now();
     SearchStats local_stats;
-    TopKReducer reducer(request.top_k);
-    std::queue<NodeId> frontier;
-    std::unordered_set<NodeId> visited;
-    std::vector<Candidate> local_batch;
-    local_batch.reserve(batch_size);
-
-    frontier.push(entrypoint);
-    visited.insert(entrypoint);
+    const ScopedScratch<QueryScratch> scratch_guard;
+    QueryScratch& scratch = scratch_guard.Get();
+    TopKReducer& reducer = scratch.reducer;
+    reducer.Reset(request.top_k);
+    std::vector<NodeId>& frontier = scratch.frontier;
+    std::size_t& head = scratch.frontier_head;
+    frontier.clear();
+    head = 0;
+    const ann_common::ScopedVisitedTable visited(graph_.Size());
+    std::vector<Candidate>& local_batch = scratch.local_batch;
+    std::vector<NodeId>& stage_nodes = scratch.stage_nodes;
+    std::vector<float>& stage_distances = scratch.stage_distances;
+    local_batch.clear();
+    stage_distances.resize(batch_size);
 
-    while (!frontier.empty() && local_stats.visited < max_visit) {
-        std::vector<NodeId> stage_nodes;
-        stage_nodes.reserve(batch_size);
-        while (!frontier.empty() && stage_nodes.size() < batch_size && local_stats.visited + stage_nodes.size() < max_visit) {
-            stage_nodes.push_back(frontier.front());
-            frontier.pop();
-        }
+    auto distance_task = [&](const std::size_t begin, const std::size_t end) {
+        GatherDistances(
+            request.query.data(), stage_nodes.data() + begin, end - begin, prefetch_distance,
+            stage_distances.data() + begin);
+    };
 
-        std::vector<std::future<std::vector<NodeId>>> prefetch_jobs;
-        prefetch_jobs.reserve(stage_nodes.size());
+    frontier.push_back(entrypoint);
+    visited->TestAndSet(entrypoint);
 
-        const auto prefetch_start = std::chrono::steady_clock::now();
-        for (const NodeId node : stage_nodes) {
-            prefetch_jobs.push_back(
-                std::async(std::launch::async, &AsyncGraphSearcher::PrefetchNeighbors, this, node));
+    while (head < frontier.size() && local_stats.visited < max_visit) {
+        stage_nodes.clear();
+        while (head < frontier.size() && stage_nodes.size() < batch_size && local_stats.visited + stage_nodes.size() < max_visit) {
+            stage_nodes.push_back(frontier[head++]);
         }
-        const auto prefetch_launch_end = std::chrono::steady_clock::now();
 
+        // The stage is expanded right after it is scored: hint its adjacency
+        // lists now so the misses resolve behind the distance tasks.
+        if (prefetch_distance > 0) {
+            for (const NodeId node_id : stage_nodes) {
+                graph_.PrefetchNeighbors(node_id);
+            }
+        }
+        TaskGroup compute_group;
         const auto compute_start = std::chrono::steady_clock::now();
-        for (const NodeId node_id : stage_nodes) {
-            const GraphNode& node = graph_[node_id];
-            const bool passed = PassFilter(node.id, request);
-            const float distance = L2Distance(request.query, node.embedding);
-            local_batch.push_back(Candidate{.id = node.id, .distance = distance, .passed_filter = passed});
+        executor_->SubmitRange(&compute_group, &distance_task, stage_nodes.size(), kDistanceTaskGrain);
+        executor_->Wait(&compute_group);
+        const float threshold = reducer.Threshold();
+        for (std::size_t idx = 0; idx < stage_nodes.size(); ++idx) {
+            const NodeId node_id = stage_nodes[idx];
+            const bool passed = PassFilter(node_id, request);
             local_stats.filtered_nodes += passed ? 0 : 1;
+            if (passed && stage_distances[idx] < threshold) {
+                local_batch.push_back(
+                    Candidate{.id = node_id, .distance = stage_distances[idx], .passed_filter = true});
+            }
         }
         const auto compute_end = std::chrono::steady_clock::now();
 
-        for (std::size_t idx = 0; idx < prefetch_jobs.size(); ++idx) {
-            const std::vector<NodeId> neighbors = prefetch_jobs[idx].get();
-            for (const NodeId neighbor : neighbors) {
-                if (neighbor >= graph_.size()) {
-                    continue;
-                }
-                if (visited.insert(neighbor).second) {
-                    frontier.push(neighbor);
+        const auto prefetch_start = compute_end;
+        for (const NodeId node_id : stage_nodes) {
+            for (const NodeId neighbor : graph_.Neighbors(node_id)) {
+                if (visited->TestAndSet(neighbor)) {
+                    frontier.push_back(neighbor);
                 }
             }
         }
@@ -145,45 +348,522 @@ std::vector<Candidate> AsyncGraphSearcher::SearchOptimized(
 
         reducer.AbsorbBatch(local_batch);
         local_batch.clear();
+        Metrics().reduce.Record(ann_common::NanosSince(prefetch_end));
+        Metrics().distance.Record(Nanos(compute_start, compute_end));
+        Metrics().prefetch.Record(Nanos(prefetch_start, prefetch_end));
 
         local_stats.visited += stage_nodes.size();
         local_stats.compute_us +=
             std::chrono::duration_cast<std::chrono::microseconds>(compute_end - compute_start).count();
-        // include async launch + waiting + merge as prefetch stage cost.
         local_stats.prefetch_us +=
             std::chrono::duration_cast<std::chrono::microseconds>(prefetch_end - prefetch_start).count();
-        (void)prefetch_launch_end;
     }
 
+    Metrics().RecordQuery(local_stats, ann_common::NanosSince(query_start));
     if (stats) {
         *stats = local_stats;
     }
-    return reducer.Finalize();
+    return ToL2Distances(reducer.Finalize());
 }
 
-float AsyncGraphSearcher::L2Distance(const std::vector<float>& lhs, const std::vector<float>& rhs) const {
-    if (lhs.size() != rhs.size()) {
-        return std::numeric_limits<float>::max();
+std::vector<Candidate> AsyncGraphSearcher::SearchBestFirst(
+    const SearchRequest& request,
+    const NodeId entrypoint,
+    const SearchParams& params,
+    SearchStats* stats) const {
+    if (graph_.Empty() || entrypoint >= graph_.Size() || request.query.size() != graph_.Dim()) {
+        return {};
     }
 
-    float sum = 0.0F;
-    for (std::size_t idx = 0; idx < lhs.size(); ++idx) {
-        const float diff = lhs[idx] - rhs[idx];
-        sum += diff * diff;
+    const auto query_start = std::chrono::steady_clock::now();
+    const std::size_t batch_size = std::max<std::size_t>(1, params.batch_size);
+    const bool quantized = params.use_codes && !codes_.Empty();
+    SearchStats local_stats;
+    // On codes the reducer keeps the rerank candidates rather than the result.
+    const std::size_t rerank_depth = params.rerank_depth > 0 ? params.rerank_depth : std::max(params.ef, request.top_k);
+    const ScopedScratch<BestFirstScratch> scratch_guard;
+    BestFirstScratch& scratch = scratch_guard.Get();
+    TopKReducer& reducer = scratch.reducer;
+    reducer.Reset(quantized ? std::max(rerank_depth, request.top_k) : request.top_k);
+    QuantizedCodes::Query& code_query = scratch.code_query;
+    if (quantized) {
+        codes_.PrepareQuery(request.query.data(), &code_query);
     }
-    return std::sqrt(sum);
+    // Filtered nodes stay in the pool so they can still be expanded.
+    CandidatePool& pool = scratch.pool;
+    pool.Reset(std::max(params.ef, request.top_k));
+    const ann_common::ScopedVisitedTable visited(graph_.Size());
+    std::vector<Candidate>& local_batch = scratch.local_batch;
+    std::vector<NodeId>& expand_nodes = scratch.expand_nodes;
+    std::vector<NodeId>& fresh_nodes = scratch.fresh_nodes;
+    std::vector<float>& fresh_distances = scratch.fresh_distances;
+    local_batch.clear();
+    fresh_nodes.clear();
+
+    auto distance_task = [&](const std::size_t begin, const std::size_t end) {
+        if (quantized) {
+            codes_.Distances(code_query, fresh_nodes.data() + begin, end - begin, fresh_distances.data() + begin);
+            return;
+        }
+        GatherDistances(
+            request.query.data(), fresh_nodes.data() + begin, end - begin, params.prefetch_distance,
+            fresh_distances.data() + begin);
+    };
+    auto evaluate_fresh = [&]() {
+        const auto compute_start = std::chrono::steady_clock::now();
+        // One hop ahead: the pool's best unexpanded nodes are the likely next
+        // expansion, so their adjacency loads overlap this round's scoring.
+        if (params.prefetch_distance > 0) {
+            pool.ForEachUnexpanded(batch_size, [this](const NodeId id) { graph_.PrefetchNeighbors(id); });
+        }
+        fresh_distances.resize(fresh_nodes.size());
+        TaskGroup compute_group;
+        executor_->SubmitRange(&compute_group, &distance_task, fresh_nodes.size(), kDistanceTaskGrain);
+        executor_->Wait(&compute_group);
+        const float threshold = reducer.Threshold();
+        for (std::size_t idx = 0; idx < fresh_nodes.size(); ++idx) {
+            const NodeId node_id = fresh_nodes[idx];
+            const bool passed = PassFilter(node_id, request);
+            local_stats.filtered_nodes += passed ? 0 : 1;
+            if (passed && fresh_distances[idx] < threshold) {
+                local_batch.push_back(
+                    Candidate{.id = node_id, .distance = fresh_distances[idx], .passed_filter = true});
+            }
+            pool.Insert(node_id, fresh_distances[idx]);
+        }
+        const auto reduce_start = std::chrono::steady_clock::now();
+        reducer.AbsorbBatch(local_batch);
+        local_batch.clear();
+        const auto compute_end = std::chrono::steady_clock::now();
+        Metrics().distance.Record(Nanos(compute_start, reduce_start));
+        Metrics().reduce.Record(Nanos(reduce_start, compute_end));
+        local_stats.visited += fresh_nodes.size();
+        local_stats.compute_us +=
+            std::chrono::duration_cast<std::chrono::microseconds>(compute_end - compute_start).count();
+    };
+
+    visited->TestAndSet(entrypoint);
+    fresh_nodes.push_back(entrypoint);
+    evaluate_fresh();
+
+    while (local_stats.visited < params.max_visit) {
+        pool.PopUnexpanded(batch_size, &expand_nodes);
+        if (expand_nodes.empty()) {
+            break;
+        }
+
+        const auto prefetch_start = std::chrono::steady_clock::now();
+        fresh_nodes.clear();
+        const std::size_t budget = params.max_visit - local_stats.visited;
+        for (std::size_t idx = 0; idx < expand_nodes.size() && fresh_nodes.size() < budget; ++idx) {
+            for (const NodeId neighbor : graph_.Neighbors(expand_nodes[idx])) {
+                if (fresh_nodes.size() == budget) {
+                    break;
+                }
+                if (visited->TestAndSet(neighbor)) {
+                    fresh_nodes.push_back(neighbor);
+                }
+            }
+        }
+        const std::uint64_t prefetch_ns = ann_common::NanosSince(prefetch_start);
+        Metrics().prefetch.Record(prefetch_ns);
+        local_stats.prefetch_us += prefetch_ns / 1000;
+
+        evaluate_fresh();
+    }
+
+    std::vector<Candidate> results = reducer.Finalize();
+    if (quantized) {
+        local_stats.reranked = results.size();
+        results = Rerank(request, std::move(results));
+    }
+    Metrics().RecordQuery(local_stats, ann_common::NanosSince(query_start));
+    if (stats) {
+        *stats = local_stats;
+    }
+    return ToL2Distances(std::move(results));
 }
 
-bool AsyncGraphSearcher::PassFilter(const NodeId node_id, const SearchRequest& request) const {
-    if (request.filter_bitmap.empty() || node_id >= request.filter_bitmap.size()) {
-        return true;
+std::vector<std::vector<Candidate>> AsyncGraphSearcher::SearchBatch(
+    const Span<const SearchRequest> requests,
+    const Span<const NodeId> entrypoints,
+    const SearchParams& params,
+    std::vector<SearchStats>* stats) const {
+    std::vector<std::vector<Candidate>> results(requests.size());
+    std::vector<SearchStats> local_stats(requests.size());
+    if (requests.empty() || (entrypoints.size() > 1 && entrypoints.size() != requests.size())) {
+        if (stats) {
+            *stats = std::move(local_stats);
+        }
+        return results;
+    }
+
+    const auto batch_start = std::chrono::steady_clock::now();
+    auto group_task = [&](const std::size_t begin, const std::size_t end) {
+        SearchBatchGroup(requests, entrypoints, begin, end, params, batch_start, &results, &local_stats);
+    };
+    // Lock-step groups share float rows across queries, while code tables are
+    // per query, so on codes every request runs its own best-first search.
+    auto single_task = [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t idx = begin; idx < end; ++idx) {
+            if (entrypoints.empty()) {
+                results[idx] = Search(requests[idx], params, &local_stats[idx]);
+            } else {
+                const NodeId entry = entrypoints.size() == 1 ? entrypoints[0] : entrypoints[idx];
+                results[idx] = Search(requests[idx], entry, params, &local_stats[idx]);
+            }
+            local_stats[idx].latency_us = ann_common::NanosSince(batch_start) / 1000;
+        }
+    };
+    if (params.use_codes && !codes_.Empty() && params.mode == SearchMode::kBestFirst) {
+        TaskGroup group;
+        executor_->SubmitRange(&group, &single_task, requests.size(), /*grain=*/1);
+        executor_->Wait(&group);
+        if (stats) {
+            *stats = std::move(local_stats);
+        }
+        return results;
+    }
+    TaskGroup group;
+    executor_->SubmitRange(&group, &group_task, requests.size(), kBatchGroupSize);
+    executor_->Wait(&group);
+
+    if (stats) {
+        *stats = std::move(local_stats);
+    }
+    return results;
+}
+
+void AsyncGraphSearcher::SearchBatchGroup(
+    const Span<const SearchRequest> requests,
+    const Span<const NodeId> entrypoints,
+    const std::size_t begin,
+    const std::size_t end,
+    const SearchParams& params,
+    const std::chrono::steady_clock::time_point batch_start,
+    std::vector<std::vector<Candidate>>* results,
+    std::vector<SearchStats>* stats) const {
+    const ScopedScratch<BatchScratch> scratch_guard;
+    BatchScratch& scratch = scratch_guard.Get();
+    const std::size_t count = end - begin;
+    const std::size_t dim = graph_.Dim();
+    const std::size_t batch_size = std::max<std::size_t>(1, params.batch_size);
+    if (scratch.queries.size() < count) {
+        scratch.queries.resize(count);
+    }
+    scratch.query_matrix.resize(count * dim);
+    scratch.pairs.clear();
+
+    for (std::size_t slot = 0; slot < count; ++slot) {
+        const SearchRequest& request = requests[begin + slot];
+        BatchQueryState& state = scratch.queries[slot];
+        state.active = !graph_.Empty() && request.query.size() == dim;
+        if (!state.active) {
+            continue;
+        }
+        if (PreferBruteForce(request, params)) {
+            state.active = false;
+            (*results)[begin + slot] = SearchFilteredBruteForce(request, &(*stats)[begin + slot]);
+            (*stats)[begin + slot].latency_us = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - batch_start)
+                    .count());
+            continue;
+        }
+        NodeId entry = 0;
+        if (entrypoints.empty()) {
+            entry = SelectEntryPoint(request.query, &(*stats)[begin + slot].entry_evaluations);
+        } else {
+            entry = entrypoints.size() == 1 ? entrypoints[0] : entrypoints[begin + slot];
+        }
+        if (entry >= graph_.Size()) {
+            state.active = false;
+            continue;
+        }
+        state.pool.Reset(std::max(params.ef, request.top_k));
+        state.reducer.Reset(request.top_k);
+        state.visited.Reset(graph_.Size());
+        state.visited.TestAndSet(entry);
+        std::copy(request.query.begin(), request.query.end(), scratch.query_matrix.begin() + slot * dim);
+        scratch.pairs.push_back(ScorePair{.node = entry, .slot = static_cast<std::uint32_t>(slot)});
+    }
+
+    // Scores all pending (node, query) pairs grouped by node: each embedding is
+    // loaded once and compared against every query that reached it.
+    auto score_pairs = [&]() {
+        const auto compute_start = std::chrono::steady_clock::now();
+        if (params.prefetch_distance > 0) {
+            for (std::size_t slot = 0; slot < count; ++slot) {
+                if (scratch.queries[slot].active) {
+                    scratch.queries[slot].pool.ForEachUnexpanded(
+                        batch_size, [this](const NodeId id) { graph_.PrefetchNeighbors(id); });
+                }
+            }
+        }
+        std::sort(scratch.pairs.begin(), scratch.pairs.end(), [](const ScorePair& lhs, const ScorePair& rhs) {
+            return lhs.node < rhs.node;
+        });
+        for (std::size_t run = 0; run < scratch.pairs.size();) {
+            const NodeId node = scratch.pairs[run].node;
+            // Runs are short, so hinting the pair `prefetch_distance` ahead keeps
+            // roughly that many embeddings in flight.
+            if (params.prefetch_distance > 0 && run + params.prefetch_distance < scratch.pairs.size()) {
+                graph_.PrefetchEmbedding(scratch.pairs[run + params.prefetch_distance].node);
+            }
+            scratch.run_slots.clear();
+            std::size_t run_end = run;
+            for (; run_end < scratch.pairs.size() && scratch.pairs[run_end].node == node; ++run_end) {
+                scratch.run_slots.push_back(scratch.pairs[run_end].slot);
+            }
+            scratch.run_distances.resize(scratch.run_slots.size());
+            ann_common::DistanceGather(
+                ann_common::Metric::kL2Sqr,
+                graph_.Embedding(node),
+                scratch.query_matrix.data(),
+                dim,
+                scratch.run_slots.data(),
+                scratch.run_slots.size(),
+                dim,
+                scratch.run_distances.data(),
+                /*prefetch_distance=*/0);  // query rows are already cached
+
+            for (std::size_t idx = 0; idx < scratch.run_slots.size(); ++idx) {
+                const std::uint32_t slot = scratch.run_slots[idx];
+                BatchQueryState& state = scratch.queries[slot];
+                const bool passed = PassFilter(node, requests[begin + slot]);
+                state.local_batch.push_back(
+                    Candidate{.id = node, .distance = scratch.run_distances[idx], .passed_filter = passed});
+                state.pool.Insert(node, scratch.run_distances[idx]);
+                (*stats)[begin + slot].filtered_nodes += passed ? 0 : 1;
+            }
+            run = run_end;
+        }
+
+        const auto reduce_start = std::chrono::steady_clock::now();
+        const std::uint64_t compute_ns = Nanos(compute_start, reduce_start);
+        Metrics().distance.Record(compute_ns);
+        for (std::size_t slot = 0; slot < count; ++slot) {
+            BatchQueryState& state = scratch.queries[slot];
+            if (!state.active) {
+                continue;
+            }
+            SearchStats& query_stats = (*stats)[begin + slot];
+            query_stats.visited += state.local_batch.size();
+            query_stats.compute_us += compute_ns / 1000;
+            state.reducer.AbsorbBatch(state.local_batch);
+            state.local_batch.clear();
+        }
+        Metrics().reduce.Record(ann_common::NanosSince(reduce_start));
+    };
+
+    auto finish = [&](const std::size_t slot) {
+        BatchQueryState& state = scratch.queries[slot];
+        state.active = false;
+        (*results)[begin + slot] = ToL2Distances(state.reducer.Finalize());
+        const std::uint64_t latency_ns = ann_common::NanosSince(batch_start);
+        (*stats)[begin + slot].latency_us = latency_ns / 1000;
+        Metrics().RecordQuery((*stats)[begin + slot], latency_ns);
+    };
+
+    score_pairs();
+    while (true) {
+        scratch.expand_union.clear();
+        for (std::size_t slot = 0; slot < count; ++slot) {
+            BatchQueryState& state = scratch.queries[slot];
+            if (!state.active) {
+                continue;
+            }
+            state.expand_nodes.clear();
+            if ((*stats)[begin + slot].visited < params.max_visit) {
+                state.pool.PopUnexpanded(batch_size, &state.expand_nodes);
+            }
+            if (state.expand_nodes.empty()) {
+                finish(slot);
+                continue;
+            }
+            scratch.expand_union.insert(
+                scratch.expand_union.end(), state.expand_nodes.begin(), state.expand_nodes.end());
+        }
+        if (scratch.expand_union.empty()) {
+            break;
+        }
+
+        // Each distinct node is fetched once per round, however many queries expand it.
+        const auto prefetch_start = std::chrono::steady_clock::now();
+        std::sort(scratch.expand_union.begin(), scratch.expand_union.end());
+        scratch.expand_union.erase(
+            std::unique(scratch.expand_union.begin(), scratch.expand_union.end()), scratch.expand_union.end());
+        scratch.union_neighbors.clear();
+        for (const NodeId node : scratch.expand_union) {
+            scratch.union_neighbors.push_back(graph_.Neighbors(node));
+        }
+
+        scratch.pairs.clear();
+        for (std::size_t slot = 0; slot < count; ++slot) {
+            BatchQueryState& state = scratch.queries[slot];
+            if (!state.active) {
+                continue;
+            }
+            const std::size_t budget = params.max_visit - (*stats)[begin + slot].visited;
+            std::size_t fresh = 0;
+            for (const NodeId node : state.expand_nodes) {
+                const auto pos = std::lower_bound(scratch.expand_union.begin(), scratch.expand_union.end(), node);
+                const auto& neighbors = scratch.union_neighbors[static_cast<std::size_t>(pos - scratch.expand_union.begin())];
+                for (const NodeId neighbor : neighbors) {
+                    if (fresh == budget) {
+                        break;
+                    }
+                    if (state.visited.TestAndSet(neighbor)) {
+                        scratch.pairs.push_back(ScorePair{.node = neighbor, .slot = static_cast<std::uint32_t>(slot)});
+                        ++fresh;
+                    }
+                }
+            }
+        }
+        const std::uint64_t prefetch_ns = ann_common::NanosSince(prefetch_start);
+        Metrics().prefetch.Record(prefetch_ns);
+        const std::uint64_t prefetch_us = prefetch_ns / 1000;
+        for (std::size_t slot = 0; slot < count; ++slot) {
+            if (scratch.queries[slot].active) {
+                (*stats)[begin + slot].prefetch_us += prefetch_us;
+            }
+        }
+
+        score_pairs();
     }
-    return request.filter_bitmap[node_id] == 1U;
 }
 
-std::vector<NodeId> AsyncGraphSearcher::PrefetchNeighbors(const NodeId node_id) const {
-    std::this_thread::sleep_for(std::chrono::microseconds(15));
-    return graph_[node_id].neighbors;
+std::vector<Candidate> AsyncGraphSearcher::SearchFilteredBruteForce(
+    const SearchRequest& request,
+    SearchStats* stats) const {
+    if (graph_.Empty() || request.query.size() != graph_.Dim()) {
+        return {};
+    }
+
+    const auto compute_start = std::chrono::steady_clock::now();
+    std::vector<NodeId> ids;
+    if (request.filter_bitmap.Empty()) {
+        ids.resize(graph_.Size());
+        for (std::size_t idx = 0; idx < ids.size(); ++idx) {
+            ids[idx] = static_cast<NodeId>(idx);
+        }
+    } else {
+        request.filter_bitmap.CollectIds(&ids);
+        ids.erase(std::lower_bound(ids.begin(), ids.end(), static_cast<NodeId>(graph_.Size())), ids.end());
+        for (std::size_t id = request.filter_bitmap.Universe(); id < graph_.Size(); ++id) {
+            ids.push_back(static_cast<NodeId>(id));
+        }
+    }
+
+    // Per-chunk partial top-k on the executor, merged at the end.
+    const std::size_t chunks = (ids.size() + kBruteForceChunk - 1) / kBruteForceChunk;
+    std::vector<TopKReducer> partials(chunks, TopKReducer(request.top_k));
+    std::vector<float> distances(ids.size());
+    auto scan_task = [&](const std::size_t begin, const std::size_t end) {
+        for (std::size_t chunk = begin; chunk < end; ++chunk) {
+            const std::size_t offset = chunk * kBruteForceChunk;
+            const std::size_t count = std::min(kBruteForceChunk, ids.size() - offset);
+            ann_common::DistanceGather(
+                ann_common::Metric::kL2Sqr,
+                request.query.data(),
+                graph_.Embedding(0),
+                graph_.Stride(),
+                ids.data() + offset,
+                count,
+                graph_.Dim(),
+                distances.data() + offset);
+            partials[chunk].AbsorbBlock(ids.data() + offset, distances.data() + offset, count);
+        }
+    };
+    TaskGroup scan_group;
+    executor_->SubmitRange(&scan_group, &scan_task, chunks, /*grain=*/1);
+    executor_->Wait(&scan_group);
+    const auto reduce_start = std::chrono::steady_clock::now();
+    Metrics().distance.Record(Nanos(compute_start, reduce_start));
+
+    TopKReducer reducer(request.top_k);
+    for (const TopKReducer& partial : partials) {
+        reducer.Merge(partial);
+    }
+    Metrics().reduce.Record(ann_common::NanosSince(reduce_start));
+
+    SearchStats local_stats;
+    local_stats.visited = ids.size();
+    local_stats.compute_us = ann_common::NanosSince(compute_start) / 1000;
+    Metrics().RecordQuery(local_stats, local_stats.compute_us * 1000);
+    if (stats) {
+        *stats = local_stats;
+    }
+    return ToL2Distances(std::move(reducer).Finalize());
+}
+
+bool AsyncGraphSearcher::PreferBruteForce(const SearchRequest& request, const SearchParams& params) const {
+    switch (params.filter_strategy) {
+        case FilterStrategy::kBruteForce:
+            return true;
+        case FilterStrategy::kGraph:
+            return false;
+        case FilterStrategy::kAuto:
+            break;
+    }
+    if (request.filter_bitmap.Empty()) {
+        return false;
+    }
+    // Ids at or beyond the bitmap universe pass as well.
+    const std::size_t uncovered =
+        graph_.Size() > request.filter_bitmap.Universe() ? graph_.Size() - request.filter_bitmap.Universe() : 0;
+    const std::size_t passing = request.filter_bitmap.Count() + uncovered;
+    const auto ratio_limit =
+        static_cast<std::size_t>(params.brute_force_pass_ratio * static_cast<double>(graph_.Size()));
+    return passing <= std::max(params.max_visit, ratio_limit);
+}
+
+std::vector<Candidate> AsyncGraphSearcher::Rerank(
+    const SearchRequest& request,
+    std::vector<Candidate> candidates) const {
+    const auto rerank_start = std::chrono::steady_clock::now();
+    std::vector<NodeId> ids(candidates.size());
+    std::vector<float> distances(candidates.size());
+    for (std::size_t idx = 0; idx < candidates.size(); ++idx) {
+        ids[idx] = candidates[idx].id;
+    }
+    GatherDistances(request.query.data(), ids.data(), ids.size(), kDefaultPrefetchDistance, distances.data());
+    for (std::size_t idx = 0; idx < candidates.size(); ++idx) {
+        candidates[idx].distance = distances[idx];
+    }
+    const std::size_t keep = std::min(request.top_k, candidates.size());
+    std::partial_sort(
+        candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(keep), candidates.end(),
+        [](const Candidate& lhs, const Candidate& rhs) { return lhs.distance < rhs.distance; });
+    candidates.resize(keep);
+    Metrics().rerank.Record(ann_common::NanosSince(rerank_start));
+    return candidates;
+}
+
+bool AsyncGraphSearcher::PassFilter(const NodeId node_id, const SearchRequest& request) const {
+    return request.filter_bitmap.Contains(node_id);
+}
+
+void AsyncGraphSearcher::GatherDistances(
+    const float* query,
+    const NodeId* ids,
+    const std::size_t count,
+    const std::size_t prefetch_distance,
+    float* out) const {
+    // The gather hints rows `prefetch_distance` ahead; the first ones of this
+    // task are issued here so their misses overlap instead of serializing.
+    for (std::size_t idx = 0; idx < std::min(prefetch_distance, count); ++idx) {
+        graph_.PrefetchEmbedding(ids[idx]);
+    }
+    ann_common::DistanceGather(
+        ann_common::Metric::kL2Sqr,
+        query,
+        graph_.Embedding(0),
+        graph_.Stride(),
+        ids,
+        count,
+        graph_.Dim(),
+        out,
+        prefetch_distance);
 }
 
 }  // namespace knowhere_demo
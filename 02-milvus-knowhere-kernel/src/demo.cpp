@@ -1,17 +1,49 @@
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <cstdlib>
 #include <iomanip>
 #include <iostream>
+#include <new>
 #include <random>
+#include <string>
 #include <vector>
 
 #include "async_graph_searcher.h"
+#include "metrics.h"
+#include "vamana_builder.h"
 
 namespace {
 
+std::atomic<std::size_t> g_allocations{0};
+
+}  // namespace
+
+// Counts heap allocations so the demo can report allocations per query.
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+using knowhere_demo::Candidate;
+using knowhere_demo::FlatGraph;
 using knowhere_demo::GraphNode;
 using knowhere_demo::NodeId;
+using knowhere_demo::SearchRequest;
 
 std::vector<float> RandomEmbedding(std::mt19937* rng, std::size_t dim) {
     std::uniform_real_distribution<float> dist(0.0F, 1.0F);
@@ -46,6 +78,82 @@ std::vector<GraphNode> BuildRandomGraph(std::size_t n, std::size_t dim, std::siz
     return graph;
 }
 
+float SquaredL2(const float* lhs, const float* rhs, std::size_t dim) {
+    float sum = 0.0F;
+    for (std::size_t idx = 0; idx < dim; ++idx) {
+        const float diff = lhs[idx] - rhs[idx];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+// BFS + distance walk over the legacy per-node layout. Paired with ScanFlatGraph
+// (same visit order, no simulated prefetch delay) to isolate the layout cost.
+float ScanNodeList(const std::vector<GraphNode>& nodes, const std::vector<float>& query, NodeId entry, std::size_t max_visit) {
+    std::vector<std::uint8_t> seen(nodes.size(), 0U);
+    std::vector<NodeId> frontier{entry};
+    seen[entry] = 1U;
+    float checksum = 0.0F;
+    for (std::size_t head = 0; head < frontier.size() && head < max_visit; ++head) {
+        const GraphNode& node = nodes[frontier[head]];
+        checksum += SquaredL2(query.data(), node.embedding.data(), query.size());
+        for (const NodeId neighbor : node.neighbors) {
+            if (seen[neighbor] == 0U) {
+                seen[neighbor] = 1U;
+                frontier.push_back(neighbor);
+            }
+        }
+    }
+    return checksum;
+}
+
+float ScanFlatGraph(const FlatGraph& graph, const std::vector<float>& query, NodeId entry, std::size_t max_visit) {
+    std::vector<std::uint8_t> seen(graph.Size(), 0U);
+    std::vector<NodeId> frontier{entry};
+    seen[entry] = 1U;
+    float checksum = 0.0F;
+    for (std::size_t head = 0; head < frontier.size() && head < max_visit; ++head) {
+        const NodeId id = frontier[head];
+        checksum += SquaredL2(query.data(), graph.Embedding(id), graph.Dim());
+        for (const NodeId neighbor : graph.Neighbors(id)) {
+            if (seen[neighbor] == 0U) {
+                seen[neighbor] = 1U;
+                frontier.push_back(neighbor);
+            }
+        }
+    }
+    return checksum;
+}
+
+std::vector<NodeId> BruteForceTopK(const std::vector<GraphNode>& nodes, const SearchRequest& request) {
+    std::vector<std::pair<float, NodeId>> scored;
+    scored.reserve(nodes.size());
+    for (const GraphNode& node : nodes) {
+        if (!request.filter_bitmap.Contains(node.id)) {
+            continue;
+        }
+        scored.emplace_back(SquaredL2(request.query.data(), node.embedding.data(), request.query.size()), node.id);
+    }
+    const std::size_t keep = std::min(request.top_k, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + static_cast<long>(keep), scored.end());
+    std::vector<NodeId> ids;
+    for (std::size_t idx = 0; idx < keep; ++idx) {
+        ids.push_back(scored[idx].second);
+    }
+    return ids;
+}
+
+double Recall(const std::vector<Candidate>& result, const std::vector<NodeId>& truth) {
+    if (truth.empty()) {
+        return 1.0;
+    }
+    std::size_t hits = 0;
+    for (const Candidate& candidate : result) {
+        hits += std::count(truth.begin(), truth.end(), candidate.id) > 0 ? 1 : 0;
+    }
+    return static_cast<double>(hits) / static_cast<double>(truth.size());
+}
+
 std::uint64_t Percentile(std::vector<std::uint64_t> values, double p) {
     if (values.empty()) {
         return 0;
@@ -57,7 +165,7 @@ std::uint64_t Percentile(std::vector<std::uint64_t> values, double p) {
 
 }  // namespace
 
-int main() {
+int main(int argc, char** argv) {
     using knowhere_demo::AsyncGraphSearcher;
     using knowhere_demo::SearchRequest;
     using knowhere_demo::SearchStats;
@@ -67,15 +175,17 @@ int main() {
     constexpr std::size_t kDegree = 16;
     constexpr std::size_t kRounds = 60;
 
-    AsyncGraphSearcher searcher(BuildRandomGraph(kNodeCount, kDim, kDegree));
+    const std::vector<GraphNode> nodes = BuildRandomGraph(kNodeCount, kDim, kDegree);
+    AsyncGraphSearcher searcher(nodes);
 
     SearchRequest request;
     request.query = std::vector<float>(kDim, 0.45F);
     request.top_k = 10;
-    request.filter_bitmap = std::vector<std::uint8_t>(kNodeCount, 1U);
+    std::vector<std::uint8_t> filter_bytes(kNodeCount, 1U);
     for (std::size_t i = 0; i < kNodeCount; i += 11) {
-        request.filter_bitmap[i] = 0U;
+        filter_bytes[i] = 0U;
     }
+    request.filter_bitmap = knowhere_demo::FilterBitmap::FromBytes(filter_bytes);
 
     std::vector<std::uint64_t> baseline_latency;
     std::vector<std::uint64_t> optimized_latency;
@@ -84,13 +194,27 @@ int main() {
 
     SearchStats baseline_stats;
     SearchStats optimized_stats;
+    std::size_t baseline_allocs = 0;
+    std::size_t optimized_allocs = 0;
+
+    std::vector<std::uint64_t> node_list_latency;
+    std::vector<std::uint64_t> flat_latency;
+    float scan_checksum = 0.0F;
+
+    // The first searches on a thread size its scratch and register the stage
+    // metrics; keep that one-time cost out of the per-query numbers.
+    (void)searcher.SearchBaseline(request, /*entrypoint=*/0, /*max_visit=*/700);
+    (void)searcher.SearchOptimized(request, /*entrypoint=*/0, /*max_visit=*/700, /*batch_size=*/64);
 
     for (std::size_t round = 0; round < kRounds; ++round) {
+        const std::size_t allocs_before_base = g_allocations.load();
         const auto start_base = std::chrono::steady_clock::now();
         auto base_res = searcher.SearchBaseline(request, /*entrypoint=*/round % 100, /*max_visit=*/700, &baseline_stats);
         (void)base_res;
         const auto end_base = std::chrono::steady_clock::now();
+        baseline_allocs += g_allocations.load() - allocs_before_base;
 
+        const std::size_t allocs_before_opt = g_allocations.load();
         const auto start_opt = std::chrono::steady_clock::now();
         auto opt_res = searcher.SearchOptimized(
             request,
@@ -100,11 +224,23 @@ int main() {
             &optimized_stats);
         (void)opt_res;
         const auto end_opt = std::chrono::steady_clock::now();
+        optimized_allocs += g_allocations.load() - allocs_before_opt;
 
         baseline_latency.push_back(
             std::chrono::duration_cast<std::chrono::microseconds>(end_base - start_base).count());
         optimized_latency.push_back(
             std::chrono::duration_cast<std::chrono::microseconds>(end_opt - start_opt).count());
+
+        const auto start_list = std::chrono::steady_clock::now();
+        scan_checksum += ScanNodeList(nodes, request.query, round % 100, /*max_visit=*/kNodeCount);
+        const auto end_list = std::chrono::steady_clock::now();
+        scan_checksum -= ScanFlatGraph(searcher.Graph(), request.query, round % 100, /*max_visit=*/kNodeCount);
+        const auto end_flat = std::chrono::steady_clock::now();
+
+        node_list_latency.push_back(
+            std::chrono::duration_cast<std::chrono::microseconds>(end_list - start_list).count());
+        flat_latency.push_back(
+            std::chrono::duration_cast<std::chrono::microseconds>(end_flat - end_list).count());
     }
 
     const auto base_p50 = Percentile(baseline_latency, 0.5);
@@ -121,6 +257,132 @@ int main() {
               << " filtered=" << optimized_stats.filtered_nodes
               << " prefetch_us=" << optimized_stats.prefetch_us
               << " compute_us=" << optimized_stats.compute_us << "\n";
+    std::cout << "Heap allocations/query: baseline=" << baseline_allocs / kRounds
+              << " optimized=" << optimized_allocs / kRounds << " (the returned top-k vector)\n";
+    std::cout << "Layout memory(bytes): node_list=" << knowhere_demo::EstimateNodeListBytes(nodes)
+              << " flat=" << searcher.Graph().MemoryBytes() << "\n";
+    std::cout << "Layout scan latency(us): node_list p95=" << Percentile(node_list_latency, 0.95)
+              << " flat p95=" << Percentile(flat_latency, 0.95)
+              << " (checksum delta=" << std::setprecision(3) << scan_checksum << ")\n";
 
+
+    // Recall against brute force when BFS and best-first get the same visit budget.
+    // The random graph above has no relation to vector similarity, so build a
+    // navigable Vamana graph over the same vectors; the searcher picks each
+    // query's entry by descending its HNSW-style upper layers.
+    std::vector<std::vector<float>> vectors;
+    vectors.reserve(nodes.size());
+    for (const GraphNode& node : nodes) {
+        vectors.push_back(node.embedding);
+    }
+    auto vamana = knowhere_demo::VamanaBuilder({.max_degree = 16, .build_list_size = 48}).Build(vectors);
+    AsyncGraphSearcher knn_searcher(std::move(vamana.graph));
+    knn_searcher.BuildEntryPoints();
+    constexpr std::size_t kRecallQueries = 10;
+    std::mt19937 query_rng(7);
+    std::vector<SearchRequest> recall_requests;
+    std::vector<std::vector<NodeId>> ground_truth;
+    for (std::size_t q = 0; q < kRecallQueries; ++q) {
+        SearchRequest recall_request = request;
+        recall_request.query = RandomEmbedding(&query_rng, kDim);
+        ground_truth.push_back(BruteForceTopK(nodes, recall_request));
+        recall_requests.push_back(std::move(recall_request));
+    }
+    std::cout << "Recall@" << request.top_k << " at equal visit budget on a Vamana graph (BFS vs best-first):\n";
+    for (const std::size_t budget : {200UL, 700UL, 1500UL}) {
+        double bfs_recall = 0.0;
+        double best_recall = 0.0;
+        std::size_t bfs_visited = 0;
+        std::size_t best_visited = 0;
+        for (std::size_t q = 0; q < kRecallQueries; ++q) {
+            SearchStats bfs_stats;
+            SearchStats best_stats;
+            const NodeId entry = knn_searcher.SelectEntryPoint(recall_requests[q].query);
+            const auto bfs_res = knn_searcher.SearchOptimized(recall_requests[q], entry, budget, /*batch_size=*/64, &bfs_stats);
+            const auto best_res = knn_searcher.SearchBestFirst(
+                recall_requests[q],
+                entry,
+                knowhere_demo::SearchParams{.max_visit = budget, .batch_size = 8, .ef = budget / 4},
+                &best_stats);
+            bfs_recall += Recall(bfs_res, ground_truth[q]);
+            best_recall += Recall(best_res, ground_truth[q]);
+            bfs_visited += bfs_stats.visited;
+            best_visited += best_stats.visited;
+        }
+        std::cout << "  budget=" << budget << " bfs: visited=" << bfs_visited / kRecallQueries
+                  << " recall=" << std::setprecision(3) << bfs_recall / kRecallQueries
+                  << " | best-first: visited=" << best_visited / kRecallQueries
+                  << " recall=" << best_recall / kRecallQueries << "\n";
+    }
+
+    // Micro-batch serving: serial best-first vs SearchBatch on the same queries.
+    constexpr std::size_t kServeQueries = 64;
+    constexpr std::size_t kMicroBatch = 16;
+    const knowhere_demo::SearchParams serve_params{.max_visit = 700, .batch_size = 8, .ef = 128};
+    std::vector<SearchRequest> serve_requests;
+    for (std::size_t q = 0; q < kServeQueries; ++q) {
+        SearchRequest serve_request = request;
+        serve_request.query = RandomEmbedding(&query_rng, kDim);
+        serve_requests.push_back(std::move(serve_request));
+    }
+
+    std::vector<std::uint64_t> serial_latency;
+    std::vector<std::vector<Candidate>> serial_results;
+    const auto serial_start = std::chrono::steady_clock::now();
+    for (const SearchRequest& serve_request : serve_requests) {
+        const auto start = std::chrono::steady_clock::now();
+        serial_results.push_back(knn_searcher.Search(serve_request, serve_params));
+        serial_latency.push_back(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+    const auto serial_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - serial_start).count();
+
+    std::vector<std::uint64_t> batch_latency;
+    std::size_t identical = 0;
+    const auto batch_start = std::chrono::steady_clock::now();
+    for (std::size_t offset = 0; offset < kServeQueries; offset += kMicroBatch) {
+        std::vector<SearchStats> batch_stats;
+        const auto batch_results = knn_searcher.SearchBatch(
+            knowhere_demo::Span<const SearchRequest>(serve_requests.data() + offset, kMicroBatch),
+            /*entrypoints=*/{},
+            serve_params,
+            &batch_stats);
+        for (std::size_t idx = 0; idx < kMicroBatch; ++idx) {
+            batch_latency.push_back(batch_stats[idx].latency_us);
+            const auto& expected = serial_results[offset + idx];
+            identical += std::equal(
+                             expected.begin(),
+                             expected.end(),
+                             batch_results[idx].begin(),
+                             batch_results[idx].end(),
+                             [](const Candidate& lhs, const Candidate& rhs) { return lhs.id == rhs.id; })
+                             ? 1
+                             : 0;
+        }
+    }
+    const auto batch_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - batch_start).count();
+
+    const auto qps = [](std::size_t queries, std::int64_t us) {
+        return us > 0 ? static_cast<double>(queries) * 1e6 / static_cast<double>(us) : 0.0;
+    };
+    std::cout << "Serving " << kServeQueries << " queries:\n";
+    std::cout << "  serial best-first: qps=" << std::setprecision(1) << qps(kServeQueries, serial_us)
+              << " p50=" << Percentile(serial_latency, 0.5) << "us p95=" << Percentile(serial_latency, 0.95)
+              << "us\n";
+    std::cout << "  SearchBatch(" << kMicroBatch << "): qps=" << qps(kServeQueries, batch_us)
+              << " p50=" << Percentile(batch_latency, 0.5) << "us p95=" << Percentile(batch_latency, 0.95)
+              << "us identical_results=" << identical << "/" << kServeQueries << "\n";
+
+    std::cout << "Stage latency over all searches above (us):\n";
+    for (const char* stage : {"prefetch", "distance", "topk_reduce", "query"}) {
+        const auto snapshot = ann_common::StageLatency("knowhere", stage).Snap();
+        std::cout << "  " << stage << ": count=" << snapshot.count << " p50<=" << std::setprecision(1)
+                  << snapshot.ValueAtQuantile(0.5) / 1e3 << " p99<=" << snapshot.ValueAtQuantile(0.99) / 1e3 << "\n";
+    }
+    if (argc > 1 && std::string(argv[1]) == "--metrics") {
+        std::cout << ann_common::MetricsRegistry::Global().DumpPrometheus();
+    }
     return 0;
 }
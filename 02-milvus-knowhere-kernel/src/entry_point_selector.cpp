@@ -0,0 +1,144 @@
+#include "entry_point_selector.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+#include "distance.h"
+#include "kmeans.h"
+#include "vamana_builder.h"
+
+namespace knowhere_demo {
+
+namespace {
+
+// Training rows per centroid; more adds build time without moving entries much.
+constexpr std::size_t kKMeansSamplesPerCentroid = 256;
+
+NodeId NearestNode(const FlatGraph& graph, const float* target, std::vector<float>* distances) {
+    distances->resize(graph.Size());
+    ann_common::DistanceBatch(
+        ann_common::Metric::kL2Sqr, target, graph.Embedding(0), graph.Size(), graph.Dim(), graph.Stride(), distances->data());
+    return static_cast<NodeId>(std::min_element(distances->begin(), distances->end()) - distances->begin());
+}
+
+std::vector<float> GatherRows(const FlatGraph& graph, const NodeId* ids, const std::size_t count) {
+    std::vector<float> rows(count * graph.Dim());
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        const float* row = graph.Embedding(ids[idx]);
+        std::copy(row, row + graph.Dim(), rows.begin() + idx * graph.Dim());
+    }
+    return rows;
+}
+
+}  // namespace
+
+EntryPointSelector EntryPointSelector::Build(const FlatGraph& graph, const EntryPointOptions& options) {
+    EntryPointSelector selector;
+    selector.mode_ = options.mode;
+    selector.dim_ = graph.Dim();
+    if (graph.Empty()) {
+        return selector;
+    }
+
+    const std::size_t count = graph.Size();
+    const std::size_t dim = graph.Dim();
+    std::vector<double> sum(dim, 0.0);
+    for (NodeId id = 0; id < count; ++id) {
+        const float* row = graph.Embedding(id);
+        for (std::size_t d = 0; d < dim; ++d) {
+            sum[d] += row[d];
+        }
+    }
+    std::vector<float> mean(dim);
+    for (std::size_t d = 0; d < dim; ++d) {
+        mean[d] = static_cast<float>(sum[d] / static_cast<double>(count));
+    }
+    std::vector<float> distances;
+    selector.medoid_ = NearestNode(graph, mean.data(), &distances);
+
+    std::mt19937 rng(options.seed);
+    if (options.mode == EntryPointMode::kHierarchy) {
+        selector.members_.resize(count);
+        std::iota(selector.members_.begin(), selector.members_.end(), 0);
+        std::shuffle(selector.members_.begin(), selector.members_.end(), rng);
+
+        const std::size_t fanout = std::max<std::size_t>(2, options.level_fanout);
+        const VamanaBuilder builder({
+            .max_degree = options.layer_degree,
+            .build_list_size = 2 * options.layer_degree,
+            .seed = options.seed,
+        });
+        for (std::size_t size = count / fanout; size >= 2; size /= fanout) {
+            const std::vector<float> rows = GatherRows(graph, selector.members_.data(), size);
+            VamanaIndex layer = builder.Build(rows.data(), size, dim);
+            selector.top_entry_ = layer.medoid;
+            selector.layers_.push_back(std::move(layer.graph));
+        }
+        if (selector.layers_.empty()) {
+            selector.members_.clear();
+        }
+    } else if (options.mode == EntryPointMode::kCentroids) {
+        std::vector<NodeId> sample(count);
+        std::iota(sample.begin(), sample.end(), 0);
+        std::shuffle(sample.begin(), sample.end(), rng);
+        sample.resize(std::min(count, options.num_centroids * kKMeansSamplesPerCentroid));
+        const std::vector<float> rows = GatherRows(graph, sample.data(), sample.size());
+
+        selector.centroids_ = ann_common::TrainKMeans(
+            rows.data(), sample.size(), dim, dim, options.num_centroids, options.kmeans_iterations, options.seed);
+        const std::size_t num_centroids = selector.centroids_.size() / std::max<std::size_t>(1, dim);
+        selector.centroid_entries_.reserve(num_centroids);
+        for (std::size_t c = 0; c < num_centroids; ++c) {
+            selector.centroid_entries_.push_back(NearestNode(graph, selector.centroids_.data() + c * dim, &distances));
+        }
+    }
+    return selector;
+}
+
+NodeId EntryPointSelector::Select(const float* query, std::size_t* evaluations) const {
+    std::size_t evaluated = 0;
+    NodeId entry = medoid_;
+    if (mode_ == EntryPointMode::kHierarchy && !layers_.empty()) {
+        // Greedy descent: move to the closest neighbor until no neighbor is
+        // closer, then drop a layer keeping the same local id.
+        NodeId current = top_entry_;
+        float current_distance = ann_common::L2Sqr(query, layers_.back().Embedding(current), dim_);
+        ++evaluated;
+        for (auto layer = layers_.rbegin(); layer != layers_.rend(); ++layer) {
+            bool improved = true;
+            while (improved) {
+                improved = false;
+                for (const NodeId neighbor : layer->Neighbors(current)) {
+                    const float distance = ann_common::L2Sqr(query, layer->Embedding(neighbor), dim_);
+                    ++evaluated;
+                    if (distance < current_distance) {
+                        current = neighbor;
+                        current_distance = distance;
+                        improved = true;
+                    }
+                }
+            }
+        }
+        entry = members_[current];
+    } else if (mode_ == EntryPointMode::kCentroids && !centroid_entries_.empty()) {
+        const std::size_t k = centroid_entries_.size();
+        entry = centroid_entries_[ann_common::NearestCentroid(centroids_.data(), k, dim_, query)];
+        evaluated = k;
+    }
+    if (evaluations) {
+        *evaluations = evaluated;
+    }
+    return entry;
+}
+
+std::size_t EntryPointSelector::MemoryBytes() const {
+    std::size_t bytes = members_.capacity() * sizeof(NodeId) + centroids_.capacity() * sizeof(float) +
+                        centroid_entries_.capacity() * sizeof(NodeId);
+    for (const FlatGraph& layer : layers_) {
+        bytes += layer.MemoryBytes();
+    }
+    return bytes;
+}
+
+}  // namespace knowhere_demo
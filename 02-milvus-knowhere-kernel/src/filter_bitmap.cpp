@@ -0,0 +1,123 @@
+#include "filter_bitmap.h"
+
+#include <algorithm>
+
+namespace knowhere_demo {
+
+FilterBitmap FilterBitmap::FromBytes(const std::vector<std::uint8_t>& bytes) {
+    std::vector<std::uint32_t> ids;
+    for (std::size_t idx = 0; idx < bytes.size(); ++idx) {
+        if (bytes[idx] == 1U) {
+            ids.push_back(static_cast<std::uint32_t>(idx));
+        }
+    }
+    return FromIds(bytes.size(), ids);
+}
+
+FilterBitmap FilterBitmap::FromIds(const std::size_t universe, const std::vector<std::uint32_t>& ids) {
+    // An array entry costs 16 bits, a packed entry costs 1 bit per node.
+    const bool sparse = ids.size() * 16 < universe;
+    return FromIds(universe, ids, sparse ? Encoding::kRoaring : Encoding::kPacked);
+}
+
+FilterBitmap FilterBitmap::FromIds(
+    const std::size_t universe,
+    const std::vector<std::uint32_t>& ids,
+    const Encoding encoding) {
+    FilterBitmap bitmap;
+    bitmap.encoding_ = encoding;
+    bitmap.universe_ = universe;
+    bitmap.count_ = ids.size();
+
+    if (encoding == Encoding::kPacked) {
+        bitmap.words_.assign((universe + 63) / 64, 0);
+        for (const std::uint32_t id : ids) {
+            bitmap.words_[id >> 6] |= std::uint64_t{1} << (id & 63U);
+        }
+        return bitmap;
+    }
+
+    bitmap.containers_.resize((universe + (std::size_t{1} << kChunkBits) - 1) >> kChunkBits);
+    std::size_t begin = 0;
+    while (begin < ids.size()) {
+        const std::uint32_t chunk = ids[begin] >> kChunkBits;
+        std::size_t end = begin;
+        while (end < ids.size() && (ids[end] >> kChunkBits) == chunk) {
+            ++end;
+        }
+
+        Container& container = bitmap.containers_[chunk];
+        if (end - begin > kArrayLimit) {
+            container.bits.assign(kChunkWords, 0);
+            for (std::size_t idx = begin; idx < end; ++idx) {
+                const std::uint32_t low = ids[idx] & 0xFFFFU;
+                container.bits[low >> 6] |= std::uint64_t{1} << (low & 63U);
+            }
+        } else {
+            container.array.reserve(end - begin);
+            for (std::size_t idx = begin; idx < end; ++idx) {
+                container.array.push_back(static_cast<std::uint16_t>(ids[idx] & 0xFFFFU));
+            }
+        }
+        begin = end;
+    }
+    return bitmap;
+}
+
+double FilterBitmap::PassRatio() const {
+    if (universe_ == 0) {
+        return 1.0;
+    }
+    return static_cast<double>(count_) / static_cast<double>(universe_);
+}
+
+std::size_t FilterBitmap::MemoryBytes() const {
+    std::size_t bytes = words_.capacity() * sizeof(std::uint64_t) + containers_.capacity() * sizeof(Container);
+    for (const Container& container : containers_) {
+        bytes += container.array.capacity() * sizeof(std::uint16_t);
+        bytes += container.bits.capacity() * sizeof(std::uint64_t);
+    }
+    return bytes;
+}
+
+void FilterBitmap::CollectIds(std::vector<std::uint32_t>* ids) const {
+    ids->reserve(ids->size() + count_);
+    if (encoding_ == Encoding::kPacked) {
+        for (std::size_t word_idx = 0; word_idx < words_.size(); ++word_idx) {
+            std::uint64_t word = words_[word_idx];
+            while (word != 0) {
+                const int bit = __builtin_ctzll(word);
+                ids->push_back(static_cast<std::uint32_t>(word_idx * 64 + static_cast<std::size_t>(bit)));
+                word &= word - 1;
+            }
+        }
+        return;
+    }
+
+    for (std::size_t chunk = 0; chunk < containers_.size(); ++chunk) {
+        const Container& container = containers_[chunk];
+        const auto base = static_cast<std::uint32_t>(chunk << kChunkBits);
+        for (const std::uint16_t low : container.array) {
+            ids->push_back(base | low);
+        }
+        for (std::size_t word_idx = 0; word_idx < container.bits.size(); ++word_idx) {
+            std::uint64_t word = container.bits[word_idx];
+            while (word != 0) {
+                const int bit = __builtin_ctzll(word);
+                ids->push_back(base | static_cast<std::uint32_t>(word_idx * 64 + static_cast<std::size_t>(bit)));
+                word &= word - 1;
+            }
+        }
+    }
+}
+
+bool FilterBitmap::ContainsRoaring(const std::uint32_t id) const {
+    const Container& container = containers_[id >> kChunkBits];
+    const auto low = static_cast<std::uint16_t>(id & 0xFFFFU);
+    if (!container.bits.empty()) {
+        return (container.bits[low >> 6] >> (low & 63U) & 1U) != 0;
+    }
+    return std::binary_search(container.array.begin(), container.array.end(), low);
+}
+
+}  // namespace knowhere_demo
@@ -0,0 +1,154 @@
+#include "flat_graph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace knowhere_demo {
+
+struct FlatGraph::HeapStorage {
+    std::vector<float, AlignedAllocator<float, kAlignment>> embeddings;
+    std::vector<std::uint64_t> offsets;
+    std::vector<NodeId> adjacency;
+};
+
+namespace {
+
+std::size_t PaddedStride(const std::size_t dim) {
+    constexpr std::size_t kFloatsPerLine = FlatGraph::kAlignment / sizeof(float);
+    return (dim + kFloatsPerLine - 1) / kFloatsPerLine * kFloatsPerLine;
+}
+
+}  // namespace
+
+FlatGraph FlatGraph::FromHeap(std::shared_ptr<HeapStorage> storage, const std::size_t dim, const std::size_t stride) {
+    FlatGraph graph;
+    graph.size_ = storage->offsets.empty() ? 0 : storage->offsets.size() - 1;
+    graph.dim_ = dim;
+    graph.stride_ = stride;
+    graph.edge_count_ = storage->adjacency.size();
+    graph.memory_bytes_ = storage->embeddings.capacity() * sizeof(float) +
+                          storage->offsets.capacity() * sizeof(std::uint64_t) +
+                          storage->adjacency.capacity() * sizeof(NodeId);
+    graph.embeddings_ = storage->embeddings.data();
+    graph.offsets_ = storage->offsets.data();
+    graph.adjacency_ = storage->adjacency.data();
+    graph.storage_ = std::move(storage);
+    return graph;
+}
+
+FlatGraph FlatGraph::FromNodes(const std::vector<GraphNode>& nodes) {
+    if (nodes.empty()) {
+        return {};
+    }
+
+    const std::size_t count = nodes.size();
+    const std::size_t dim = nodes.front().embedding.size();
+    const std::size_t stride = PaddedStride(dim);
+
+    std::vector<const GraphNode*> by_id(count, nullptr);
+    std::size_t edge_count = 0;
+    for (const GraphNode& node : nodes) {
+        if (node.id >= count || by_id[node.id] != nullptr) {
+            throw std::invalid_argument("FlatGraph node ids must be dense and unique");
+        }
+        if (node.embedding.size() != dim) {
+            throw std::invalid_argument("FlatGraph embedding dim mismatch");
+        }
+        by_id[node.id] = &node;
+        edge_count += node.neighbors.size();
+    }
+
+    auto storage = std::make_shared<HeapStorage>();
+    storage->embeddings.assign(count * stride, 0.0F);
+    storage->offsets.reserve(count + 1);
+    storage->adjacency.reserve(edge_count);
+    storage->offsets.push_back(0);
+    for (std::size_t id = 0; id < count; ++id) {
+        const GraphNode& node = *by_id[id];
+        std::copy(node.embedding.begin(), node.embedding.end(), storage->embeddings.begin() + id * stride);
+        for (const NodeId neighbor : node.neighbors) {
+            if (neighbor < count) {
+                storage->adjacency.push_back(neighbor);
+            }
+        }
+        storage->offsets.push_back(storage->adjacency.size());
+    }
+    storage->adjacency.shrink_to_fit();
+    return FromHeap(std::move(storage), dim, stride);
+}
+
+FlatGraph FlatGraph::FromAdjacency(
+    const float* vectors,
+    const std::size_t count,
+    const std::size_t dim,
+    const std::vector<std::vector<NodeId>>& adjacency) {
+    if (adjacency.size() != count) {
+        throw std::invalid_argument("FlatGraph adjacency size mismatch");
+    }
+
+    const std::size_t stride = PaddedStride(dim);
+    auto storage = std::make_shared<HeapStorage>();
+    storage->embeddings.assign(count * stride, 0.0F);
+    storage->offsets.reserve(count + 1);
+    storage->offsets.push_back(0);
+
+    std::size_t edge_count = 0;
+    for (const auto& neighbors : adjacency) {
+        edge_count += neighbors.size();
+    }
+    storage->adjacency.reserve(edge_count);
+    for (std::size_t id = 0; id < count; ++id) {
+        std::copy(vectors + id * dim, vectors + (id + 1) * dim, storage->embeddings.begin() + id * stride);
+        for (const NodeId neighbor : adjacency[id]) {
+            if (neighbor < count) {
+                storage->adjacency.push_back(neighbor);
+            }
+        }
+        storage->offsets.push_back(storage->adjacency.size());
+    }
+    return FromHeap(std::move(storage), dim, stride);
+}
+
+FlatGraph FlatGraph::Permute(const std::vector<NodeId>& new_to_old) const {
+    if (new_to_old.size() != size_) {
+        throw std::invalid_argument("FlatGraph permutation size mismatch");
+    }
+    std::vector<NodeId> old_to_new(size_, static_cast<NodeId>(size_));
+    for (std::size_t new_id = 0; new_id < size_; ++new_id) {
+        const NodeId old_id = new_to_old[new_id];
+        if (old_id >= size_ || old_to_new[old_id] != size_) {
+            throw std::invalid_argument("FlatGraph permutation must list every node once");
+        }
+        old_to_new[old_id] = static_cast<NodeId>(new_id);
+    }
+    if (Empty()) {
+        return {};
+    }
+
+    auto storage = std::make_shared<HeapStorage>();
+    storage->embeddings.resize(size_ * stride_);
+    storage->offsets.reserve(size_ + 1);
+    storage->adjacency.reserve(edge_count_);
+    storage->offsets.push_back(0);
+    for (std::size_t new_id = 0; new_id < size_; ++new_id) {
+        const NodeId old_id = new_to_old[new_id];
+        const float* row = Embedding(old_id);
+        std::copy(row, row + stride_, storage->embeddings.begin() + new_id * stride_);
+        for (const NodeId neighbor : Neighbors(old_id)) {
+            storage->adjacency.push_back(old_to_new[neighbor]);
+        }
+        storage->offsets.push_back(storage->adjacency.size());
+    }
+    return FromHeap(std::move(storage), dim_, stride_);
+}
+
+std::size_t EstimateNodeListBytes(const std::vector<GraphNode>& nodes) {
+    std::size_t bytes = nodes.capacity() * sizeof(GraphNode);
+    for (const GraphNode& node : nodes) {
+        bytes += node.embedding.capacity() * sizeof(float);
+        bytes += node.neighbors.capacity() * sizeof(NodeId);
+    }
+    return bytes;
+}
+
+}  // namespace knowhere_demo
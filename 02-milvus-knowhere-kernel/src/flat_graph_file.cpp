@@ -0,0 +1,297 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "flat_graph.h"
+
+namespace knowhere_demo {
+
+namespace {
+
+constexpr char kMagic[8] = {'K', 'N', 'W', 'G', 'R', 'A', 'P', 'H'};
+constexpr std::uint32_t kVersion = 1;
+
+// All fields in native byte order. Sections start at 64-byte aligned offsets,
+// so a page-aligned mapping keeps embedding rows cache-line aligned.
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_bytes;
+    std::uint64_t node_count;
+    std::uint64_t dim;
+    std::uint64_t stride;
+    std::uint64_t edge_count;
+    std::uint64_t embeddings_offset;
+    std::uint64_t offsets_offset;
+    std::uint64_t adjacency_offset;
+    std::uint64_t file_bytes;
+    std::uint64_t checksum;
+    std::uint64_t reserved[5];
+};
+static_assert(sizeof(FileHeader) == 128, "graph file header must stay 128 bytes");
+
+std::uint64_t AlignUp(const std::uint64_t value) {
+    return (value + FlatGraph::kAlignment - 1) / FlatGraph::kAlignment * FlatGraph::kAlignment;
+}
+
+std::uint64_t Rotl(const std::uint64_t value, const int shift) {
+    return (value << shift) | (value >> (64 - shift));
+}
+
+// Word-at-a-time multiply/rotate hash; fast enough to check a multi-GB file
+// at memory bandwidth when verification is requested.
+std::uint64_t HashBytes(const void* data, const std::size_t len, const std::uint64_t seed) {
+    constexpr std::uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+    constexpr std::uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t hash = seed ^ (static_cast<std::uint64_t>(len) * kPrime1);
+    std::size_t idx = 0;
+    for (; idx + 8 <= len; idx += 8) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, bytes + idx, 8);
+        hash ^= Rotl(word * kPrime2, 31) * kPrime1;
+        hash = Rotl(hash, 27) * kPrime1 + kPrime2;
+    }
+    if (idx < len) {
+        std::uint64_t tail = 0;
+        std::memcpy(&tail, bytes + idx, len - idx);
+        hash ^= tail * kPrime2;
+    }
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime1;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+std::uint64_t SectionChecksum(
+    const float* embeddings,
+    const std::size_t embedding_bytes,
+    const std::uint64_t* offsets,
+    const std::size_t offset_bytes,
+    const NodeId* adjacency,
+    const std::size_t adjacency_bytes) {
+    std::uint64_t hash = HashBytes(embeddings, embedding_bytes, kVersion);
+    hash = HashBytes(offsets, offset_bytes, hash);
+    return HashBytes(adjacency, adjacency_bytes, hash);
+}
+
+// `offset + count * elem_size` lies inside a file of `file_bytes`.
+bool SectionFits(
+    const std::uint64_t offset,
+    const std::uint64_t count,
+    const std::uint64_t elem_size,
+    const std::uint64_t file_bytes,
+    std::uint64_t* bytes) {
+    if (__builtin_mul_overflow(count, elem_size, bytes)) {
+        return false;
+    }
+    return offset % FlatGraph::kAlignment == 0 && *bytes <= file_bytes && offset <= file_bytes - *bytes;
+}
+
+class MappedFile {
+public:
+    MappedFile(void* addr, const std::size_t bytes) : addr_(addr), bytes_(bytes) {}
+    ~MappedFile() { ::munmap(addr_, bytes_); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* Data() const { return static_cast<const unsigned char*>(addr_); }
+
+private:
+    void* addr_;
+    std::size_t bytes_;
+};
+
+[[noreturn]] void ThrowIo(const std::string& what, const std::string& path) {
+    throw std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+// Flushes `path` (a file, or a directory after a rename in it) to stable
+// storage.
+void SyncPath(const std::string& path, const int flags) {
+    const int fd = ::open(path.c_str(), flags | O_CLOEXEC);
+    if (fd < 0) {
+        ThrowIo("cannot open", path);
+    }
+    const int rc = ::fsync(fd);
+    const int err = errno;
+    ::close(fd);
+    if (rc != 0) {
+        errno = err;
+        ThrowIo("fsync failed for", path);
+    }
+}
+
+// CSR offsets start at 0, never decrease and end at `edge_count`, and every
+// neighbor id names a node, so traversal cannot index out of the mapping.
+bool AdjacencyValid(
+    const std::uint64_t* offsets,
+    const std::uint64_t node_count,
+    const NodeId* adjacency,
+    const std::uint64_t edge_count) {
+    if (node_count == 0) {
+        return edge_count == 0;
+    }
+    if (offsets[0] != 0 || offsets[node_count] != edge_count) {
+        return false;
+    }
+    for (std::uint64_t node = 0; node < node_count; ++node) {
+        if (offsets[node] > offsets[node + 1]) {
+            return false;
+        }
+    }
+    for (std::uint64_t edge = 0; edge < edge_count; ++edge) {
+        if (adjacency[edge] >= node_count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+void FlatGraph::Save(const std::string& path) const {
+    const std::uint64_t embedding_bytes = static_cast<std::uint64_t>(size_) * stride_ * sizeof(float);
+    const std::uint64_t offset_bytes = Empty() ? 0 : (static_cast<std::uint64_t>(size_) + 1) * sizeof(std::uint64_t);
+    const std::uint64_t adjacency_bytes = static_cast<std::uint64_t>(edge_count_) * sizeof(NodeId);
+
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.header_bytes = sizeof(FileHeader);
+    header.node_count = size_;
+    header.dim = dim_;
+    header.stride = stride_;
+    header.edge_count = edge_count_;
+    header.embeddings_offset = AlignUp(sizeof(FileHeader));
+    header.offsets_offset = AlignUp(header.embeddings_offset + embedding_bytes);
+    header.adjacency_offset = AlignUp(header.offsets_offset + offset_bytes);
+    header.file_bytes = header.adjacency_offset + adjacency_bytes;
+    header.checksum =
+        SectionChecksum(embeddings_, embedding_bytes, offsets_, offset_bytes, adjacency_, adjacency_bytes);
+
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            ThrowIo("cannot create", tmp_path);
+        }
+        const char zeros[kAlignment] = {};
+        std::uint64_t written = 0;
+        auto write = [&](const void* data, const std::uint64_t bytes) {
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+            written += bytes;
+        };
+        auto pad_to = [&](const std::uint64_t offset) { write(zeros, offset - written); };
+
+        write(&header, sizeof(header));
+        pad_to(header.embeddings_offset);
+        write(embeddings_, embedding_bytes);
+        pad_to(header.offsets_offset);
+        write(offsets_, offset_bytes);
+        pad_to(header.adjacency_offset);
+        write(adjacency_, adjacency_bytes);
+        out.flush();
+        if (!out) {
+            ThrowIo("write failed for", tmp_path);
+        }
+    }
+    // Without the data on disk first, a crash after the rename can leave
+    // `path` naming a truncated file.
+    SyncPath(tmp_path, O_WRONLY);
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        ThrowIo("cannot rename to", path);
+    }
+    const std::string::size_type slash = path.find_last_of('/');
+    SyncPath(slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash)), O_RDONLY | O_DIRECTORY);
+}
+
+FlatGraph FlatGraph::Map(const std::string& path, const MapOptions& options) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ThrowIo("cannot open", path);
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        errno = err;
+        ThrowIo("cannot stat", path);
+    }
+    const auto file_bytes = static_cast<std::uint64_t>(st.st_size);
+    if (file_bytes < sizeof(FileHeader)) {
+        ::close(fd);
+        throw std::runtime_error("graph file too small: " + path);
+    }
+
+    int flags = MAP_PRIVATE;
+    if (options.warmup == MapWarmup::kPopulate) {
+        flags |= MAP_POPULATE;
+    }
+    void* addr = ::mmap(nullptr, file_bytes, PROT_READ, flags, fd, 0);
+    const int err = errno;
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        errno = err;
+        ThrowIo("cannot mmap", path);
+    }
+    auto mapping = std::make_shared<MappedFile>(addr, file_bytes);
+
+    FileHeader header{};
+    std::memcpy(&header, mapping->Data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("not a graph file: " + path);
+    }
+    if (header.version != kVersion || header.header_bytes != sizeof(FileHeader)) {
+        throw std::runtime_error("unsupported graph file version " + std::to_string(header.version) + ": " + path);
+    }
+    std::uint64_t embedding_bytes = 0;
+    std::uint64_t offset_bytes = 0;
+    std::uint64_t adjacency_bytes = 0;
+    const std::uint64_t offset_count = header.node_count == 0 ? 0 : header.node_count + 1;
+    if (header.file_bytes != file_bytes || header.stride < header.dim || header.stride > file_bytes ||
+        header.stride % (kAlignment / sizeof(float)) != 0 || header.node_count > file_bytes ||
+        !SectionFits(header.embeddings_offset, header.node_count, header.stride * sizeof(float), file_bytes, &embedding_bytes) ||
+        !SectionFits(header.offsets_offset, offset_count, sizeof(std::uint64_t), file_bytes, &offset_bytes) ||
+        !SectionFits(header.adjacency_offset, header.edge_count, sizeof(NodeId), file_bytes, &adjacency_bytes)) {
+        throw std::runtime_error("truncated or corrupt graph file: " + path);
+    }
+
+    FlatGraph graph;
+    graph.size_ = header.node_count;
+    graph.dim_ = header.dim;
+    graph.stride_ = header.stride;
+    graph.edge_count_ = header.edge_count;
+    graph.memory_bytes_ = embedding_bytes + offset_bytes + adjacency_bytes;
+    graph.mapped_ = true;
+    graph.embeddings_ = reinterpret_cast<const float*>(mapping->Data() + header.embeddings_offset);
+    graph.offsets_ = reinterpret_cast<const std::uint64_t*>(mapping->Data() + header.offsets_offset);
+    graph.adjacency_ = reinterpret_cast<const NodeId*>(mapping->Data() + header.adjacency_offset);
+    if (!AdjacencyValid(graph.offsets_, header.node_count, graph.adjacency_, header.edge_count)) {
+        throw std::runtime_error("graph file has out-of-range offsets or neighbor ids: " + path);
+    }
+
+    if (options.warmup == MapWarmup::kWillNeed) {
+        ::madvise(addr, file_bytes, MADV_WILLNEED);
+    }
+    if (options.verify_checksum &&
+        SectionChecksum(graph.embeddings_, embedding_bytes, graph.offsets_, offset_bytes, graph.adjacency_, adjacency_bytes) !=
+            header.checksum) {
+        throw std::runtime_error("graph file checksum mismatch: " + path);
+    }
+    graph.storage_ = std::move(mapping);
+    return graph;
+}
+
+}  // namespace knowhere_demo
@@ -0,0 +1,346 @@
+#include "graph_reorder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+namespace knowhere_demo {
+
+namespace {
+
+constexpr std::int64_t kNone = -1;
+
+// Compressed adjacency built from a FlatGraph (reverse or symmetrized edges).
+struct Csr {
+    std::vector<std::uint64_t> offsets;
+    std::vector<NodeId> ids;
+
+    Span<const NodeId> Row(const NodeId node) const {
+        return {ids.data() + offsets[node], static_cast<std::size_t>(offsets[node + 1] - offsets[node])};
+    }
+    std::size_t Degree(const NodeId node) const { return static_cast<std::size_t>(offsets[node + 1] - offsets[node]); }
+};
+
+// In-edges (transpose), or out- plus in-edges when `with_out_edges` is set.
+Csr ReverseEdges(const FlatGraph& graph, const bool with_out_edges) {
+    const std::size_t count = graph.Size();
+    Csr csr;
+    csr.offsets.assign(count + 1, 0);
+    for (NodeId node = 0; node < count; ++node) {
+        for (const NodeId neighbor : graph.Neighbors(node)) {
+            ++csr.offsets[neighbor + 1];
+            if (with_out_edges) {
+                ++csr.offsets[node + 1];
+            }
+        }
+    }
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        csr.offsets[idx + 1] += csr.offsets[idx];
+    }
+    csr.ids.resize(csr.offsets[count]);
+    std::vector<std::uint64_t> cursor(csr.offsets.begin(), csr.offsets.end() - 1);
+    for (NodeId node = 0; node < count; ++node) {
+        for (const NodeId neighbor : graph.Neighbors(node)) {
+            csr.ids[cursor[neighbor]++] = node;
+            if (with_out_edges) {
+                csr.ids[cursor[node]++] = neighbor;
+            }
+        }
+    }
+    return csr;
+}
+
+std::vector<NodeId> BfsOrder(const FlatGraph& graph, const NodeId root) {
+    const std::size_t count = graph.Size();
+    std::vector<NodeId> order;
+    order.reserve(count);
+    std::vector<bool> placed(count, false);
+    std::queue<NodeId> frontier;
+    auto visit_from = [&](const NodeId start) {
+        placed[start] = true;
+        frontier.push(start);
+        while (!frontier.empty()) {
+            const NodeId node = frontier.front();
+            frontier.pop();
+            order.push_back(node);
+            for (const NodeId neighbor : graph.Neighbors(node)) {
+                if (!placed[neighbor]) {
+                    placed[neighbor] = true;
+                    frontier.push(neighbor);
+                }
+            }
+        }
+    };
+    visit_from(root < count ? root : 0);
+    for (NodeId node = 0; node < count; ++node) {
+        if (!placed[node]) {
+            visit_from(node);
+        }
+    }
+    return order;
+}
+
+// Cuthill-McKee on the symmetrized graph, reversed. Each component starts from
+// a lowest-degree node (a cheap stand-in for a pseudo-peripheral one) and
+// enqueues unplaced neighbors by ascending degree.
+std::vector<NodeId> RcmOrder(const FlatGraph& graph) {
+    const std::size_t count = graph.Size();
+    const Csr undirected = ReverseEdges(graph, /*with_out_edges=*/true);
+    std::vector<NodeId> by_degree(count);
+    for (NodeId node = 0; node < count; ++node) {
+        by_degree[node] = node;
+    }
+    auto fewer_edges = [&](const NodeId lhs, const NodeId rhs) {
+        const std::size_t lhs_degree = undirected.Degree(lhs);
+        const std::size_t rhs_degree = undirected.Degree(rhs);
+        return lhs_degree != rhs_degree ? lhs_degree < rhs_degree : lhs < rhs;
+    };
+    std::sort(by_degree.begin(), by_degree.end(), fewer_edges);
+
+    std::vector<NodeId> order;
+    order.reserve(count);
+    std::vector<bool> placed(count, false);
+    std::vector<NodeId> fresh;
+    for (const NodeId start : by_degree) {
+        if (placed[start]) {
+            continue;
+        }
+        placed[start] = true;
+        std::size_t head = order.size();
+        order.push_back(start);
+        for (; head < order.size(); ++head) {
+            fresh.clear();
+            for (const NodeId neighbor : undirected.Row(order[head])) {
+                if (!placed[neighbor]) {
+                    placed[neighbor] = true;
+                    fresh.push_back(neighbor);
+                }
+            }
+            std::sort(fresh.begin(), fresh.end(), fewer_edges);
+            order.insert(order.end(), fresh.begin(), fresh.end());
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+// Max-priority queue over small integer keys that only move by +-1, as in the
+// Gorder paper: one doubly linked list per key value, so every update is O(1)
+// and extraction walks down from the highest key seen.
+class UnitHeap {
+public:
+    explicit UnitHeap(const std::size_t count)
+        : key_(count, 0), prev_(count, kNone), next_(count, kNone), in_heap_(count, true), heads_(1, kNone) {
+        for (std::size_t node = count; node-- > 0;) {
+            Link(static_cast<NodeId>(node));
+        }
+    }
+
+    void Increment(const NodeId node) {
+        if (!in_heap_[node]) {
+            return;
+        }
+        Unlink(node);
+        ++key_[node];
+        if (key_[node] >= heads_.size()) {
+            heads_.push_back(kNone);
+        }
+        Link(node);
+        top_ = std::max(top_, key_[node]);
+    }
+
+    void Decrement(const NodeId node) {
+        if (!in_heap_[node] || key_[node] == 0) {
+            return;
+        }
+        Unlink(node);
+        --key_[node];
+        Link(node);
+    }
+
+    void Remove(const NodeId node) {
+        if (in_heap_[node]) {
+            Unlink(node);
+            in_heap_[node] = false;
+        }
+    }
+
+    // Removes and returns a node with the largest key; the heap must not be empty.
+    NodeId PopMax() {
+        while (top_ > 0 && heads_[top_] == kNone) {
+            --top_;
+        }
+        const auto node = static_cast<NodeId>(heads_[top_]);
+        Remove(node);
+        return node;
+    }
+
+private:
+    void Link(const NodeId node) {
+        const std::int64_t head = heads_[key_[node]];
+        prev_[node] = kNone;
+        next_[node] = head;
+        if (head != kNone) {
+            prev_[head] = node;
+        }
+        heads_[key_[node]] = node;
+    }
+
+    void Unlink(const NodeId node) {
+        if (prev_[node] != kNone) {
+            next_[prev_[node]] = next_[node];
+        } else {
+            heads_[key_[node]] = next_[node];
+        }
+        if (next_[node] != kNone) {
+            prev_[next_[node]] = prev_[node];
+        }
+    }
+
+    std::vector<std::size_t> key_;
+    std::vector<std::int64_t> prev_;
+    std::vector<std::int64_t> next_;
+    std::vector<bool> in_heap_;
+    std::vector<std::int64_t> heads_;
+    std::size_t top_{0};
+};
+
+// Gorder score of u against the window: edges between u and window nodes plus
+// in-neighbors u shares with them. Sibling updates skip in-neighbors whose
+// out-degree exceeds sqrt(n), as the paper does for hubs.
+std::vector<NodeId> GorderOrder(const FlatGraph& graph, const std::size_t window) {
+    const std::size_t count = graph.Size();
+    const Csr in_edges = ReverseEdges(graph, /*with_out_edges=*/false);
+    const auto hub_degree = static_cast<std::size_t>(std::sqrt(static_cast<double>(count)));
+    UnitHeap heap(count);
+
+    auto update = [&](const NodeId node, const bool entering) {
+        auto bump = [&](const NodeId other) {
+            if (entering) {
+                heap.Increment(other);
+            } else {
+                heap.Decrement(other);
+            }
+        };
+        for (const NodeId out : graph.Neighbors(node)) {
+            bump(out);
+        }
+        for (const NodeId in : in_edges.Row(node)) {
+            bump(in);
+            const Span<const NodeId> siblings = graph.Neighbors(in);
+            if (siblings.size() <= hub_degree) {
+                for (const NodeId sibling : siblings) {
+                    if (sibling != node) {
+                        bump(sibling);
+                    }
+                }
+            }
+        }
+    };
+
+    NodeId start = 0;
+    for (NodeId node = 1; node < count; ++node) {
+        if (in_edges.Degree(node) > in_edges.Degree(start)) {
+            start = node;
+        }
+    }
+    std::vector<NodeId> order;
+    order.reserve(count);
+    std::deque<NodeId> recent;
+    heap.Remove(start);
+    order.push_back(start);
+    while (order.size() < count) {
+        const NodeId placed = order.back();
+        recent.push_back(placed);
+        update(placed, /*entering=*/true);
+        if (recent.size() > window) {
+            update(recent.front(), /*entering=*/false);
+            recent.pop_front();
+        }
+        order.push_back(heap.PopMax());
+    }
+    return order;
+}
+
+}  // namespace
+
+IdMap::IdMap(std::vector<NodeId> new_to_old) : new_to_old_(std::move(new_to_old)) {
+    old_to_new_.assign(new_to_old_.size(), static_cast<NodeId>(new_to_old_.size()));
+    for (std::size_t new_id = 0; new_id < new_to_old_.size(); ++new_id) {
+        const NodeId old_id = new_to_old_[new_id];
+        if (old_id >= new_to_old_.size() || old_to_new_[old_id] != new_to_old_.size()) {
+            throw std::invalid_argument("IdMap requires a permutation");
+        }
+        old_to_new_[old_id] = static_cast<NodeId>(new_id);
+    }
+}
+
+void IdMap::ToOriginal(std::vector<Candidate>* results) const {
+    if (IsIdentity()) {
+        return;
+    }
+    for (Candidate& candidate : *results) {
+        candidate.id = ToOriginal(candidate.id);
+    }
+}
+
+FilterBitmap IdMap::ToReordered(const FilterBitmap& filter) const {
+    if (IsIdentity() || filter.Empty()) {
+        return filter;
+    }
+    std::vector<std::uint32_t> original_ids;
+    filter.CollectIds(&original_ids);
+    const std::size_t universe = std::max(filter.Universe(), Size());
+    std::vector<std::uint32_t> ids;
+    ids.reserve(original_ids.size() + (universe - filter.Universe()));
+    for (const std::uint32_t id : original_ids) {
+        ids.push_back(id < Size() ? ToReordered(id) : id);
+    }
+    for (std::size_t id = filter.Universe(); id < universe; ++id) {
+        ids.push_back(ToReordered(static_cast<NodeId>(id)));
+    }
+    std::sort(ids.begin(), ids.end());
+    return FilterBitmap::FromIds(universe, ids, filter.GetEncoding());
+}
+
+std::vector<NodeId> ComputeNodeOrder(const FlatGraph& graph, const ReorderOptions& options) {
+    if (graph.Empty()) {
+        return {};
+    }
+    switch (options.method) {
+        case ReorderMethod::kBfs:
+            return BfsOrder(graph, options.root);
+        case ReorderMethod::kRcm:
+            return RcmOrder(graph);
+        case ReorderMethod::kGorder:
+            break;
+    }
+    return GorderOrder(graph, std::max<std::size_t>(1, options.gorder_window));
+}
+
+ReorderedGraph ReorderGraph(const FlatGraph& graph, const ReorderOptions& options) {
+    std::vector<NodeId> order = ComputeNodeOrder(graph, options);
+    ReorderedGraph reordered;
+    reordered.graph = graph.Permute(order);
+    reordered.ids = IdMap(std::move(order));
+    return reordered;
+}
+
+double AverageEdgeGap(const FlatGraph& graph) {
+    if (graph.EdgeCount() == 0) {
+        return 0.0;
+    }
+    double total = 0.0;
+    for (NodeId node = 0; node < graph.Size(); ++node) {
+        for (const NodeId neighbor : graph.Neighbors(node)) {
+            total += node > neighbor ? node - neighbor : neighbor - node;
+        }
+    }
+    return total / static_cast<double>(graph.EdgeCount());
+}
+
+}  // namespace knowhere_demo
@@ -0,0 +1,206 @@
+#include "quantized_codes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+#include "distance.h"
+#include "kmeans.h"
+
+namespace knowhere_demo {
+
+namespace {
+
+constexpr std::size_t kPqCentroids = 256;
+constexpr std::size_t kSq4Levels = 16;
+// Nodes ahead whose codes Distances() prefetches.
+constexpr std::size_t kCodePrefetchDistance = 4;
+
+// Row-major copy of up to `samples` random rows of `graph`.
+std::vector<float> SampleRows(const FlatGraph& graph, const std::size_t samples, const std::uint32_t seed) {
+    std::vector<NodeId> ids(graph.Size());
+    std::iota(ids.begin(), ids.end(), NodeId{0});
+    if (samples < ids.size()) {
+        std::mt19937 rng(seed);
+        std::vector<NodeId> picked;
+        picked.reserve(samples);
+        std::sample(ids.begin(), ids.end(), std::back_inserter(picked), samples, rng);
+        ids = std::move(picked);
+    }
+    const std::size_t dim = graph.Dim();
+    std::vector<float> rows(ids.size() * dim);
+    for (std::size_t idx = 0; idx < ids.size(); ++idx) {
+        const float* row = graph.Embedding(ids[idx]);
+        std::copy(row, row + dim, rows.begin() + idx * dim);
+    }
+    return rows;
+}
+
+}  // namespace
+
+QuantizedCodes QuantizedCodes::Encode(const FlatGraph& graph, const QuantizerOptions& options) {
+    QuantizedCodes codes;
+    if (graph.Empty()) {
+        return codes;
+    }
+    const std::size_t dim = graph.Dim();
+    if (options.type == CodeType::kPq && (options.pq_subspaces == 0 || dim % options.pq_subspaces != 0)) {
+        throw std::invalid_argument("PQ subspaces must divide the dimension");
+    }
+    codes.type_ = options.type;
+    codes.size_ = graph.Size();
+    codes.dim_ = dim;
+    const std::vector<float> sample = SampleRows(graph, std::max<std::size_t>(1, options.train_samples), options.seed);
+    const std::size_t sample_count = sample.size() / dim;
+
+    if (options.type == CodeType::kPq) {
+        const std::size_t sub_dim = dim / options.pq_subspaces;
+        codes.subspaces_ = options.pq_subspaces;
+        codes.code_bytes_ = options.pq_subspaces;
+        codes.centroids_ = std::min(kPqCentroids, sample_count);
+        codes.codebooks_.assign(codes.subspaces_ * kPqCentroids * sub_dim, 0.0F);
+        for (std::size_t sub = 0; sub < codes.subspaces_; ++sub) {
+            const std::vector<float> centroids = ann_common::TrainKMeans(
+                sample.data() + sub * sub_dim, sample_count, sub_dim, dim, codes.centroids_, options.kmeans_iterations,
+                options.seed + static_cast<std::uint32_t>(sub));
+            std::copy(centroids.begin(), centroids.end(), codes.codebooks_.begin() + sub * kPqCentroids * sub_dim);
+        }
+        codes.codes_.resize(codes.size_ * codes.code_bytes_);
+        for (NodeId id = 0; id < codes.size_; ++id) {
+            const float* row = graph.Embedding(id);
+            std::uint8_t* code = codes.codes_.data() + static_cast<std::size_t>(id) * codes.code_bytes_;
+            for (std::size_t sub = 0; sub < codes.subspaces_; ++sub) {
+                code[sub] = static_cast<std::uint8_t>(ann_common::NearestCentroid(
+                    codes.codebooks_.data() + sub * kPqCentroids * sub_dim, codes.centroids_, sub_dim,
+                    row + sub * sub_dim));
+            }
+        }
+        return codes;
+    }
+
+    const bool nibbles = options.type == CodeType::kSq4;
+    const float levels = nibbles ? kSq4Levels - 1 : 255.0F;
+    codes.code_bytes_ = nibbles ? (dim + 1) / 2 : dim;
+    codes.min_.assign(dim, std::numeric_limits<float>::max());
+    codes.step_.assign(dim, std::numeric_limits<float>::lowest());
+    for (std::size_t row = 0; row < sample_count; ++row) {
+        for (std::size_t d = 0; d < dim; ++d) {
+            codes.min_[d] = std::min(codes.min_[d], sample[row * dim + d]);
+            codes.step_[d] = std::max(codes.step_[d], sample[row * dim + d]);
+        }
+    }
+    for (std::size_t d = 0; d < dim; ++d) {
+        const float range = codes.step_[d] - codes.min_[d];
+        codes.step_[d] = range > 0.0F ? range / levels : 1.0F;
+    }
+    codes.codes_.assign(codes.size_ * codes.code_bytes_, 0);
+    for (NodeId id = 0; id < codes.size_; ++id) {
+        const float* row = graph.Embedding(id);
+        std::uint8_t* code = codes.codes_.data() + static_cast<std::size_t>(id) * codes.code_bytes_;
+        for (std::size_t d = 0; d < dim; ++d) {
+            const float scaled = std::round((row[d] - codes.min_[d]) / codes.step_[d]);
+            const auto value = static_cast<std::uint8_t>(std::clamp(scaled, 0.0F, levels));
+            if (nibbles) {
+                code[d / 2] |= static_cast<std::uint8_t>(value << ((d & 1U) * 4));
+            } else {
+                code[d] = value;
+            }
+        }
+    }
+    return codes;
+}
+
+std::size_t QuantizedCodes::MemoryBytes() const {
+    return codes_.size() + (min_.size() + step_.size() + codebooks_.size()) * sizeof(float);
+}
+
+void QuantizedCodes::PrepareQuery(const float* query, Query* state) const {
+    std::vector<float>& table = state->table_;
+    switch (type_) {
+        case CodeType::kSq8:
+            // d(q, x) = sum step^2 * (q' - code)^2 with q' = (q - min) / step.
+            table.resize(2 * dim_);
+            for (std::size_t d = 0; d < dim_; ++d) {
+                table[d] = (query[d] - min_[d]) / step_[d];
+                table[dim_ + d] = step_[d] * step_[d];
+            }
+            return;
+        case CodeType::kSq4:
+            table.resize(dim_ * kSq4Levels);
+            for (std::size_t d = 0; d < dim_; ++d) {
+                for (std::size_t level = 0; level < kSq4Levels; ++level) {
+                    const float diff = query[d] - (min_[d] + static_cast<float>(level) * step_[d]);
+                    table[d * kSq4Levels + level] = diff * diff;
+                }
+            }
+            return;
+        case CodeType::kPq:
+            break;
+    }
+    const std::size_t sub_dim = dim_ / subspaces_;
+    table.assign(subspaces_ * kPqCentroids, 0.0F);
+    for (std::size_t sub = 0; sub < subspaces_; ++sub) {
+        const float* codebook = codebooks_.data() + sub * kPqCentroids * sub_dim;
+        for (std::size_t centroid = 0; centroid < centroids_; ++centroid) {
+            table[sub * kPqCentroids + centroid] =
+                ann_common::L2Sqr(query + sub * sub_dim, codebook + centroid * sub_dim, sub_dim);
+        }
+    }
+}
+
+float QuantizedCodes::Distance(const Query& state, const std::uint8_t* code) const {
+    const float* table = state.table_.data();
+    float sum = 0.0F;
+    switch (type_) {
+        case CodeType::kSq8: {
+            // Independent lanes so the compiler can vectorize without
+            // reassociating a single float sum.
+            const float* weights = table + dim_;
+            float lanes[8] = {};
+            std::size_t d = 0;
+            for (; d + 8 <= dim_; d += 8) {
+                for (std::size_t lane = 0; lane < 8; ++lane) {
+                    const float diff = table[d + lane] - static_cast<float>(code[d + lane]);
+                    lanes[lane] += weights[d + lane] * diff * diff;
+                }
+            }
+            for (; d < dim_; ++d) {
+                const float diff = table[d] - static_cast<float>(code[d]);
+                sum += weights[d] * diff * diff;
+            }
+            for (const float lane : lanes) {
+                sum += lane;
+            }
+            return sum;
+        }
+        case CodeType::kSq4:
+            for (std::size_t d = 0; d < dim_; ++d) {
+                const unsigned level = (code[d / 2] >> ((d & 1U) * 4)) & 0xFU;
+                sum += table[d * kSq4Levels + level];
+            }
+            return sum;
+        case CodeType::kPq:
+            break;
+    }
+    for (std::size_t sub = 0; sub < subspaces_; ++sub) {
+        sum += table[sub * kPqCentroids + code[sub]];
+    }
+    return sum;
+}
+
+void QuantizedCodes::Distances(const Query& state, const NodeId* ids, const std::size_t count, float* out) const {
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        if (idx + kCodePrefetchDistance < count) {
+            const std::uint8_t* ahead = Code(ids[idx + kCodePrefetchDistance]);
+            __builtin_prefetch(ahead);
+            __builtin_prefetch(ahead + code_bytes_ - 1);
+        }
+        out[idx] = Distance(state, Code(ids[idx]));
+    }
+}
+
+}  // namespace knowhere_demo
@@ -1,47 +1,180 @@
 #include "topk_reducer.h"
 
 #include <algorithm>
+#include <utility>
+
+#include "distance.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define KNOWHERE_TOPK_X86 1
+#include <immintrin.h>
+#else
+#define KNOWHERE_TOPK_X86 0
+#endif
 
 namespace knowhere_demo {
 
+namespace {
+
+// Appends the indices of distances[idx] < threshold to `out`; returns the count.
+std::size_t SelectBelowScalar(const float* distances, const std::size_t count, const float threshold, std::uint32_t* out) {
+    std::size_t kept = 0;
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        out[kept] = static_cast<std::uint32_t>(idx);
+        kept += distances[idx] < threshold ? 1 : 0;
+    }
+    return kept;
+}
+
+#if KNOWHERE_TOPK_X86
+
+__attribute__((target("avx2"))) std::size_t SelectBelowAvx2(
+    const float* distances,
+    const std::size_t count,
+    const float threshold,
+    std::uint32_t* out) {
+    const __m256 limit = _mm256_set1_ps(threshold);
+    std::size_t kept = 0;
+    std::size_t idx = 0;
+    for (; idx + 8 <= count; idx += 8) {
+        auto mask = static_cast<unsigned>(
+            _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(distances + idx), limit, _CMP_LT_OQ)));
+        while (mask != 0) {
+            out[kept++] = static_cast<std::uint32_t>(idx + static_cast<std::size_t>(__builtin_ctz(mask)));
+            mask &= mask - 1;
+        }
+    }
+    for (; idx < count; ++idx) {
+        out[kept] = static_cast<std::uint32_t>(idx);
+        kept += distances[idx] < threshold ? 1 : 0;
+    }
+    return kept;
+}
+
+__attribute__((target("avx512f"))) std::size_t SelectBelowAvx512(
+    const float* distances,
+    const std::size_t count,
+    const float threshold,
+    std::uint32_t* out) {
+    const __m512 limit = _mm512_set1_ps(threshold);
+    const __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    std::size_t kept = 0;
+    std::size_t idx = 0;
+    for (; idx + 16 <= count; idx += 16) {
+        const __mmask16 mask = _mm512_cmp_ps_mask(_mm512_loadu_ps(distances + idx), limit, _CMP_LT_OQ);
+        const __m512i indices = _mm512_add_epi32(lane, _mm512_set1_epi32(static_cast<int>(idx)));
+        _mm512_mask_compressstoreu_epi32(out + kept, mask, indices);
+        kept += static_cast<std::size_t>(__builtin_popcount(mask));
+    }
+    for (; idx < count; ++idx) {
+        out[kept] = static_cast<std::uint32_t>(idx);
+        kept += distances[idx] < threshold ? 1 : 0;
+    }
+    return kept;
+}
+
+#endif  // KNOWHERE_TOPK_X86
+
+}  // namespace
+
 TopKReducer::TopKReducer(std::size_t top_k) : top_k_(top_k) {
     heap_.reserve(top_k);
 }
 
+void TopKReducer::Reset(const std::size_t top_k) {
+    top_k_ = top_k;
+    heap_.clear();
+    heap_.reserve(top_k);
+}
+
 bool TopKReducer::MaxHeapCmp(const Candidate& left, const Candidate& right) {
     // Max-heap by distance. Root is the current worst in TopK.
     return left.distance < right.distance;
 }
 
+void TopKReducer::Offer(const Candidate& candidate) {
+    if (heap_.size() < top_k_) {
+        heap_.push_back(candidate);
+        std::push_heap(heap_.begin(), heap_.end(), MaxHeapCmp);
+        return;
+    }
+
+    if (top_k_ == 0 || candidate.distance >= heap_.front().distance) {
+        return;
+    }
+
+    std::pop_heap(heap_.begin(), heap_.end(), MaxHeapCmp);
+    heap_.back() = candidate;
+    std::push_heap(heap_.begin(), heap_.end(), MaxHeapCmp);
+}
+
 void TopKReducer::AbsorbBatch(const std::vector<Candidate>& batch) {
     for (const Candidate& candidate : batch) {
-        if (!candidate.passed_filter) {
-            continue;
+        if (candidate.passed_filter) {
+            Offer(candidate);
         }
+    }
+}
 
-        if (heap_.size() < top_k_) {
-            heap_.push_back(candidate);
-            std::push_heap(heap_.begin(), heap_.end(), MaxHeapCmp);
-            continue;
-        }
+void TopKReducer::AbsorbBlock(const NodeId* ids, const float* distances, const std::size_t count) {
+    std::size_t idx = 0;
+    for (; idx < count && heap_.size() < top_k_; ++idx) {
+        Offer(Candidate{.id = ids[idx], .distance = distances[idx], .passed_filter = true});
+    }
+    if (idx == count || top_k_ == 0) {
+        return;
+    }
 
-        if (candidate.distance >= heap_.front().distance) {
-            continue;
-        }
+    const float* rest = distances + idx;
+    const std::size_t rest_count = count - idx;
+    survivors_.resize(rest_count);
+    std::size_t kept = 0;
+#if KNOWHERE_TOPK_X86
+    switch (ann_common::ActiveKernels().level) {
+        case ann_common::SimdLevel::kAvx512:
+            kept = SelectBelowAvx512(rest, rest_count, Threshold(), survivors_.data());
+            break;
+        case ann_common::SimdLevel::kAvx2:
+            kept = SelectBelowAvx2(rest, rest_count, Threshold(), survivors_.data());
+            break;
+        case ann_common::SimdLevel::kScalar:
+            kept = SelectBelowScalar(rest, rest_count, Threshold(), survivors_.data());
+            break;
+    }
+#else
+    kept = SelectBelowScalar(rest, rest_count, Threshold(), survivors_.data());
+#endif
+    survivors_.resize(kept);
 
-        std::pop_heap(heap_.begin(), heap_.end(), MaxHeapCmp);
-        heap_.back() = candidate;
-        std::push_heap(heap_.begin(), heap_.end(), MaxHeapCmp);
+    // Only the top_k best survivors can matter; cut the rest before heap updates.
+    if (kept > top_k_) {
+        std::nth_element(
+            survivors_.begin(),
+            survivors_.begin() + static_cast<long>(top_k_),
+            survivors_.end(),
+            [rest](const std::uint32_t lhs, const std::uint32_t rhs) { return rest[lhs] < rest[rhs]; });
+        survivors_.resize(top_k_);
+    }
+    for (const std::uint32_t pos : survivors_) {
+        Offer(Candidate{.id = ids[idx + pos], .distance = rest[pos], .passed_filter = true});
     }
 }
 
-std::vector<Candidate> TopKReducer::Finalize() const {
+void TopKReducer::Merge(const TopKReducer& other) {
+    for (const Candidate& candidate : other.heap_) {
+        Offer(candidate);
+    }
+}
+
+std::vector<Candidate> TopKReducer::Finalize() const& {
     std::vector<Candidate> sorted = heap_;
-    std::sort(
-        sorted.begin(),
-        sorted.end(),
-        [](const Candidate& left, const Candidate& right) { return left.distance < right.distance; });
+    std::sort_heap(sorted.begin(), sorted.end(), MaxHeapCmp);
     return sorted;
 }
 
+std::vector<Candidate> TopKReducer::Finalize() && {
+    std::sort_heap(heap_.begin(), heap_.end(), MaxHeapCmp);
+    return std::move(heap_);
+}
+
 }  // namespace knowhere_demo
@@ -0,0 +1,261 @@
+#include "vamana_builder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "candidate_pool.h"
+#include "distance.h"
+#include "visited_table.h"
+
+namespace knowhere_demo {
+
+namespace {
+
+class SpinLock {
+public:
+    void lock() {
+        while (flag_.exchange(true, std::memory_order_acquire)) {
+            while (flag_.load(std::memory_order_relaxed)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    void unlock() { flag_.store(false, std::memory_order_release); }
+
+private:
+    std::atomic<bool> flag_{false};
+};
+
+struct ScoredId {
+    NodeId id{};
+    float distance{0.0F};
+};
+
+struct BuildContext {
+    const float* data{nullptr};
+    std::size_t count{0};
+    std::size_t dim{0};
+    std::vector<std::vector<NodeId>> adjacency;
+    std::unique_ptr<SpinLock[]> locks;
+
+    const float* Row(const NodeId id) const { return data + static_cast<std::size_t>(id) * dim; }
+    float Distance(const NodeId lhs, const NodeId rhs) const { return ann_common::L2Sqr(Row(lhs), Row(rhs), dim); }
+};
+
+// Per-thread buffers reused across insertions.
+struct InsertScratch {
+    CandidatePool pool{0};
+    ann_common::VisitedTable visited;
+    std::vector<NodeId> popped;
+    std::vector<float> popped_distances;
+    std::vector<NodeId> neighbors;
+    std::vector<ScoredId> candidates;
+    std::vector<NodeId> pruned;
+};
+
+// Greedy search from `entry` toward `query`; every expanded node (with its
+// distance to the query) is appended to `scratch->candidates`.
+void GreedySearch(const BuildContext& ctx, const NodeId entry, const float* query, const std::size_t list_size, InsertScratch* scratch) {
+    scratch->pool.Reset(list_size);
+    scratch->visited.Reset(ctx.count);
+    scratch->visited.TestAndSet(entry);
+    scratch->pool.Insert(entry, ann_common::L2Sqr(query, ctx.Row(entry), ctx.dim));
+
+    while (true) {
+        scratch->pool.PopUnexpanded(1, &scratch->popped, &scratch->popped_distances);
+        if (scratch->popped.empty()) {
+            return;
+        }
+        const NodeId current = scratch->popped.front();
+        scratch->candidates.push_back(ScoredId{.id = current, .distance = scratch->popped_distances.front()});
+        {
+            std::lock_guard<SpinLock> guard(ctx.locks[current]);
+            scratch->neighbors = ctx.adjacency[current];
+        }
+        for (const NodeId neighbor : scratch->neighbors) {
+            if (scratch->visited.TestAndSet(neighbor)) {
+                scratch->pool.Insert(neighbor, ann_common::L2Sqr(query, ctx.Row(neighbor), ctx.dim));
+            }
+        }
+    }
+}
+
+// RNG-style pruning: keep a candidate only if no already kept neighbor is
+// alpha-times closer to it than `point` is. Distances are squared, so alpha is too.
+void RobustPrune(
+    const BuildContext& ctx,
+    const NodeId point,
+    std::vector<ScoredId>* candidates,
+    const float alpha,
+    const std::size_t max_degree,
+    std::vector<NodeId>* out) {
+    std::sort(candidates->begin(), candidates->end(), [](const ScoredId& lhs, const ScoredId& rhs) {
+        return lhs.distance < rhs.distance || (lhs.distance == rhs.distance && lhs.id < rhs.id);
+    });
+    const float alpha_sqr = alpha * alpha;
+    out->clear();
+    NodeId previous = std::numeric_limits<NodeId>::max();
+    for (const ScoredId& candidate : *candidates) {
+        if (out->size() >= max_degree) {
+            break;
+        }
+        if (candidate.id == point || candidate.id == previous) {
+            continue;
+        }
+        previous = candidate.id;
+        bool keep = true;
+        for (const NodeId kept : *out) {
+            if (alpha_sqr * ctx.Distance(kept, candidate.id) <= candidate.distance) {
+                keep = false;
+                break;
+            }
+        }
+        if (keep) {
+            out->push_back(candidate.id);
+        }
+    }
+}
+
+void InsertPoint(BuildContext* ctx, const NodeId point, const NodeId medoid, const VamanaBuildParams& params, const float alpha, InsertScratch* scratch) {
+    scratch->candidates.clear();
+    GreedySearch(*ctx, medoid, ctx->Row(point), params.build_list_size, scratch);
+    {
+        std::lock_guard<SpinLock> guard(ctx->locks[point]);
+        scratch->neighbors = ctx->adjacency[point];
+    }
+    for (const NodeId neighbor : scratch->neighbors) {
+        scratch->candidates.push_back(ScoredId{.id = neighbor, .distance = ctx->Distance(point, neighbor)});
+    }
+    RobustPrune(*ctx, point, &scratch->candidates, alpha, params.max_degree, &scratch->pruned);
+    {
+        std::lock_guard<SpinLock> guard(ctx->locks[point]);
+        ctx->adjacency[point] = scratch->pruned;
+    }
+
+    // Reverse edges; a neighbor that overflows R is re-pruned under its own lock.
+    for (const NodeId neighbor : scratch->pruned) {
+        std::lock_guard<SpinLock> guard(ctx->locks[neighbor]);
+        std::vector<NodeId>& list = ctx->adjacency[neighbor];
+        if (std::find(list.begin(), list.end(), point) != list.end()) {
+            continue;
+        }
+        if (list.size() < params.max_degree) {
+            list.push_back(point);
+            continue;
+        }
+        std::vector<ScoredId> reverse;
+        reverse.reserve(list.size() + 1);
+        for (const NodeId id : list) {
+            reverse.push_back(ScoredId{.id = id, .distance = ctx->Distance(neighbor, id)});
+        }
+        reverse.push_back(ScoredId{.id = point, .distance = ctx->Distance(neighbor, point)});
+        std::vector<NodeId> repruned;
+        RobustPrune(*ctx, neighbor, &reverse, alpha, params.max_degree, &repruned);
+        list = std::move(repruned);
+    }
+}
+
+NodeId FindMedoid(const BuildContext& ctx) {
+    std::vector<double> centroid(ctx.dim, 0.0);
+    for (std::size_t id = 0; id < ctx.count; ++id) {
+        const float* row = ctx.Row(static_cast<NodeId>(id));
+        for (std::size_t d = 0; d < ctx.dim; ++d) {
+            centroid[d] += row[d];
+        }
+    }
+    std::vector<float> mean(ctx.dim);
+    for (std::size_t d = 0; d < ctx.dim; ++d) {
+        mean[d] = static_cast<float>(centroid[d] / static_cast<double>(ctx.count));
+    }
+
+    NodeId best = 0;
+    float best_distance = std::numeric_limits<float>::max();
+    for (std::size_t id = 0; id < ctx.count; ++id) {
+        const float distance = ann_common::L2Sqr(mean.data(), ctx.Row(static_cast<NodeId>(id)), ctx.dim);
+        if (distance < best_distance) {
+            best_distance = distance;
+            best = static_cast<NodeId>(id);
+        }
+    }
+    return best;
+}
+
+}  // namespace
+
+VamanaBuilder::VamanaBuilder(VamanaBuildParams params) : params_(params) {
+    if (params_.max_degree == 0 || params_.build_list_size == 0) {
+        throw std::invalid_argument("Vamana R and L must be positive");
+    }
+}
+
+VamanaIndex VamanaBuilder::Build(const float* vectors, const std::size_t count, const std::size_t dim) const {
+    VamanaIndex index;
+    if (count == 0) {
+        return index;
+    }
+
+    BuildContext ctx;
+    ctx.data = vectors;
+    ctx.count = count;
+    ctx.dim = dim;
+    ctx.adjacency.resize(count);
+    ctx.locks = std::make_unique<SpinLock[]>(count);
+    index.medoid = FindMedoid(ctx);
+
+    std::vector<NodeId> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(params_.seed));
+
+    std::size_t num_threads = params_.num_threads;
+    if (num_threads == 0) {
+        num_threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    // Pass 1 with alpha = 1 builds a sparse RNG; pass 2 adds long-range edges.
+    for (const float alpha : {1.0F, params_.alpha}) {
+        std::atomic<std::size_t> next{0};
+        auto worker = [&]() {
+            InsertScratch scratch;
+            for (std::size_t idx = next.fetch_add(1); idx < count; idx = next.fetch_add(1)) {
+                InsertPoint(&ctx, order[idx], index.medoid, params_, alpha, &scratch);
+            }
+        };
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads - 1);
+        for (std::size_t t = 1; t < num_threads; ++t) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    index.graph = FlatGraph::FromAdjacency(vectors, count, dim, ctx.adjacency);
+    return index;
+}
+
+VamanaIndex VamanaBuilder::Build(const std::vector<std::vector<float>>& vectors) const {
+    if (vectors.empty()) {
+        return {};
+    }
+    const std::size_t dim = vectors.front().size();
+    std::vector<float> flat;
+    flat.reserve(vectors.size() * dim);
+    for (const auto& vector : vectors) {
+        if (vector.size() != dim) {
+            throw std::invalid_argument("Vamana input dim mismatch");
+        }
+        flat.insert(flat.end(), vector.begin(), vector.end());
+    }
+    return Build(flat.data(), vectors.size(), dim);
+}
+
+}  // namespace knowhere_demo
@@ -0,0 +1,151 @@
+#include "work_stealing_executor.h"
+
+#include <algorithm>
+
+namespace knowhere_demo {
+
+namespace {
+
+thread_local const WorkStealingExecutor* tls_executor = nullptr;
+thread_local std::size_t tls_worker_index = 0;
+
+}  // namespace
+
+bool WorkStealingExecutor::BoundedQueue::PushBack(const Task& task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (size_ == slots_.size()) {
+        return false;
+    }
+    slots_[(head_ + size_) % slots_.size()] = task;
+    ++size_;
+    return true;
+}
+
+bool WorkStealingExecutor::BoundedQueue::PopBack(Task* task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (size_ == 0) {
+        return false;
+    }
+    --size_;
+    *task = slots_[(head_ + size_) % slots_.size()];
+    return true;
+}
+
+bool WorkStealingExecutor::BoundedQueue::PopFront(Task* task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (size_ == 0) {
+        return false;
+    }
+    *task = slots_[head_];
+    head_ = (head_ + 1) % slots_.size();
+    --size_;
+    return true;
+}
+
+WorkStealingExecutor::WorkStealingExecutor(const ExecutorOptions options) {
+    std::size_t num_workers = options.num_workers;
+    if (num_workers == 0) {
+        num_workers = std::max<std::size_t>(2, std::thread::hardware_concurrency());
+    }
+    const std::size_t capacity = std::max<std::size_t>(1, options.queue_capacity);
+
+    queues_.reserve(num_workers);
+    for (std::size_t idx = 0; idx < num_workers; ++idx) {
+        queues_.push_back(std::make_unique<BoundedQueue>(capacity));
+    }
+    workers_.reserve(num_workers);
+    for (std::size_t idx = 0; idx < num_workers; ++idx) {
+        workers_.emplace_back(&WorkStealingExecutor::WorkerLoop, this, idx);
+    }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void WorkStealingExecutor::Submit(
+    TaskGroup* group,
+    const TaskFn fn,
+    void* ctx,
+    const std::size_t begin,
+    const std::size_t end) {
+    const Task task{.group = group, .fn = fn, .ctx = ctx, .begin = begin, .end = end};
+    group->pending_.fetch_add(1, std::memory_order_relaxed);
+    // Counted before the push: a worker may pop and decrement the moment the
+    // task is visible, which must not take the count below zero.
+    queued_.fetch_add(1);
+    if (!queues_[PickQueue()]->PushBack(task)) {
+        // Back-pressure: the queue is full, so the submitter does the work.
+        queued_.fetch_sub(1);
+        Run(task);
+        return;
+    }
+
+    if (sleepers_.load() > 0) {
+        { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+        wake_.notify_one();
+    }
+}
+
+void WorkStealingExecutor::Wait(TaskGroup* group) {
+    const std::size_t home = PickQueue();
+    while (!group->Done()) {
+        if (!TryRunOne(home)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void WorkStealingExecutor::WorkerLoop(const std::size_t worker_index) {
+    tls_executor = this;
+    tls_worker_index = worker_index;
+
+    while (true) {
+        if (TryRunOne(worker_index)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleepers_.fetch_add(1);
+        wake_.wait(lock, [this] { return stop_ || queued_.load() > 0; });
+        sleepers_.fetch_sub(1);
+        if (stop_ && queued_.load() == 0) {
+            return;
+        }
+    }
+}
+
+bool WorkStealingExecutor::TryRunOne(const std::size_t home_queue) {
+    Task task;
+    bool found = queues_[home_queue]->PopBack(&task);
+    for (std::size_t offset = 1; !found && offset < queues_.size(); ++offset) {
+        found = queues_[(home_queue + offset) % queues_.size()]->PopFront(&task);
+    }
+    if (!found) {
+        return false;
+    }
+    queued_.fetch_sub(1);
+    Run(task);
+    return true;
+}
+
+void WorkStealingExecutor::Run(const Task& task) {
+    task.fn(task.ctx, task.begin, task.end);
+    task.group->pending_.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+std::size_t WorkStealingExecutor::PickQueue() {
+    if (tls_executor == this) {
+        return tls_worker_index;
+    }
+    return next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+}
+
+}  // namespace knowhere_demo
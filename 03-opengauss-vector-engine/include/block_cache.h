@@ -0,0 +1,92 @@
+#ifndef OPENGAUSS_VECTOR_ENGINE_BLOCK_CACHE_H_
+#define OPENGAUSS_VECTOR_ENGINE_BLOCK_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "block_storage.h"
+#include "metrics.h"
+
+namespace opengauss_demo {
+
+struct BlockCacheOptions {
+    // Total bytes of cached and pinned blocks; 0 disables the cache.
+    std::size_t capacity_bytes{0};
+    // Independent CLOCK shards, each behind its own mutex.
+    std::size_t shards{16};
+    // Blocks of the largest posting lists loaded and pinned at Build. Big
+    // lists are the ones most queries probe.
+    std::size_t pinned_lists{0};
+};
+
+struct BlockCacheStats {
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    std::uint64_t evictions{0};
+    std::size_t resident_blocks{0};
+    std::size_t pinned_blocks{0};
+
+    double HitRate() const {
+        const std::uint64_t lookups = hits + misses;
+        return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+    }
+};
+
+// Fixed-budget cache of storage blocks in front of the disk reads. Blocks hash
+// to shards; each shard owns a contiguous frame array and evicts with CLOCK
+// (a reference bit per frame, second chance before eviction). Pinned blocks
+// are never evicted. Lookups copy the block out under the shard lock, so no
+// frame is referenced after the call returns.
+class BlockCache {
+public:
+    BlockCache(std::size_t block_bytes, const BlockCacheOptions& options);
+
+    std::size_t BlockBytes() const { return block_bytes_; }
+    std::size_t CapacityBlocks() const;
+
+    // Copies a resident block to `out` and marks it referenced.
+    bool Lookup(std::uint64_t block, std::uint8_t* out);
+    // Caches a block read from storage, evicting an unpinned one if needed.
+    void Insert(std::uint64_t block, const std::uint8_t* data);
+    // Caches and pins a block; false when its shard holds only pinned blocks.
+    bool Pin(std::uint64_t block, const std::uint8_t* data);
+
+    BlockCacheStats Stats() const;
+
+private:
+    struct Frame {
+        std::uint64_t block{};
+        bool valid{false};
+        bool referenced{false};
+        bool pinned{false};
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::vector<Frame> frames;
+        AlignedBuffer data;
+        std::unordered_map<std::uint64_t, std::size_t> index;
+        std::size_t hand{0};
+        std::size_t pinned{0};
+    };
+
+    Shard& ShardFor(std::uint64_t block) const;
+    // Frame for `block` in a locked shard: the resident one, a free one, or
+    // the CLOCK victim. Returns false when every frame is pinned.
+    bool Place(Shard* shard, std::uint64_t block, std::size_t* frame);
+
+    std::size_t block_bytes_;
+    std::size_t frames_per_shard_{0};
+    std::vector<std::unique_ptr<Shard>> shards_;
+    ann_common::Counter hits_;
+    ann_common::Counter misses_;
+    ann_common::Counter evictions_;
+};
+
+}  // namespace opengauss_demo
+
+#endif  // OPENGAUSS_VECTOR_ENGINE_BLOCK_CACHE_H_
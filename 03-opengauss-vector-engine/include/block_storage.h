@@ -0,0 +1,165 @@
+#ifndef OPENGAUSS_VECTOR_ENGINE_BLOCK_STORAGE_H_
+#define OPENGAUSS_VECTOR_ENGINE_BLOCK_STORAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace opengauss_demo {
+
+enum class IoBackend {
+    // io_uring when the kernel allows it, otherwise pread.
+    kAuto,
+    kPread,
+    kIoUring,
+};
+
+const char* IoBackendName(IoBackend backend);
+
+struct BlockStorageOptions {
+    // Block file written at Build; empty keeps the disk path in memory.
+    std::string path;
+    IoBackend backend{IoBackend::kAuto};
+    // Reads in flight at once on io_uring; pread issues them one by one.
+    std::size_t queue_depth{32};
+    // Bypass the page cache so every read reaches the device. Falls back to
+    // buffered reads when the filesystem rejects O_DIRECT.
+    bool direct_io{true};
+};
+
+// `block_count` consecutive blocks fetched with one read.
+struct BlockRun {
+    std::uint64_t first_block{};
+    std::size_t block_count{};
+};
+
+// One read of BlockStorage::Stream: `run` into `destination`
+// (kAlignment-aligned), reported back under `tag`.
+struct StreamRead {
+    BlockRun run;
+    std::uint8_t* destination{nullptr};
+    std::uint64_t tag{};
+};
+
+// Heap buffer aligned for O_DIRECT transfers.
+class AlignedBuffer {
+public:
+    AlignedBuffer() = default;
+    explicit AlignedBuffer(std::size_t bytes);
+
+    std::uint8_t* Data() { return data_.get(); }
+    const std::uint8_t* Data() const { return data_.get(); }
+    std::size_t Size() const { return size_; }
+    // Grows (never shrinks) to at least `bytes`; contents are not preserved.
+    void Reserve(std::size_t bytes);
+
+private:
+    struct Free {
+        void operator()(std::uint8_t* ptr) const { std::free(ptr); }
+    };
+    std::unique_ptr<std::uint8_t, Free> data_;
+    std::size_t size_{0};
+};
+
+// Read-only file of fixed-size, kAlignment-aligned blocks. Reads are whole
+// runs of blocks, so one merged request costs one syscall / SQE. Safe to
+// share between threads: each reading thread submits on an io_uring of its
+// own, so readers never wait on one another.
+class BlockStorage {
+public:
+    static constexpr std::size_t kAlignment = 4096;
+
+    static std::size_t AlignBlockBytes(std::size_t payload_bytes);
+
+    // Writes `block_count` blocks of `block_bytes`, replacing any existing
+    // file; `fill(block, out)` produces each block into a zeroed buffer.
+    // Throws std::runtime_error on I/O failure.
+    static void Write(
+        const std::string& path,
+        std::size_t block_bytes,
+        std::size_t block_count,
+        const std::function<void(std::size_t block, std::uint8_t* out)>& fill);
+
+    // Throws std::runtime_error when the file cannot be opened, is not a whole
+    // number of blocks, or kIoUring is requested but unavailable.
+    static std::unique_ptr<BlockStorage> Open(
+        const std::string& path,
+        std::size_t block_bytes,
+        const BlockStorageOptions& options = {});
+
+    ~BlockStorage();
+    BlockStorage(const BlockStorage&) = delete;
+    BlockStorage& operator=(const BlockStorage&) = delete;
+
+    std::size_t BlockBytes() const { return block_bytes_; }
+    std::size_t BlockCount() const { return block_count_; }
+    IoBackend Backend() const { return backend_; }
+    bool DirectIo() const { return direct_; }
+
+    // Reads every run into `out` back to back, in order. `out` must hold the
+    // runs' blocks and be kAlignment-aligned. Throws std::runtime_error.
+    void Read(const std::vector<BlockRun>& runs, std::uint8_t* out) const;
+    // Reads run i into `destinations[i]` (kAlignment-aligned) and calls
+    // `on_complete(i)`, if set, as soon as that run has landed; with io_uring
+    // runs complete out of order. `on_complete` must not call Read. When a
+    // read or `on_complete` fails, every read already issued still lands
+    // before the first error is rethrown, so no buffer is written afterwards.
+    void Read(
+        const std::vector<BlockRun>& runs,
+        const std::vector<std::uint8_t*>& destinations,
+        const std::function<void(std::size_t run)>& on_complete = {}) const;
+    // Read loop for a long-lived I/O thread that takes work as it arrives.
+    // Whenever fewer than the queue depth of reads are in flight (one on
+    // pread), `next(idle, &read)` is asked for another and returns false when
+    // it has none; with `idle` set nothing is in flight, so `next` may block
+    // for work, and false ends the stream. Each read lands in
+    // `on_complete(tag, ok)`, ok false if it failed; a failed read does not
+    // stop the stream. On io_uring, writing the nonblocking eventfd `wake_fd`
+    // makes a stream with reads in flight ask `next` again at once instead of
+    // after the next read lands. If a callback throws, the reads in flight
+    // land without further callbacks and the exception is rethrown.
+    void Stream(
+        const std::function<bool(bool idle, StreamRead* read)>& next,
+        const std::function<void(std::uint64_t tag, bool ok)>& on_complete,
+        int wake_fd = -1) const;
+
+private:
+    struct Ring;
+
+    BlockStorage() = default;
+    // The calling thread's ring, created on first use with at least
+    // `entries` SQEs; null when io_uring cannot be set up.
+    static Ring* ThreadRing(std::size_t entries);
+    void ReadPread(
+        const std::vector<BlockRun>& runs,
+        const std::vector<std::uint8_t*>& destinations,
+        const std::function<void(std::size_t run)>& on_complete) const;
+    void ReadIoUring(
+        const std::vector<BlockRun>& runs,
+        const std::vector<std::uint8_t*>& destinations,
+        const std::function<void(std::size_t run)>& on_complete) const;
+    void StreamPread(
+        const std::function<bool(bool idle, StreamRead* read)>& next,
+        const std::function<void(std::uint64_t tag, bool ok)>& on_complete) const;
+    void StreamIoUring(
+        Ring* ring,
+        const std::function<bool(bool idle, StreamRead* read)>& next,
+        const std::function<void(std::uint64_t tag, bool ok)>& on_complete,
+        int wake_fd) const;
+
+    std::string path_;
+    int fd_{-1};
+    std::size_t block_bytes_{0};
+    std::size_t block_count_{0};
+    std::size_t queue_depth_{1};
+    bool direct_{false};
+    IoBackend backend_{IoBackend::kPread};
+};
+
+}  // namespace opengauss_demo
+
+#endif  // OPENGAUSS_VECTOR_ENGINE_BLOCK_STORAGE_H_
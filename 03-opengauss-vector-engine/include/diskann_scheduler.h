@@ -1,10 +1,22 @@
 #ifndef OPENGAUSS_VECTOR_ENGINE_DISKANN_SCHEDULER_H_
 #define OPENGAUSS_VECTOR_ENGINE_DISKANN_SCHEDULER_H_
 
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "block_cache.h"
+#include "block_storage.h"
+
 namespace opengauss_demo {
 
 struct IoRequest {
@@ -14,15 +26,116 @@ struct IoRequest {
 
 class DiskIoBatchScheduler {
 public:
+    // `max_batch_size`: most blocks one merged read may span.
     explicit DiskIoBatchScheduler(std::size_t max_batch_size = 16);
 
+    // Requests sorted by (block, node), so reads walk the file forward.
     std::vector<IoRequest> Execute(const std::vector<IoRequest>& requests) const;
+    // Block runs covering `ordered`: repeated blocks are read once and
+    // adjacent blocks share one read, up to max_batch_size blocks.
+    std::vector<BlockRun> MergeRuns(const std::vector<IoRequest>& ordered) const;
     std::size_t EstimateMergedOps(const std::vector<IoRequest>& ordered) const;
 
 private:
     std::size_t max_batch_size_;
 };
 
+using IoClock = std::chrono::steady_clock;
+
+// One extent as it lands: `run.block_count` blocks back to back. The buffer
+// is shared by every query the extent served and stays alive while any
+// completion refers to it. Null `data` means the read failed.
+struct ExtentCompletion {
+    BlockRun run;
+    std::shared_ptr<const std::uint8_t> data;
+};
+
+// Completion queue for one Submit: the scheduler parks extents in it and
+// Next() hands them to the submitting thread in arrival order, so the work
+// done per extent runs on the query's thread, never on an I/O thread.
+class ExtentPoller {
+public:
+    void Push(ExtentCompletion completion);
+    // Blocks until the next extent lands.
+    ExtentCompletion Next();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<ExtentCompletion> completions_;
+    bool waiting_{false};
+};
+
+struct AsyncIoOptions {
+    // Extents in flight at once: all issued by one I/O thread on io_uring,
+    // one per I/O thread on pread.
+    std::size_t queue_depth{32};
+    // Most blocks one merged extent may span.
+    std::size_t max_batch_size{16};
+};
+
+// Asynchronous front end of the block file, shared by concurrent queries.
+// Submit serves cache hits on the caller's thread, attaches blocks that
+// another query already has queued or in flight to that extent, and queues
+// the rest as merged extents ordered by deadline (earliest first, FIFO among
+// equals). The most urgent queued extent is issued as soon as a read slot
+// frees: on io_uring one I/O thread keeps queue_depth extents in flight and
+// refills as each lands, on pread a pool of queue_depth threads reads one
+// extent each. A landed extent goes into the cache and is parked in the
+// poller of every query subscribed to it.
+class AsyncDiskIoScheduler {
+public:
+    AsyncDiskIoScheduler(const BlockStorage& storage, BlockCache* cache, const AsyncIoOptions& options = {});
+    // Completes every queued extent, then stops the I/O threads.
+    ~AsyncDiskIoScheduler();
+    AsyncDiskIoScheduler(const AsyncDiskIoScheduler&) = delete;
+    AsyncDiskIoScheduler& operator=(const AsyncDiskIoScheduler&) = delete;
+
+    // Schedules every block `requests` touch and returns how many completions
+    // `poller` receives in total, which must outlive them; those for cache
+    // hits are already in it when Submit returns. A block may arrive in more
+    // than one completion when it is coalesced while its extent is landing.
+    std::size_t Submit(
+        const std::vector<IoRequest>& requests,
+        IoClock::time_point deadline,
+        ExtentPoller* poller);
+
+private:
+    struct Extent {
+        BlockRun run;
+        IoClock::time_point deadline;
+        std::uint64_t sequence{};
+        std::vector<ExtentPoller*> subscribers;
+        // Read destination, set once the extent is issued.
+        std::shared_ptr<AlignedBuffer> buffer;
+    };
+    using QueueKey = std::pair<IoClock::time_point, std::uint64_t>;
+
+    // BlockStorage::Stream callbacks of the I/O threads.
+    bool NextRead(bool idle, StreamRead* read);
+    void Landed(std::uint64_t sequence, bool ok);
+    void Complete(Extent* extent, std::shared_ptr<const std::uint8_t> data);
+
+    const BlockStorage& storage_;
+    BlockCache* cache_;
+    DiskIoBatchScheduler batcher_;
+    std::size_t queue_depth_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_{false};
+    std::uint64_t next_sequence_{0};
+    // Extents not yet issued, by deadline; every block of every extent that
+    // is queued or in flight; and the extents in flight, by sequence.
+    std::map<QueueKey, std::shared_ptr<Extent>> queued_;
+    std::unordered_map<std::uint64_t, std::shared_ptr<Extent>> pending_;
+    std::unordered_map<std::uint64_t, std::shared_ptr<Extent>> reading_;
+    // Eventfd that lets Submit reach the io_uring thread while it waits on
+    // reads in flight; -1 on pread.
+    int wake_fd_{-1};
+    std::vector<std::thread> io_threads_;
+};
+
 }  // namespace opengauss_demo
 
 #endif  // OPENGAUSS_VECTOR_ENGINE_DISKANN_SCHEDULER_H_
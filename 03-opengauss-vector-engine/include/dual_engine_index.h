@@ -1,10 +1,17 @@
 #ifndef OPENGAUSS_VECTOR_ENGINE_DUAL_ENGINE_INDEX_H_
 #define OPENGAUSS_VECTOR_ENGINE_DUAL_ENGINE_INDEX_H_
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <vector>
 
+#include "block_cache.h"
+#include "block_storage.h"
+#include "diskann_scheduler.h"
+#include "opq_rabitq.h"
+
 namespace opengauss_demo {
 
 struct SearchHit {
@@ -12,38 +19,179 @@ struct SearchHit {
     float distance{0.0F};
 };
 
+// Inverted-file layer over the disk path: k-means lists, probed per query.
+struct IvfOptions {
+    // Posting lists; 0 picks ~sqrt(N).
+    std::size_t nlist{0};
+    std::size_t kmeans_iterations{10};
+    // Rows sampled for training, per list.
+    std::size_t train_per_list{64};
+    std::uint32_t seed{42};
+};
+
+inline constexpr std::size_t kDefaultNprobe = 8;
+// Disk-path read budget per query, counted from query start.
+inline constexpr std::chrono::microseconds kDefaultIoDeadline{2000};
+
+// Per-query work of the disk path.
+struct DiskSearchStats {
+    // Codes scored in the probed lists.
+    std::size_t scanned{0};
+    // Candidates reranked on full-precision vectors.
+    std::size_t reranked{0};
+};
+
 struct EvaluationMetrics {
     double recall_at_k{0.0};
+    // Latency of exact search one query at a time (SearchMemory).
     std::uint64_t memory_p95_us{0};
+    // Ground truth comes from SearchMemoryBatch calls of up to 64 queries:
+    // the p95 of a whole call, and the queries per second they sustained.
+    std::uint64_t memory_batch_p95_us{0};
+    double memory_qps{0.0};
     std::uint64_t disk_p95_us{0};
+    // Mean fraction of the collection the disk path scored per query.
+    double disk_scan_fraction{0.0};
+    // Block cache lookups served without a read, over the disk queries.
+    double disk_cache_hit_rate{0.0};
+    // Mean candidates reranked per disk query: rerank_k, or at most that many
+    // as the error bound decides in 1-bit mode.
+    double disk_reranked_per_query{0.0};
+    // Resident code bytes per vector: packed at `bits` per dimension plus the
+    // code norm ADC needs (or the two RaBitQ factors at 1 bit), and the
+    // former layout of one byte per dimension plus a decoded float copy.
+    std::size_t code_bytes_per_vector{0};
+    std::size_t unpacked_bytes_per_vector{0};
+    // QuantizationMse() of the index.
+    float quantization_mse{0.0F};
 };
 
 class DualEngineIndex {
 public:
-    explicit DualEngineIndex(std::size_t dim, std::uint8_t bits = 6);
+    // `bits` in [4, 7] selects the scalar codec with ADC scoring, 1 selects
+    // one-bit RaBitQ codes of each vector's residual to its list centroid.
+    // `rotation` is applied before quantization; for scalar codes kOpq trains
+    // it at Build on a sample.
+    explicit DualEngineIndex(std::size_t dim, std::uint8_t bits = 6, const RotationOptions& rotation = {});
 
-    void Build(const std::vector<std::vector<float>>& vectors, std::size_t block_size = 64);
+    // Copies `vectors`, trains the IVF centroids and the rotation, and lays
+    // quantized codes out posting list by posting list, so every list covers
+    // a contiguous run of `block_size`-vector disk blocks. With `storage.path` set, the full
+    // vectors are written in that order to an aligned block file and the disk
+    // path reranks from it; otherwise it reranks from memory. A non-zero
+    // `cache.capacity_bytes` puts a block cache in front of the file and pins
+    // the blocks of the `cache.pinned_lists` largest lists. Throws
+    // std::runtime_error when the block file cannot be written or opened.
+    // With scalar codes the default kOpq rotation adds its training to the
+    // build: 8 rounds over an 8192-row sample, each encoding the sample and
+    // taking a one-sided Jacobi SVD of a dim x dim matrix. kIdentity and
+    // kHadamard train nothing.
+    void Build(
+        const std::vector<std::vector<float>>& vectors,
+        std::size_t block_size = 64,
+        const IvfOptions& ivf = {},
+        const BlockStorageOptions& storage = {},
+        const BlockCacheOptions& cache = {});
 
+    // Exact top-k of one query, scanned on the calling thread.
     std::vector<SearchHit> SearchMemory(const std::vector<float>& query, std::size_t top_k) const;
 
+    // Exact top-k for every query in one pass over the data: blocks of rows
+    // are scored against tiles of queries as ||x||^2 - 2 x.q (GEMM-style, with
+    // norms precomputed at Build) and folded straight into per-query bounded
+    // heaps. With more than one query, data blocks are spread over
+    // `num_threads` threads (0 = hardware concurrency); a single query is
+    // scanned inline. Results are in query order, L2 distances ascending.
+    std::vector<std::vector<SearchHit>> SearchMemoryBatch(
+        const std::vector<std::vector<float>>& queries,
+        std::size_t top_k,
+        std::size_t num_threads = 0) const;
+
+    // Scores the in-memory codes of the `nprobe` posting lists nearest the
+    // query, then reranks the best `rerank_k` on full-precision vectors. In
+    // 1-bit mode `rerank_k` is only a cap: the top_k by estimate are reranked,
+    // then the other candidates whose error-bounded lower bound is below the
+    // exact k-th distance they gave, lowest bound first. With
+    // block storage their blocks go to the shared async scheduler in one
+    // submission due `io_deadline` after the query started; cache hits are
+    // reranked at once and each merged extent as soon as it lands. Concurrent
+    // queries share reads of the same blocks. `stats`, if set, receives the
+    // query's work. Throws std::runtime_error when a read fails.
     std::vector<SearchHit> SearchDisk(
         const std::vector<float>& query,
         std::size_t top_k,
-        std::size_t rerank_k = 64) const;
+        std::size_t rerank_k = 64,
+        std::size_t nprobe = kDefaultNprobe,
+        DiskSearchStats* stats = nullptr,
+        std::chrono::microseconds io_deadline = kDefaultIoDeadline) const;
 
     EvaluationMetrics Evaluate(
         const std::vector<std::vector<float>>& queries,
         std::size_t top_k,
-        std::size_t rerank_k = 64) const;
+        std::size_t rerank_k = 64,
+        std::size_t nprobe = kDefaultNprobe) const;
+
+    // Mean squared error of the scalar codes measured at Build; 0 in 1-bit mode.
+    float QuantizationMse() const { return quantization_mse_; }
+    std::size_t ListCount() const { return list_offsets_.empty() ? 0 : list_offsets_.size() - 1; }
+    // Null unless Build wrote a block file.
+    const BlockStorage* Storage() const { return storage_.get(); }
+    // Null unless Build was given block storage and a cache budget.
+    const BlockCache* Cache() const { return cache_.get(); }
 
 private:
+    // Reads the blocks of the `list_count` longest posting lists and pins them
+    // in cache_; blocks whose shard has no unpinned frame to spare stay unpinned.
+    void PinLargestLists(std::size_t list_count);
+    // Appends the exact distance of each candidate (a disk position) to `out`,
+    // from memory or from the block file through io_, and adds the time spent
+    // waiting on reads and computing distances. Throws std::runtime_error
+    // when a read fails.
+    void Rerank(
+        const std::vector<float>& query,
+        const std::vector<SearchHit>& candidates,
+        IoClock::time_point deadline,
+        std::vector<SearchHit>* out,
+        std::uint64_t* wait_ns,
+        std::uint64_t* rerank_ns) const;
+    const float* Row(const std::uint32_t id) const { return data_.data() + static_cast<std::size_t>(id) * dim_; }
+    std::uint8_t* Code(const std::size_t position) { return codes_.Data() + position * code_bytes_; }
+    const std::uint8_t* Code(const std::size_t position) const { return codes_.Data() + position * code_bytes_; }
+    const float* RotatedCentroid(const std::size_t list) const { return rotated_centroids_.data() + list * dim_; }
+    std::uint64_t BlockOf(const std::size_t position) const { return position / block_size_; }
+
     std::size_t dim_;
     std::size_t block_size_;
     std::uint8_t bits_;
-    std::vector<std::vector<float>> vectors_;
-    std::vector<std::vector<float>> decoded_vectors_;
-    std::vector<std::vector<std::uint8_t>> quant_codes_;
-    std::vector<std::uint64_t> block_ids_;
+    RotationOptions rotation_;
+    std::size_t size_{0};
+    // Row-major size_ x dim_ copy of the input and the squared norm of each row.
+    std::vector<float> data_;
+    std::vector<float> norms_;
+    // IVF: ListCount() x dim_ centroids; list l owns disk positions
+    // [list_offsets_[l], list_offsets_[l + 1]). The vectors below are indexed
+    // by disk position, and position_ids_ maps a position back to its row id.
+    std::vector<float> centroids_;
+    std::vector<std::size_t> list_offsets_;
+    std::vector<std::uint32_t> position_ids_;
+    // Packed codes, one code_bytes_ stride per position, in one aligned
+    // arena. Exactly one codec is set: the scalar one with each code's norm
+    // for ADC, or the binary one with each code's factors and the centroids
+    // in its rotated space.
+    // Scalar codes quantize projector_'s output; queries are projected too.
+    OpqProjector projector_;
+    float quantization_mse_{0.0F};
+    std::unique_ptr<RabitQCodec> codec_;
+    std::unique_ptr<RabitQBinaryCodec> binary_;
+    std::size_t code_bytes_{0};
+    AlignedBuffer codes_;
+    std::vector<float> code_norms_;
+    std::vector<RabitQFactors> factors_;
+    std::vector<float> rotated_centroids_;
+    std::unique_ptr<BlockStorage> storage_;
+    std::unique_ptr<BlockCache> cache_;
+    // Declared last: its I/O thread stops before the cache and file go away.
+    std::unique_ptr<AsyncDiskIoScheduler> io_;
 };
 
 }  // namespace opengauss_demo
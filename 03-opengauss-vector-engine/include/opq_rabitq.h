@@ -7,34 +7,209 @@
 
 namespace opengauss_demo {
 
+enum class RotationKind {
+    kIdentity,
+    // Dense matrix learned by TrainOpq on a sample of the data.
+    kOpq,
+    // Randomized Walsh-Hadamard transform: O(d log d), nothing to train.
+    kHadamard,
+};
+
+const char* RotationKindName(RotationKind kind);
+
+struct RotationOptions {
+    // OPQ by default, which DualEngineIndex::Build pays for in training time.
+    RotationKind kind{RotationKind::kOpq};
+    // Rotation / codebook alternations of OPQ training.
+    std::size_t opq_iterations{8};
+    // Rows sampled for OPQ training.
+    std::size_t train_samples{8192};
+    std::uint32_t seed{42};
+};
+
+// Orthogonal transform applied before quantization: identity (as
+// constructed), a dense row-major matrix, or a randomized Hadamard transform.
 class OpqProjector {
 public:
+    // Randomized Hadamard rounds; three mix well enough for quantization.
+    static constexpr std::size_t kHadamardRounds = 3;
+
     explicit OpqProjector(std::size_t dim);
+    // kHadamardRounds rounds of random sign flips, each followed by a
+    // normalized Walsh-Hadamard transform. A dim that is not a power of two
+    // is covered by two overlapping power-of-two blocks, head and tail.
+    static OpqProjector RandomHadamard(std::size_t dim, std::uint32_t seed);
 
     void SetRotationMatrix(const std::vector<std::vector<float>>& matrix);
+    // Dim() x Dim(), row-major.
+    void SetRotationMatrix(std::vector<float> matrix);
     std::vector<float> Transform(const std::vector<float>& input) const;
+    // Rotates `count` row-major vectors from `input` into `output`, which must
+    // not alias it. A dense matrix goes through the register-tiled
+    // inner-product block kernel, GEMM style.
+    void TransformBatch(const float* input, std::size_t count, float* output) const;
+
+    std::size_t Dim() const { return dim_; }
 
 private:
+    enum class Kind { kIdentity, kDense, kHadamard };
+
+    Kind kind_{Kind::kIdentity};
     std::size_t dim_;
-    std::vector<std::vector<float>> rotation_;
+    // kDense: dim_ x dim_, row-major.
+    std::vector<float> rotation_;
+    // kHadamard: kHadamardRounds x dim_ signs, and the block length.
+    std::vector<float> signs_;
+    std::size_t hadamard_block_{0};
+};
+
+// Query prepared for asymmetric distance against codes: the cross term
+// sum_d w_d q'_d c_d becomes an integer dot product of the codes with
+// int8 weights (w = 1 / scale^2, q' the query in code space).
+struct AdcQuery {
+    // Natural dimension order, zero-padded to a multiple of 32.
+    std::vector<std::int8_t> weights;
+    // 4-bit codes only: each 32-dimension chunk as its even dimensions then
+    // its odd ones, the order nibbles unpack in.
+    std::vector<std::int8_t> nibble_weights;
+    // 5- to 7-bit codes only: `weights` widened to int16 for madd.
+    std::vector<std::int16_t> word_weights;
+    // weights[d] * scale ~= w_d q'_d.
+    float scale{1.0F};
+    // sum_d w_d q'_d^2.
+    float bias{0.0F};
 };
 
+// Per-dimension scalar quantizer with codes bit-packed at Bits() bits per
+// dimension, LSB first: dimension d occupies bits [d * Bits(), (d + 1) *
+// Bits()) of a CodeBytes()-byte code, so every 8 dimensions form one
+// Bits()-byte group.
 class RabitQCodec {
 public:
+    static constexpr std::size_t kCodePadding = 16;
+
     explicit RabitQCodec(std::uint8_t bits = 6);
 
     void Fit(const std::vector<std::vector<float>>& training_vectors);
+    // `count` row-major vectors of `dim` floats.
+    void Fit(const float* vectors, std::size_t count, std::size_t dim);
     std::vector<std::uint8_t> Encode(const std::vector<float>& vector) const;
+    // Packs `vector` (Dim() floats) into `out` (CodeBytes() bytes).
+    void EncodeTo(const float* vector, std::uint8_t* out) const;
     std::vector<float> Decode(const std::vector<std::uint8_t>& code) const;
+    // Unpacks a CodeBytes()-byte code into Dim() floats.
+    void DecodeTo(const std::uint8_t* code, float* out) const;
+
+    AdcQuery PrepareQuery(const float* query) const;
+    // sum_d w_d c_d^2 of a code; computed once per code at build time.
+    float CodeNorm(const std::uint8_t* code) const;
+    // Approximate squared L2 from the query to each of `count` consecutive
+    // codes (CodeBytes() apart) as bias + norm - 2 * scale * dot, straight
+    // off the packed bytes with no float decode. With AVX2, 4-bit codes split
+    // into nibbles for u8 x s8 maddubs; wider codes unpack 16 dimensions per
+    // pshufb + mullo into 16-bit lanes for madd. Otherwise a scalar loop.
+    // kCodePadding bytes past the last code must be readable.
+    void L2SqrBatch(
+        const AdcQuery& query,
+        const std::uint8_t* codes,
+        const float* norms,
+        std::size_t count,
+        float* out) const;
 
     std::size_t Dim() const;
     std::uint8_t Bits() const;
+    std::size_t CodeBytes() const;
 
 private:
     std::uint8_t bits_;
     std::size_t dim_;
     std::vector<float> min_per_dim_;
     std::vector<float> scale_per_dim_;
+    // 1 / scale^2: code-space differences back to squared input units.
+    std::vector<float> weight_per_dim_;
+};
+
+// OPQ for the scalar codec: alternates fitting a `bits`-bit RabitQCodec to
+// the rotated sample with the orthogonal Procrustes update R = U V^T, where
+// U S V^T is the SVD of sum_i y_i x_i^T and y_i is sample x_i's decoded code.
+// Starts from identity and returns the rotation with the lowest mean squared
+// quantization error seen. `error`, if set, receives that error.
+OpqProjector TrainOpq(
+    const float* samples,
+    std::size_t count,
+    std::size_t dim,
+    std::uint8_t bits,
+    std::size_t iterations,
+    float* error = nullptr);
+
+// Haar-random dim x dim orthogonal matrix: Gram-Schmidt over Gaussian rows.
+std::vector<std::vector<float>> RandomOrthogonalMatrix(std::size_t dim, std::uint32_t seed);
+
+// Per-vector scalars stored next to a binary code.
+struct RabitQFactors {
+    // ||o_r||, o_r = P (x - c) the rotated residual to the list centroid.
+    float residual_norm{0.0F};
+    // <o_bar, o>: cosine between the unit residual o and its sign code o_bar.
+    // The estimate is divided by it, and its error bound grows as it shrinks.
+    float alignment{1.0F};
+};
+
+// Rotated unit query residual q', uniformly quantized to kQueryBits bits per
+// dimension (q'_d ~= lower + step * level_d) and split into bit planes, so
+// sum_d b_d level_d = sum_j 2^j popcount(b & plane_j).
+struct RabitQBinaryQuery {
+    // kQueryBits planes of Words() words, least significant plane first.
+    std::vector<std::uint64_t> planes;
+    float lower{0.0F};
+    float step{0.0F};
+    // sum_d level_d.
+    float level_sum{0.0F};
+    // ||q_r||.
+    float residual_norm{0.0F};
+};
+
+// One-bit RaBitQ (Gao & Long, SIGMOD 2024). Residuals to a centroid are
+// rotated by a random orthogonal P and kept as one sign bit per dimension,
+// packed 64 to a word, plus RabitQFactors. <o, q> is estimated without bias as
+// <o_bar, q> / <o_bar, o>, and with high probability lies within
+// kErrorEpsilon * sqrt((1 - <o_bar, o>^2) / <o_bar, o>^2) / sqrt(Dim() - 1) of
+// the truth; EstimateBatch turns both into squared L2 terms.
+class RabitQBinaryCodec {
+public:
+    static constexpr unsigned kQueryBits = 4;
+    // Confidence multiplier of the error bound (the paper's epsilon_0).
+    static constexpr float kErrorEpsilon = 1.9F;
+
+    // `rotation` kHadamard uses the randomized Hadamard transform for P;
+    // any other kind a dense Haar-random matrix, since RaBitQ's bound needs
+    // a random rotation.
+    RabitQBinaryCodec(std::size_t dim, std::uint32_t seed, RotationKind rotation = RotationKind::kOpq);
+
+    // P x for `count` row-major vectors. Centroids are rotated once, so
+    // residuals come as differences.
+    void Rotate(const float* vectors, std::size_t count, float* out) const;
+    // Sign code of rotated - rotated_centroid into `out` (CodeBytes() bytes,
+    // 8-byte aligned).
+    RabitQFactors EncodeTo(const float* rotated, const float* rotated_centroid, std::uint8_t* out) const;
+    RabitQBinaryQuery PrepareQuery(const float* rotated_query, const float* rotated_centroid) const;
+    // Estimated squared L2 from the query to each of `count` consecutive codes
+    // and the bound on its error, with AND + popcount over the query planes.
+    void EstimateBatch(
+        const RabitQBinaryQuery& query,
+        const std::uint8_t* codes,
+        const RabitQFactors* factors,
+        std::size_t count,
+        float* distance,
+        float* error) const;
+
+    std::size_t Dim() const { return dim_; }
+    std::size_t Words() const { return words_; }
+    std::size_t CodeBytes() const { return words_ * sizeof(std::uint64_t); }
+
+private:
+    std::size_t dim_;
+    std::size_t words_;
+    OpqProjector rotation_;
 };
 
 }  // namespace opengauss_demo
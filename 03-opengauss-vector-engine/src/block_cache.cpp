@@ -0,0 +1,161 @@
+#include "block_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace opengauss_demo {
+
+namespace {
+
+struct CacheCounters {
+    ann_common::Counter& hits = ann_common::EngineCounter(
+        "ann_disk_cache_hits_total", "opengauss", "Block reads served from the block cache.");
+    ann_common::Counter& misses = ann_common::EngineCounter(
+        "ann_disk_cache_misses_total", "opengauss", "Block reads that missed the block cache and went to storage.");
+    ann_common::Counter& evictions = ann_common::EngineCounter(
+        "ann_disk_cache_evictions_total", "opengauss", "Blocks evicted from the block cache by CLOCK.");
+};
+
+const CacheCounters& GlobalCounters() {
+    static const CacheCounters counters;
+    return counters;
+}
+
+// Block ids of one posting list are consecutive, so spread them with a
+// multiplicative hash rather than modulo.
+std::size_t ShardIndex(const std::uint64_t block, const std::size_t shard_count) {
+    return static_cast<std::size_t>((block * 0x9E3779B97F4A7C15ULL) >> 32) % shard_count;
+}
+
+}  // namespace
+
+BlockCache::BlockCache(const std::size_t block_bytes, const BlockCacheOptions& options)
+    : block_bytes_(block_bytes) {
+    const std::size_t capacity_blocks = block_bytes == 0 ? 0 : options.capacity_bytes / block_bytes;
+    if (capacity_blocks == 0) {
+        return;
+    }
+    const std::size_t shard_count = std::clamp<std::size_t>(options.shards, 1, capacity_blocks);
+    frames_per_shard_ = capacity_blocks / shard_count;
+    shards_.reserve(shard_count);
+    for (std::size_t idx = 0; idx < shard_count; ++idx) {
+        auto shard = std::make_unique<Shard>();
+        shard->frames.resize(frames_per_shard_);
+        shard->data.Reserve(frames_per_shard_ * block_bytes_);
+        shard->index.reserve(frames_per_shard_);
+        shards_.push_back(std::move(shard));
+    }
+}
+
+std::size_t BlockCache::CapacityBlocks() const {
+    return frames_per_shard_ * shards_.size();
+}
+
+BlockCache::Shard& BlockCache::ShardFor(const std::uint64_t block) const {
+    return *shards_[ShardIndex(block, shards_.size())];
+}
+
+bool BlockCache::Lookup(const std::uint64_t block, std::uint8_t* out) {
+    if (shards_.empty()) {
+        return false;
+    }
+    Shard& shard = ShardFor(block);
+    {
+        const std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto found = shard.index.find(block);
+        if (found != shard.index.end()) {
+            shard.frames[found->second].referenced = true;
+            std::memcpy(out, shard.data.Data() + found->second * block_bytes_, block_bytes_);
+            hits_.Add();
+            GlobalCounters().hits.Add();
+            return true;
+        }
+    }
+    misses_.Add();
+    GlobalCounters().misses.Add();
+    return false;
+}
+
+bool BlockCache::Place(Shard* shard, const std::uint64_t block, std::size_t* frame) {
+    const auto found = shard->index.find(block);
+    if (found != shard->index.end()) {
+        *frame = found->second;
+        return true;
+    }
+    if (shard->pinned == shard->frames.size()) {
+        return false;
+    }
+    // CLOCK: clear reference bits until an unreferenced, unpinned frame comes
+    // round. Two sweeps always suffice since at least one frame is unpinned.
+    for (;;) {
+        Frame& candidate = shard->frames[shard->hand];
+        const std::size_t current = shard->hand;
+        shard->hand = (shard->hand + 1) % shard->frames.size();
+        if (candidate.pinned) {
+            continue;
+        }
+        if (candidate.valid && candidate.referenced) {
+            candidate.referenced = false;
+            continue;
+        }
+        if (candidate.valid) {
+            shard->index.erase(candidate.block);
+            evictions_.Add();
+            GlobalCounters().evictions.Add();
+        }
+        candidate = Frame{.block = block, .valid = true, .referenced = false, .pinned = false};
+        shard->index.emplace(block, current);
+        *frame = current;
+        return true;
+    }
+}
+
+void BlockCache::Insert(const std::uint64_t block, const std::uint8_t* data) {
+    if (shards_.empty()) {
+        return;
+    }
+    Shard& shard = ShardFor(block);
+    const std::lock_guard<std::mutex> lock(shard.mutex);
+    std::size_t frame = 0;
+    if (Place(&shard, block, &frame)) {
+        std::memcpy(shard.data.Data() + frame * block_bytes_, data, block_bytes_);
+    }
+}
+
+bool BlockCache::Pin(const std::uint64_t block, const std::uint8_t* data) {
+    if (shards_.empty()) {
+        return false;
+    }
+    Shard& shard = ShardFor(block);
+    const std::lock_guard<std::mutex> lock(shard.mutex);
+    std::size_t frame = 0;
+    // Keep one frame per shard unpinned so misses can still be cached.
+    const bool resident = shard.index.count(block) > 0;
+    if (!resident && shard.pinned + 1 >= shard.frames.size()) {
+        return false;
+    }
+    if (!Place(&shard, block, &frame)) {
+        return false;
+    }
+    std::memcpy(shard.data.Data() + frame * block_bytes_, data, block_bytes_);
+    if (!shard.frames[frame].pinned) {
+        shard.frames[frame].pinned = true;
+        ++shard.pinned;
+    }
+    return true;
+}
+
+BlockCacheStats BlockCache::Stats() const {
+    BlockCacheStats stats;
+    stats.hits = hits_.Value();
+    stats.misses = misses_.Value();
+    stats.evictions = evictions_.Value();
+    for (const auto& shard : shards_) {
+        const std::lock_guard<std::mutex> lock(shard->mutex);
+        stats.resident_blocks += shard->index.size();
+        stats.pinned_blocks += shard->pinned;
+    }
+    return stats;
+}
+
+}  // namespace opengauss_demo
@@ -0,0 +1,672 @@
+#include "block_storage.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define OPENGAUSS_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#else
+#define OPENGAUSS_HAS_IO_URING 0
+#endif
+
+namespace opengauss_demo {
+
+namespace {
+
+std::exception_ptr IoError(const std::string& what, const std::string& path, const int error) {
+    return std::make_exception_ptr(std::runtime_error(what + " " + path + ": " + std::strerror(error)));
+}
+
+[[noreturn]] void ThrowIo(const std::string& what, const std::string& path, const int error = errno) {
+    std::rethrow_exception(IoError(what, path, error));
+}
+
+// pread until `bytes` are in or the file ends; short reads are retried.
+void ReadFully(const int fd, std::uint8_t* out, std::size_t bytes, off_t offset, const std::string& path) {
+    while (bytes > 0) {
+        const ssize_t got = ::pread(fd, out, bytes, offset);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            ThrowIo("cannot read", path);
+        }
+        if (got == 0) {
+            throw std::runtime_error("unexpected end of block file " + path);
+        }
+        out += got;
+        bytes -= static_cast<std::size_t>(got);
+        offset += got;
+    }
+}
+
+}  // namespace
+
+const char* IoBackendName(const IoBackend backend) {
+    switch (backend) {
+        case IoBackend::kIoUring:
+            return "io_uring";
+        case IoBackend::kPread:
+            return "pread";
+        case IoBackend::kAuto:
+            break;
+    }
+    return "auto";
+}
+
+AlignedBuffer::AlignedBuffer(const std::size_t bytes) {
+    Reserve(bytes);
+}
+
+void AlignedBuffer::Reserve(const std::size_t bytes) {
+    if (bytes <= size_) {
+        return;
+    }
+    const std::size_t rounded = BlockStorage::AlignBlockBytes(bytes);
+    auto* raw = static_cast<std::uint8_t*>(std::aligned_alloc(BlockStorage::kAlignment, rounded));
+    if (raw == nullptr) {
+        throw std::bad_alloc();
+    }
+    data_.reset(raw);
+    size_ = rounded;
+}
+
+// Raw io_uring (no liburing): SQ/CQ rings and the SQE array are mmapped from
+// the ring fd, and each submission is one IORING_OP_READV per block run.
+struct BlockStorage::Ring {
+#if OPENGAUSS_HAS_IO_URING
+    static std::unique_ptr<Ring> Create(const unsigned entries) {
+        io_uring_params params{};
+        const int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return nullptr;
+        }
+        auto ring = std::make_unique<Ring>();
+        ring->fd = fd;
+        ring->sq_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->cq_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+            ring->sq_bytes = ring->cq_bytes = std::max(ring->sq_bytes, ring->cq_bytes);
+        }
+        ring->sq_ptr = ::mmap(
+            nullptr, ring->sq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (ring->sq_ptr == MAP_FAILED) {
+            return nullptr;
+        }
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+            ring->cq_ptr = ring->sq_ptr;
+        } else {
+            ring->cq_ptr = ::mmap(
+                nullptr, ring->cq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (ring->cq_ptr == MAP_FAILED) {
+                return nullptr;
+            }
+        }
+        ring->sqe_bytes = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(
+            nullptr, ring->sqe_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return nullptr;
+        }
+        ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq = static_cast<std::uint8_t*>(ring->sq_ptr);
+        ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        ring->sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        ring->entries = params.sq_entries;
+        auto* cq = static_cast<std::uint8_t*>(ring->cq_ptr);
+        ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        ring->cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return ring;
+    }
+
+    ~Ring() {
+        if (sqes != nullptr) {
+            ::munmap(sqes, sqe_bytes);
+        }
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) {
+            ::munmap(cq_ptr, cq_bytes);
+        }
+        if (sq_ptr != MAP_FAILED) {
+            ::munmap(sq_ptr, sq_bytes);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    // Queues one readv; the caller keeps `iov` alive until its completion.
+    void PushRead(const int file, const iovec* iov, const off_t offset, const std::uint64_t tag) {
+        io_uring_sqe& sqe = NextSqe();
+        sqe.opcode = IORING_OP_READV;
+        sqe.fd = file;
+        sqe.addr = reinterpret_cast<std::uint64_t>(iov);
+        sqe.len = 1;
+        sqe.off = static_cast<std::uint64_t>(offset);
+        sqe.user_data = tag;
+        Commit();
+    }
+
+    // Zeroed SQE at the tail; Commit() publishes it.
+    io_uring_sqe& NextSqe() {
+        const unsigned slot = *sq_tail & sq_mask;
+        std::memset(&sqes[slot], 0, sizeof(io_uring_sqe));
+        sq_array[slot] = slot;
+        return sqes[slot];
+    }
+
+    void Commit() { __atomic_store_n(sq_tail, *sq_tail + 1, __ATOMIC_RELEASE); }
+
+    // Queues a one-shot poll for `file` becoming readable.
+    void PushPoll(const int file, const std::uint64_t tag) {
+        io_uring_sqe& sqe = NextSqe();
+        sqe.opcode = IORING_OP_POLL_ADD;
+        sqe.fd = file;
+        sqe.poll_events = POLLIN;
+        sqe.user_data = tag;
+        Commit();
+    }
+
+    // Queues the cancellation of the poll queued under `target`.
+    void PushPollRemove(const std::uint64_t target, const std::uint64_t tag) {
+        io_uring_sqe& sqe = NextSqe();
+        sqe.opcode = IORING_OP_POLL_REMOVE;
+        sqe.fd = -1;
+        sqe.addr = target;
+        sqe.user_data = tag;
+        Commit();
+    }
+
+    // Withdraws the last `count` queued SQEs. Safe while the kernel has not
+    // taken them: without SQPOLL it only reads the SQ inside Enter.
+    void Unqueue(const unsigned count) {
+        __atomic_store_n(sq_tail, *sq_tail - count, __ATOMIC_RELEASE);
+    }
+
+    // Submits `count` queued SQEs and blocks until at least one completes.
+    // Returns how many SQEs the kernel took, which may be fewer than `count`
+    // (it then returns without waiting), or -1 with errno set.
+    int Enter(const unsigned count) const {
+        int submitted = 0;
+        do {
+            submitted = static_cast<int>(
+                ::syscall(__NR_io_uring_enter, fd, count, /*min_complete=*/1, IORING_ENTER_GETEVENTS, nullptr, 0));
+        } while (submitted < 0 && errno == EINTR);
+        return submitted;
+    }
+
+    // Pops one completion if any: returns false when the CQ is empty.
+    bool Reap(std::uint64_t* tag, int* result) {
+        const unsigned head = *cq_head;
+        if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        const io_uring_cqe& cqe = cqes[head & cq_mask];
+        *tag = cqe.user_data;
+        *result = cqe.res;
+        __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    int fd{-1};
+    unsigned entries{0};
+    void* sq_ptr{MAP_FAILED};
+    void* cq_ptr{MAP_FAILED};
+    std::size_t sq_bytes{0};
+    std::size_t cq_bytes{0};
+    std::size_t sqe_bytes{0};
+    io_uring_sqe* sqes{nullptr};
+    unsigned* sq_tail{nullptr};
+    unsigned sq_mask{0};
+    unsigned* sq_array{nullptr};
+    unsigned* cq_head{nullptr};
+    unsigned* cq_tail{nullptr};
+    unsigned cq_mask{0};
+    io_uring_cqe* cqes{nullptr};
+#else
+    static std::unique_ptr<Ring> Create(unsigned /*entries*/) { return nullptr; }
+#endif
+};
+
+BlockStorage::Ring* BlockStorage::ThreadRing(const std::size_t entries) {
+#if OPENGAUSS_HAS_IO_URING
+    thread_local std::unique_ptr<Ring> ring;
+    if (!ring || ring->entries < entries) {
+        ring = Ring::Create(static_cast<unsigned>(entries));
+    }
+    return ring.get();
+#else
+    (void)entries;
+    return nullptr;
+#endif
+}
+
+std::size_t BlockStorage::AlignBlockBytes(const std::size_t payload_bytes) {
+    return std::max<std::size_t>(1, (payload_bytes + kAlignment - 1) / kAlignment) * kAlignment;
+}
+
+void BlockStorage::Write(
+    const std::string& path,
+    const std::size_t block_bytes,
+    const std::size_t block_count,
+    const std::function<void(std::size_t block, std::uint8_t* out)>& fill) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        ThrowIo("cannot create", path);
+    }
+    // Staged about 1 MB at a time so large collections stream out.
+    constexpr std::size_t kStageBytes = std::size_t{1} << 20;
+    const std::size_t stage_blocks = std::max<std::size_t>(1, kStageBytes / block_bytes);
+    std::vector<std::uint8_t> stage(stage_blocks * block_bytes);
+    for (std::size_t first = 0; first < block_count; first += stage_blocks) {
+        const std::size_t count = std::min(stage_blocks, block_count - first);
+        std::fill(stage.begin(), stage.end(), 0);
+        for (std::size_t block = 0; block < count; ++block) {
+            fill(first + block, stage.data() + block * block_bytes);
+        }
+        const std::uint8_t* data = stage.data();
+        std::size_t remaining = count * block_bytes;
+        while (remaining > 0) {
+            const ssize_t wrote = ::write(fd, data, remaining);
+            if (wrote < 0 && errno == EINTR) {
+                continue;
+            }
+            if (wrote < 0) {
+                const int error = errno;
+                ::close(fd);
+                ThrowIo("cannot write", path, error);
+            }
+            data += wrote;
+            remaining -= static_cast<std::size_t>(wrote);
+        }
+    }
+    // Later O_DIRECT reads must see the data on the device, not just in cache.
+    if (::fsync(fd) != 0 || ::close(fd) != 0) {
+        ThrowIo("cannot flush", path);
+    }
+}
+
+std::unique_ptr<BlockStorage> BlockStorage::Open(
+    const std::string& path,
+    const std::size_t block_bytes,
+    const BlockStorageOptions& options) {
+    if (block_bytes == 0 || block_bytes % kAlignment != 0) {
+        throw std::runtime_error("block size must be a multiple of " + std::to_string(kAlignment));
+    }
+    std::unique_ptr<BlockStorage> storage(new BlockStorage());
+    storage->path_ = path;
+    storage->block_bytes_ = block_bytes;
+    storage->queue_depth_ = std::max<std::size_t>(1, options.queue_depth);
+    if (options.direct_io) {
+        storage->fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+        storage->direct_ = storage->fd_ >= 0;
+    }
+    if (storage->fd_ < 0) {
+        storage->fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    if (storage->fd_ < 0) {
+        ThrowIo("cannot open", path);
+    }
+    struct stat info {};
+    if (::fstat(storage->fd_, &info) != 0) {
+        ThrowIo("cannot stat", path);
+    }
+    const auto file_bytes = static_cast<std::size_t>(info.st_size);
+    if (file_bytes % block_bytes != 0) {
+        throw std::runtime_error("block file " + path + " is not a whole number of blocks");
+    }
+    storage->block_count_ = file_bytes / block_bytes;
+
+    if (options.backend != IoBackend::kPread) {
+        if (ThreadRing(storage->queue_depth_) != nullptr) {
+            storage->backend_ = IoBackend::kIoUring;
+        } else if (options.backend == IoBackend::kIoUring) {
+            ThrowIo("io_uring unavailable for", path);
+        }
+    }
+    return storage;
+}
+
+BlockStorage::~BlockStorage() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void BlockStorage::Read(const std::vector<BlockRun>& runs, std::uint8_t* out) const {
+    std::vector<std::uint8_t*> destinations;
+    destinations.reserve(runs.size());
+    for (const BlockRun& run : runs) {
+        destinations.push_back(out);
+        out += run.block_count * block_bytes_;
+    }
+    Read(runs, destinations);
+}
+
+void BlockStorage::Read(
+    const std::vector<BlockRun>& runs,
+    const std::vector<std::uint8_t*>& destinations,
+    const std::function<void(std::size_t run)>& on_complete) const {
+    for (const BlockRun& run : runs) {
+        if (run.first_block + run.block_count > block_count_) {
+            throw std::runtime_error("block run past the end of " + path_);
+        }
+    }
+    if (backend_ == IoBackend::kIoUring) {
+        ReadIoUring(runs, destinations, on_complete);
+    } else {
+        ReadPread(runs, destinations, on_complete);
+    }
+}
+
+void BlockStorage::ReadPread(
+    const std::vector<BlockRun>& runs,
+    const std::vector<std::uint8_t*>& destinations,
+    const std::function<void(std::size_t run)>& on_complete) const {
+    for (std::size_t idx = 0; idx < runs.size(); ++idx) {
+        ReadFully(
+            fd_, destinations[idx], runs[idx].block_count * block_bytes_,
+            static_cast<off_t>(runs[idx].first_block * block_bytes_), path_);
+        if (on_complete) {
+            on_complete(idx);
+        }
+    }
+}
+
+void BlockStorage::ReadIoUring(
+    const std::vector<BlockRun>& runs,
+    const std::vector<std::uint8_t*>& destinations,
+    const std::function<void(std::size_t run)>& on_complete) const {
+#if OPENGAUSS_HAS_IO_URING
+    std::vector<iovec> iovs(runs.size());
+    for (std::size_t idx = 0; idx < runs.size(); ++idx) {
+        iovs[idx].iov_base = destinations[idx];
+        iovs[idx].iov_len = runs[idx].block_count * block_bytes_;
+    }
+
+    Ring* const ring = ThreadRing(queue_depth_);
+    if (ring == nullptr) {
+        // This thread could not set up a ring of its own.
+        ReadPread(runs, destinations, on_complete);
+        return;
+    }
+    const std::size_t depth = std::min<std::size_t>(queue_depth_, ring->entries);
+    std::size_t next = 0;
+    // SQEs in the ring the kernel has not taken yet, and reads it has taken
+    // that have not completed.
+    unsigned unsubmitted = 0;
+    std::size_t in_flight = 0;
+    // First failure. From then on nothing new is submitted, but every taken
+    // read is still reaped before returning: the kernel writes into `iovs` and
+    // the destinations until it completes, and a later call must not see its
+    // CQE.
+    std::exception_ptr failure;
+    while (in_flight > 0 || (failure == nullptr && (next < runs.size() || unsubmitted > 0))) {
+        if (failure == nullptr) {
+            for (; next < runs.size() && in_flight + unsubmitted < depth; ++next, ++unsubmitted) {
+                ring->PushRead(
+                    fd_, &iovs[next], static_cast<off_t>(runs[next].first_block * block_bytes_), next);
+            }
+        } else if (unsubmitted > 0) {
+            ring->Unqueue(unsubmitted);
+            unsubmitted = 0;
+        }
+        const int submitted = ring->Enter(unsubmitted);
+        if (submitted < 0) {
+            if (failure == nullptr) {
+                failure = IoError("io_uring_enter failed on", path_, errno);
+            }
+            ring->Unqueue(unsubmitted);
+            unsubmitted = 0;
+            // Completions still land in the mapped CQ; poll it instead.
+            std::this_thread::yield();
+        } else {
+            unsubmitted -= static_cast<unsigned>(submitted);
+            in_flight += static_cast<std::size_t>(submitted);
+        }
+        std::uint64_t tag = 0;
+        int result = 0;
+        while (ring->Reap(&tag, &result)) {
+            if (tag >= runs.size()) {
+                // Left over from a stream's wake poll on this thread.
+                continue;
+            }
+            --in_flight;
+            if (failure != nullptr) {
+                continue;
+            }
+            if (result < 0) {
+                failure = IoError("cannot read", path_, -result);
+                continue;
+            }
+            try {
+                // Rare short completion: finish the run synchronously.
+                const auto got = static_cast<std::size_t>(result);
+                if (got < iovs[tag].iov_len) {
+                    ReadFully(
+                        fd_, static_cast<std::uint8_t*>(iovs[tag].iov_base) + got, iovs[tag].iov_len - got,
+                        static_cast<off_t>(runs[tag].first_block * block_bytes_ + got), path_);
+                }
+                if (on_complete) {
+                    on_complete(tag);
+                }
+            } catch (...) {
+                failure = std::current_exception();
+            }
+        }
+    }
+    if (failure != nullptr) {
+        std::rethrow_exception(failure);
+    }
+#else
+    ReadPread(runs, destinations, on_complete);
+#endif
+}
+
+void BlockStorage::Stream(
+    const std::function<bool(bool idle, StreamRead* read)>& next,
+    const std::function<void(std::uint64_t tag, bool ok)>& on_complete,
+    const int wake_fd) const {
+    // One SQE beyond the queue depth stays free for the wake poll.
+    Ring* const ring = backend_ == IoBackend::kIoUring ? ThreadRing(queue_depth_ + 1) : nullptr;
+    if (ring == nullptr) {
+        StreamPread(next, on_complete);
+        return;
+    }
+    StreamIoUring(ring, next, on_complete, wake_fd);
+}
+
+void BlockStorage::StreamPread(
+    const std::function<bool(bool idle, StreamRead* read)>& next,
+    const std::function<void(std::uint64_t tag, bool ok)>& on_complete) const {
+    StreamRead read;
+    while (next(/*idle=*/true, &read)) {
+        bool ok = read.run.first_block + read.run.block_count <= block_count_;
+        if (ok) {
+            try {
+                ReadFully(
+                    fd_, read.destination, read.run.block_count * block_bytes_,
+                    static_cast<off_t>(read.run.first_block * block_bytes_), path_);
+            } catch (const std::exception&) {
+                ok = false;
+            }
+        }
+        on_complete(read.tag, ok);
+    }
+}
+
+void BlockStorage::StreamIoUring(
+    Ring* const ring,
+    const std::function<bool(bool idle, StreamRead* read)>& next,
+    const std::function<void(std::uint64_t tag, bool ok)>& on_complete,
+    const int wake_fd) const {
+#if OPENGAUSS_HAS_IO_URING
+    // Reads are tagged with their slot; the wake poll and its cancellation
+    // use tags no slot can have.
+    constexpr std::uint64_t kWakeTag = ~std::uint64_t{0};
+    constexpr std::uint64_t kCancelTag = kWakeTag - 1;
+    struct Slot {
+        iovec iov{};
+        StreamRead read;
+    };
+    const std::size_t depth = std::min<std::size_t>(queue_depth_, ring->entries - 1);
+    std::vector<Slot> slots(depth);
+    std::vector<std::uint64_t> free_slots(depth);
+    std::iota(free_slots.rbegin(), free_slots.rend(), 0);
+    // Tags queued in the SQ that the kernel has not taken yet, in order.
+    std::vector<std::uint64_t> queued;
+    bool poll_armed = false;
+    bool done = false;
+    // First exception from a callback. From then on nothing new is issued and
+    // no callback runs, but every taken read is still reaped: the kernel
+    // writes into `slots` and the destinations until it completes.
+    std::exception_ptr failure;
+    auto complete = [&](const std::uint64_t slot, const bool ok) {
+        free_slots.push_back(slot);
+        if (failure != nullptr) {
+            return;
+        }
+        try {
+            on_complete(slots[slot].read.tag, ok);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+    };
+    // Takes back what the kernel has not taken; withdrawn reads fail.
+    auto withdraw = [&]() {
+        ring->Unqueue(static_cast<unsigned>(queued.size()));
+        for (const std::uint64_t tag : queued) {
+            if (tag == kWakeTag) {
+                poll_armed = false;
+            } else {
+                complete(tag, false);
+            }
+        }
+        queued.clear();
+    };
+
+    for (;;) {
+        while (failure == nullptr && !done && !free_slots.empty()) {
+            StreamRead read;
+            const bool idle = free_slots.size() == depth;
+            try {
+                if (!next(idle, &read)) {
+                    done = idle;
+                    break;
+                }
+            } catch (...) {
+                failure = std::current_exception();
+                break;
+            }
+            const std::uint64_t slot = free_slots.back();
+            free_slots.pop_back();
+            slots[slot].read = read;
+            if (read.run.first_block + read.run.block_count > block_count_) {
+                complete(slot, false);
+                continue;
+            }
+            slots[slot].iov.iov_base = read.destination;
+            slots[slot].iov.iov_len = read.run.block_count * block_bytes_;
+            ring->PushRead(fd_, &slots[slot].iov, static_cast<off_t>(read.run.first_block * block_bytes_), slot);
+            queued.push_back(slot);
+        }
+        if (failure != nullptr) {
+            withdraw();
+        }
+        if (free_slots.size() == depth && (done || failure != nullptr)) {
+            break;
+        }
+        if (wake_fd >= 0 && !poll_armed && failure == nullptr) {
+            ring->PushPoll(wake_fd, kWakeTag);
+            queued.push_back(kWakeTag);
+            poll_armed = true;
+        }
+
+        const int submitted = ring->Enter(static_cast<unsigned>(queued.size()));
+        if (submitted < 0) {
+            withdraw();
+            // Completions still land in the mapped CQ; poll it instead.
+            std::this_thread::yield();
+        } else {
+            queued.erase(queued.begin(), queued.begin() + submitted);
+        }
+        std::uint64_t tag = 0;
+        int result = 0;
+        while (ring->Reap(&tag, &result)) {
+            if (tag == kWakeTag) {
+                poll_armed = false;
+                std::uint64_t count = 0;
+                (void)::read(wake_fd, &count, sizeof(count));
+                continue;
+            }
+            if (tag >= depth) {
+                // Left over from an earlier stream's poll cancellation.
+                continue;
+            }
+            bool ok = result >= 0;
+            const auto got = static_cast<std::size_t>(std::max(result, 0));
+            if (ok && got < slots[tag].iov.iov_len) {
+                // Rare short completion: finish the run synchronously.
+                try {
+                    ReadFully(
+                        fd_, static_cast<std::uint8_t*>(slots[tag].iov.iov_base) + got, slots[tag].iov.iov_len - got,
+                        static_cast<off_t>(slots[tag].read.run.first_block * block_bytes_ + got), path_);
+                } catch (const std::exception&) {
+                    ok = false;
+                }
+            }
+            complete(tag, ok);
+        }
+    }
+
+    // The thread's ring outlives the stream: cancel the wake poll so its
+    // completion does not land in a later read.
+    withdraw();
+    if (poll_armed) {
+        ring->PushPollRemove(kWakeTag, kCancelTag);
+        unsigned to_submit = 1;
+        bool cancelled = false;
+        while (poll_armed || !cancelled) {
+            const int submitted = ring->Enter(to_submit);
+            if (submitted < 0) {
+                ring->Unqueue(to_submit);
+                break;
+            }
+            to_submit -= static_cast<unsigned>(submitted);
+            std::uint64_t tag = 0;
+            int result = 0;
+            while (ring->Reap(&tag, &result)) {
+                poll_armed = poll_armed && tag != kWakeTag;
+                cancelled = cancelled || tag == kCancelTag;
+            }
+        }
+    }
+    if (failure != nullptr) {
+        std::rethrow_exception(failure);
+    }
+#else
+    (void)ring;
+    (void)wake_fd;
+    StreamPread(next, on_complete);
+#endif
+}
+
+}  // namespace opengauss_demo
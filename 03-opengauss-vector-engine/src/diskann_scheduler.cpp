@@ -1,13 +1,18 @@
 #include "diskann_scheduler.h"
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 #include <algorithm>
-#include <chrono>
-#include <thread>
+#include <cstring>
+#include <new>
+
+#include "metrics.h"
 
 namespace opengauss_demo {
 
 DiskIoBatchScheduler::DiskIoBatchScheduler(const std::size_t max_batch_size)
-    : max_batch_size_(max_batch_size) {}
+    : max_batch_size_(std::max<std::size_t>(1, max_batch_size)) {}
 
 std::vector<IoRequest> DiskIoBatchScheduler::Execute(const std::vector<IoRequest>& requests) const {
     std::vector<IoRequest> ordered = requests;
@@ -17,28 +22,278 @@ std::vector<IoRequest> DiskIoBatchScheduler::Execute(const std::vector<IoRequest
         }
         return lhs.block_id < rhs.block_id;
     });
+    return ordered;
+}
 
-    // Simulate async batched I/O submission.
-    for (std::size_t start = 0; start < ordered.size(); start += max_batch_size_) {
-        std::this_thread::sleep_for(std::chrono::microseconds(80));
+std::vector<BlockRun> DiskIoBatchScheduler::MergeRuns(const std::vector<IoRequest>& ordered) const {
+    std::vector<BlockRun> runs;
+    for (const IoRequest& request : ordered) {
+        if (!runs.empty()) {
+            BlockRun& last = runs.back();
+            const std::uint64_t last_block = last.first_block + last.block_count - 1;
+            if (request.block_id == last_block) {
+                continue;
+            }
+            if (request.block_id == last_block + 1 && last.block_count < max_batch_size_) {
+                ++last.block_count;
+                continue;
+            }
+        }
+        runs.push_back(BlockRun{.first_block = request.block_id, .block_count = 1});
     }
-    return ordered;
+    return runs;
 }
 
 std::size_t DiskIoBatchScheduler::EstimateMergedOps(const std::vector<IoRequest>& ordered) const {
-    if (ordered.empty()) {
-        return 0;
+    return MergeRuns(ordered).size();
+}
+
+namespace {
+
+struct SchedulerMetrics {
+    ann_common::Counter& merged_io_ops = ann_common::EngineCounter(
+        "ann_disk_merged_io_ops_total", "opengauss", "Block reads issued after the scheduler merged requests.");
+    ann_common::Counter& read_bytes = ann_common::EngineCounter(
+        "ann_disk_read_bytes_total", "opengauss", "Bytes read from the block file by the disk path.");
+    ann_common::Counter& coalesced = ann_common::EngineCounter(
+        "ann_disk_coalesced_extents_total", "opengauss",
+        "Extent completions delivered to a query that joined another query's read.");
+    ann_common::Counter& deadline_misses = ann_common::EngineCounter(
+        "ann_disk_deadline_misses_total", "opengauss", "Extents that landed after their earliest query deadline.");
+};
+
+const SchedulerMetrics& Metrics() {
+    static const SchedulerMetrics metrics;
+    return metrics;
+}
+
+}  // namespace
+
+AsyncDiskIoScheduler::AsyncDiskIoScheduler(
+    const BlockStorage& storage,
+    BlockCache* cache,
+    const AsyncIoOptions& options)
+    : storage_(storage),
+      cache_(cache),
+      batcher_(options.max_batch_size),
+      queue_depth_(std::max<std::size_t>(1, options.queue_depth)) {
+    // Registers the counters up front so readers find them before the first read.
+    Metrics();
+    std::size_t threads = queue_depth_;
+    if (storage_.Backend() == IoBackend::kIoUring) {
+        threads = 1;
+        wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    auto run = [this] {
+        storage_.Stream(
+            [this](const bool idle, StreamRead* read) { return NextRead(idle, read); },
+            [this](const std::uint64_t sequence, const bool ok) { Landed(sequence, ok); },
+            wake_fd_);
+    };
+    io_threads_.reserve(threads);
+    for (std::size_t idx = 0; idx < threads; ++idx) {
+        io_threads_.emplace_back(run);
+    }
+}
+
+AsyncDiskIoScheduler::~AsyncDiskIoScheduler() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& thread : io_threads_) {
+        thread.join();
+    }
+    if (wake_fd_ >= 0) {
+        ::close(wake_fd_);
+    }
+}
+
+std::size_t AsyncDiskIoScheduler::Submit(
+    const std::vector<IoRequest>& requests,
+    const IoClock::time_point deadline,
+    ExtentPoller* poller) {
+    std::vector<std::uint64_t> blocks;
+    blocks.reserve(requests.size());
+    for (const IoRequest& request : requests) {
+        blocks.push_back(request.block_id);
+    }
+    std::sort(blocks.begin(), blocks.end());
+    blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+
+    // Hits are looked up into per-thread staging, then copied into one buffer
+    // sized to them and delivered a block at a time once the misses are queued.
+    const std::size_t block_bytes = storage_.BlockBytes();
+    thread_local AlignedBuffer staging;
+    std::vector<std::uint64_t> hits;
+    std::vector<IoRequest> misses;
+    if (cache_ != nullptr) {
+        staging.Reserve(blocks.size() * block_bytes);
+    }
+    for (const std::uint64_t block : blocks) {
+        if (cache_ != nullptr && cache_->Lookup(block, staging.Data() + hits.size() * block_bytes)) {
+            hits.push_back(block);
+        } else {
+            misses.push_back(IoRequest{.node_id = 0, .block_id = block});
+        }
+    }
+
+    std::size_t completions = hits.size();
+    std::size_t queued_extents = 0;
+    bool nudge = false;
+    if (!misses.empty()) {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<const Extent*> joined;
+        std::vector<IoRequest> fresh;
+        for (const IoRequest& miss : misses) {
+            const auto found = pending_.find(miss.block_id);
+            if (found == pending_.end()) {
+                fresh.push_back(miss);
+                continue;
+            }
+            Extent* extent = found->second.get();
+            if (std::find(joined.begin(), joined.end(), extent) != joined.end()) {
+                continue;
+            }
+            joined.push_back(extent);
+            extent->subscribers.push_back(poller);
+            ++completions;
+            // A more urgent query pulls a still-queued extent forward.
+            const auto queued = queued_.find(QueueKey{extent->deadline, extent->sequence});
+            if (deadline < extent->deadline && queued != queued_.end()) {
+                std::shared_ptr<Extent> owner = std::move(queued->second);
+                queued_.erase(queued);
+                owner->deadline = deadline;
+                queued_.emplace(QueueKey{deadline, owner->sequence}, std::move(owner));
+            }
+        }
+        for (const BlockRun& run : batcher_.MergeRuns(fresh)) {
+            auto extent = std::make_shared<Extent>();
+            extent->run = run;
+            extent->deadline = deadline;
+            extent->sequence = next_sequence_++;
+            extent->subscribers.push_back(poller);
+            for (std::size_t block = 0; block < run.block_count; ++block) {
+                pending_[run.first_block + block] = extent;
+            }
+            queued_.emplace(QueueKey{deadline, extent->sequence}, std::move(extent));
+            ++completions;
+            ++queued_extents;
+        }
+        // With nothing in flight the io_uring thread waits on wake_ instead.
+        nudge = queued_extents > 0 && wake_fd_ >= 0 && !reading_.empty();
+    }
+    for (std::size_t idx = 0; idx < queued_extents; ++idx) {
+        wake_.notify_one();
+    }
+    if (nudge) {
+        const std::uint64_t one = 1;
+        (void)::write(wake_fd_, &one, sizeof(one));
+    }
+
+    if (!hits.empty()) {
+        auto hit_buffer = std::make_shared<AlignedBuffer>(hits.size() * block_bytes);
+        std::memcpy(hit_buffer->Data(), staging.Data(), hits.size() * block_bytes);
+        for (std::size_t idx = 0; idx < hits.size(); ++idx) {
+            poller->Push(ExtentCompletion{
+                .run = BlockRun{.first_block = hits[idx], .block_count = 1},
+                .data = std::shared_ptr<const std::uint8_t>(hit_buffer, hit_buffer->Data() + idx * block_bytes)});
+        }
     }
+    return completions;
+}
 
-    std::size_t merged_ops = 1;
-    std::uint64_t prev_block = ordered.front().block_id;
-    for (std::size_t idx = 1; idx < ordered.size(); ++idx) {
-        if (ordered[idx].block_id > prev_block + 1) {
-            ++merged_ops;
+bool AsyncDiskIoScheduler::NextRead(const bool idle, StreamRead* read) {
+    for (;;) {
+        std::shared_ptr<Extent> extent;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (idle) {
+                wake_.wait(lock, [this] { return stopping_ || !queued_.empty(); });
+            }
+            if (queued_.empty() || (!idle && reading_.size() >= queue_depth_)) {
+                return false;
+            }
+            extent = std::move(queued_.begin()->second);
+            queued_.erase(queued_.begin());
+            reading_.emplace(extent->sequence, extent);
         }
-        prev_block = ordered[idx].block_id;
+        const std::size_t bytes = extent->run.block_count * storage_.BlockBytes();
+        try {
+            extent->buffer = std::make_shared<AlignedBuffer>(bytes);
+        } catch (const std::bad_alloc&) {
+            Landed(extent->sequence, false);
+            continue;
+        }
+        Metrics().merged_io_ops.Add();
+        Metrics().read_bytes.Add(bytes);
+        *read = StreamRead{.run = extent->run, .destination = extent->buffer->Data(), .tag = extent->sequence};
+        return true;
     }
-    return merged_ops;
+}
+
+void AsyncDiskIoScheduler::Landed(const std::uint64_t sequence, const bool ok) {
+    std::shared_ptr<Extent> extent;
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        const auto found = reading_.find(sequence);
+        extent = std::move(found->second);
+        reading_.erase(found);
+    }
+    Complete(extent.get(), ok ? std::shared_ptr<const std::uint8_t>(extent->buffer, extent->buffer->Data()) : nullptr);
+}
+
+void AsyncDiskIoScheduler::Complete(Extent* extent, std::shared_ptr<const std::uint8_t> data) {
+    const SchedulerMetrics& metrics = Metrics();
+    const std::size_t block_bytes = storage_.BlockBytes();
+    if (cache_ != nullptr && data != nullptr) {
+        for (std::size_t block = 0; block < extent->run.block_count; ++block) {
+            cache_->Insert(extent->run.first_block + block, data.get() + block * block_bytes);
+        }
+    }
+    std::vector<ExtentPoller*> subscribers;
+    bool late = false;
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        for (std::size_t block = 0; block < extent->run.block_count; ++block) {
+            const auto found = pending_.find(extent->run.first_block + block);
+            if (found != pending_.end() && found->second.get() == extent) {
+                pending_.erase(found);
+            }
+        }
+        subscribers = std::move(extent->subscribers);
+        late = IoClock::now() > extent->deadline;
+    }
+    if (late) {
+        metrics.deadline_misses.Add();
+    }
+    metrics.coalesced.Add(subscribers.size() - 1);
+    for (ExtentPoller* subscriber : subscribers) {
+        subscriber->Push(ExtentCompletion{.run = extent->run, .data = data});
+    }
+}
+
+void ExtentPoller::Push(ExtentCompletion completion) {
+    bool wake = false;
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        completions_.push_back(std::move(completion));
+        wake = waiting_;
+    }
+    if (wake) {
+        ready_.notify_one();
+    }
+}
+
+ExtentCompletion ExtentPoller::Next() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiting_ = true;
+    ready_.wait(lock, [this] { return !completions_.empty(); });
+    waiting_ = false;
+    ExtentCompletion completion = std::move(completions_.front());
+    completions_.pop_front();
+    return completion;
 }
 
 }  // namespace opengauss_demo
@@ -1,53 +1,159 @@
 #include "dual_engine_index.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
+#include <cstring>
 #include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "diskann_scheduler.h"
+#include "distance.h"
+#include "kmeans.h"
+#include "metrics.h"
 #include "opq_rabitq.h"
 
 namespace opengauss_demo {
 
 namespace {
 
-float L2(const std::vector<float>& lhs, const std::vector<float>& rhs) {
-    if (lhs.size() != rhs.size()) {
-        return std::numeric_limits<float>::max();
+// Exact-search tiling: a block of rows stays in L2 while every query tile is
+// scored against it, and one tile of dot products fits in L1.
+constexpr std::size_t kDataBlockRows = 256;
+constexpr std::size_t kQueryTile = 16;
+// Rows x queries below which another scan thread costs more than it saves.
+constexpr std::size_t kMinScanPerThread = std::size_t{1} << 16;
+// Queries per SearchMemoryBatch call when Evaluate builds ground truth.
+constexpr std::size_t kEvaluateBatch = 64;
+
+// Ranking runs on squared L2; hits are converted back to L2 once at the end.
+float L2Sqr(const std::vector<float>& lhs, const float* rhs) {
+    return ann_common::L2Sqr(lhs.data(), rhs, lhs.size());
+}
+
+bool CloserHit(const SearchHit& lhs, const SearchHit& rhs) {
+    return lhs.distance < rhs.distance;
+}
+
+// Max-heap of the `capacity` closest hits seen so far; front() is the worst.
+class BoundedHits {
+public:
+    explicit BoundedHits(const std::size_t capacity) : capacity_(capacity) { hits_.reserve(capacity); }
+
+    float Threshold() const {
+        return hits_.size() < capacity_ ? std::numeric_limits<float>::max() : hits_.front().distance;
     }
-    float sum = 0.0F;
-    for (std::size_t idx = 0; idx < lhs.size(); ++idx) {
-        const float diff = lhs[idx] - rhs[idx];
-        sum += diff * diff;
+
+    void Push(const std::uint32_t id, const float distance) {
+        if (hits_.size() < capacity_) {
+            hits_.push_back(SearchHit{.id = id, .distance = distance});
+            std::push_heap(hits_.begin(), hits_.end(), CloserHit);
+            return;
+        }
+        std::pop_heap(hits_.begin(), hits_.end(), CloserHit);
+        hits_.back() = SearchHit{.id = id, .distance = distance};
+        std::push_heap(hits_.begin(), hits_.end(), CloserHit);
     }
-    return std::sqrt(sum);
-}
 
-std::vector<SearchHit> TopKFromDistances(const std::vector<float>& distances, std::size_t top_k) {
-    std::vector<SearchHit> hits;
-    hits.reserve(distances.size());
-    for (std::size_t idx = 0; idx < distances.size(); ++idx) {
-        hits.push_back(SearchHit{.id = static_cast<std::uint32_t>(idx), .distance = distances[idx]});
+    const std::vector<SearchHit>& Hits() const { return hits_; }
+
+private:
+    std::size_t capacity_;
+    std::vector<SearchHit> hits_;
+};
+
+std::vector<SearchHit> ToL2Distances(std::vector<SearchHit> hits) {
+    for (SearchHit& hit : hits) {
+        hit.distance = std::sqrt(hit.distance);
     }
+    return hits;
+}
+
+// The `top_k` closest of `hits`, ascending.
+std::vector<SearchHit> TopKHits(std::vector<SearchHit> hits, const std::size_t top_k) {
     if (hits.size() > top_k) {
-        std::nth_element(
-            hits.begin(),
-            hits.begin() + static_cast<long>(top_k),
-            hits.end(),
-            [](const SearchHit& lhs, const SearchHit& rhs) { return lhs.distance < rhs.distance; });
+        std::nth_element(hits.begin(), hits.begin() + static_cast<long>(top_k), hits.end(), CloserHit);
         hits.resize(top_k);
     }
-    std::sort(
-        hits.begin(),
-        hits.end(),
-        [](const SearchHit& lhs, const SearchHit& rhs) { return lhs.distance < rhs.distance; });
+    std::sort(hits.begin(), hits.end(), CloserHit);
     return hits;
 }
 
+// `count` rows of the row-major `rows` x `dim` matrix `data`, picked by a
+// seeded shuffle.
+std::vector<float> SampleRows(
+    const std::vector<float>& data,
+    const std::size_t rows,
+    const std::size_t dim,
+    const std::size_t count,
+    const std::uint32_t seed) {
+    std::vector<std::uint32_t> order(rows);
+    std::iota(order.begin(), order.end(), 0);
+    std::mt19937 rng(seed);
+    std::shuffle(order.begin(), order.end(), rng);
+    std::vector<float> sample;
+    sample.reserve(count * dim);
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        const float* row = data.data() + static_cast<std::size_t>(order[idx]) * dim;
+        sample.insert(sample.end(), row, row + dim);
+    }
+    return sample;
+}
+
+// The two 1-bit rerank rounds: the top_k hits by estimate into `first`, and
+// every other hit into `rest` with its lower bound (estimate - error) as its
+// distance.
+void SplitByEstimate(
+    const std::vector<SearchHit>& hits,
+    const std::vector<float>& errors,
+    const std::size_t top_k,
+    std::vector<SearchHit>* first,
+    std::vector<SearchHit>* rest) {
+    std::vector<std::uint32_t> order(hits.size());
+    std::iota(order.begin(), order.end(), 0);
+    const std::size_t split = std::min(top_k, hits.size());
+    std::nth_element(
+        order.begin(), order.begin() + static_cast<long>(split), order.end(),
+        [&hits](const std::uint32_t lhs, const std::uint32_t rhs) { return hits[lhs].distance < hits[rhs].distance; });
+    first->reserve(split);
+    rest->reserve(hits.size() - split);
+    for (std::size_t idx = 0; idx < order.size(); ++idx) {
+        const SearchHit& hit = hits[order[idx]];
+        if (idx < split) {
+            first->push_back(hit);
+        } else {
+            rest->push_back(SearchHit{.id = hit.id, .distance = hit.distance - errors[order[idx]]});
+        }
+    }
+}
+
+// Per-stage histograms for both paths; each query records one sample per stage.
+struct EngineMetrics {
+    ann_common::LatencyHistogram& memory_distance = ann_common::StageLatency("opengauss_memory", "distance");
+    ann_common::LatencyHistogram& memory_topk = ann_common::StageLatency("opengauss_memory", "topk_reduce");
+    ann_common::LatencyHistogram& memory_query = ann_common::StageLatency("opengauss_memory", "query");
+    ann_common::LatencyHistogram& disk_probe = ann_common::StageLatency("opengauss_disk", "probe");
+    ann_common::LatencyHistogram& disk_io = ann_common::StageLatency("opengauss_disk", "io");
+    ann_common::LatencyHistogram& disk_distance = ann_common::StageLatency("opengauss_disk", "distance");
+    ann_common::LatencyHistogram& disk_topk = ann_common::StageLatency("opengauss_disk", "topk_reduce");
+    ann_common::LatencyHistogram& disk_rerank = ann_common::StageLatency("opengauss_disk", "rerank");
+    ann_common::LatencyHistogram& disk_query = ann_common::StageLatency("opengauss_disk", "query");
+    ann_common::Counter& io_requests = ann_common::EngineCounter(
+        "ann_disk_io_requests_total", "opengauss", "Node reads requested from the disk path before merging.");
+};
+
+const EngineMetrics& Metrics() {
+    static const EngineMetrics metrics;
+    return metrics;
+}
+
 std::uint64_t P95(std::vector<std::uint64_t> values) {
     if (values.empty()) {
         return 0;
@@ -59,123 +165,538 @@ std::uint64_t P95(std::vector<std::uint64_t> values) {
 
 }  // namespace
 
-DualEngineIndex::DualEngineIndex(const std::size_t dim, const std::uint8_t bits)
-    : dim_(dim), block_size_(64), bits_(bits) {}
-
-void DualEngineIndex::Build(const std::vector<std::vector<float>>& vectors, const std::size_t block_size) {
+DualEngineIndex::DualEngineIndex(const std::size_t dim, const std::uint8_t bits, const RotationOptions& rotation)
+    : dim_(dim),
+      block_size_(64),
+      bits_(bits),
+      rotation_(rotation),
+      projector_(dim),
+      codec_(bits == 1 ? nullptr : std::make_unique<RabitQCodec>(bits)) {}
+
+void DualEngineIndex::Build(
+    const std::vector<std::vector<float>>& vectors,
+    const std::size_t block_size,
+    const IvfOptions& ivf,
+    const BlockStorageOptions& storage,
+    const BlockCacheOptions& cache) {
     block_size_ = std::max<std::size_t>(1, block_size);
-    vectors_ = vectors;
-    decoded_vectors_.clear();
-    quant_codes_.clear();
-    block_ids_.clear();
-
-    if (vectors_.empty()) {
+    size_ = vectors.size();
+    data_.clear();
+    data_.reserve(size_ * dim_);
+    norms_.clear();
+    norms_.reserve(size_);
+    for (const auto& vector : vectors) {
+        data_.insert(data_.end(), vector.begin(), vector.end());
+        norms_.push_back(ann_common::InnerProduct(vector.data(), vector.data(), dim_));
+    }
+    centroids_.clear();
+    list_offsets_.clear();
+    position_ids_.clear();
+    codes_ = AlignedBuffer();
+    code_norms_.clear();
+    factors_.clear();
+    rotated_centroids_.clear();
+    projector_ = OpqProjector(dim_);
+    quantization_mse_ = 0.0F;
+    io_.reset();
+    cache_.reset();
+    storage_.reset();
+
+    if (size_ == 0) {
         return;
     }
 
-    OpqProjector projector(dim_);
-    // Use identity rotation by default. In production this matrix is learned offline.
+    // Coarse quantizer, trained on a random sample of rows.
+    std::size_t nlist = ivf.nlist > 0 ? ivf.nlist : static_cast<std::size_t>(std::sqrt(static_cast<double>(size_)));
+    nlist = std::clamp<std::size_t>(nlist, 1, size_);
+    const std::size_t sample_count = std::min(size_, std::max(nlist, nlist * ivf.train_per_list));
+    std::vector<float> sample;
+    const float* training = data_.data();
+    if (sample_count < size_) {
+        sample = SampleRows(data_, size_, dim_, sample_count, ivf.seed);
+        training = sample.data();
+    }
+    centroids_ = ann_common::TrainKMeans(training, sample_count, dim_, dim_, nlist, ivf.kmeans_iterations, ivf.seed);
+    nlist = centroids_.size() / dim_;
+
+    // Counting sort of rows by list: posting lists are contiguous on disk.
+    std::vector<std::uint32_t> assignment(size_);
+    list_offsets_.assign(nlist + 1, 0);
+    for (std::size_t row = 0; row < size_; ++row) {
+        assignment[row] = static_cast<std::uint32_t>(
+            ann_common::NearestCentroid(centroids_.data(), nlist, dim_, Row(static_cast<std::uint32_t>(row))));
+        ++list_offsets_[assignment[row] + 1];
+    }
+    std::partial_sum(list_offsets_.begin(), list_offsets_.end(), list_offsets_.begin());
+    position_ids_.resize(size_);
+    std::vector<std::size_t> cursor(list_offsets_.begin(), list_offsets_.end() - 1);
+    for (std::size_t row = 0; row < size_; ++row) {
+        position_ids_[cursor[assignment[row]]++] = static_cast<std::uint32_t>(row);
+    }
 
-    std::vector<std::vector<float>> projected;
-    projected.reserve(vectors_.size());
-    for (const auto& vector : vectors_) {
-        projected.push_back(projector.Transform(vector));
+    if (bits_ == 1) {
+        // RaBitQ codes each vector's residual to its own list centroid, all in
+        // one rotated space.
+        binary_ = std::make_unique<RabitQBinaryCodec>(dim_, rotation_.seed, rotation_.kind);
+        code_bytes_ = binary_->CodeBytes();
+        rotated_centroids_.resize(nlist * dim_);
+        binary_->Rotate(centroids_.data(), nlist, rotated_centroids_.data());
+        std::vector<float> rotated(size_ * dim_);
+        binary_->Rotate(data_.data(), size_, rotated.data());
+        codes_.Reserve(size_ * code_bytes_);
+        factors_.resize(size_);
+        for (std::size_t list = 0; list < nlist; ++list) {
+            for (std::size_t position = list_offsets_[list]; position < list_offsets_[list + 1]; ++position) {
+                factors_[position] = binary_->EncodeTo(
+                    rotated.data() + static_cast<std::size_t>(position_ids_[position]) * dim_, RotatedCentroid(list),
+                    Code(position));
+            }
+        }
+    } else {
+        if (rotation_.kind == RotationKind::kOpq) {
+            const std::size_t train_count = std::min(size_, std::max<std::size_t>(1, rotation_.train_samples));
+            const std::vector<float> train = SampleRows(data_, size_, dim_, train_count, rotation_.seed);
+            projector_ = TrainOpq(train.data(), train_count, dim_, bits_, rotation_.opq_iterations);
+        } else if (rotation_.kind == RotationKind::kHadamard) {
+            projector_ = OpqProjector::RandomHadamard(dim_, rotation_.seed);
+        }
+        // Every row rotated once, in row order.
+        std::vector<float> projected(size_ * dim_);
+        projector_.TransformBatch(data_.data(), size_, projected.data());
+
+        codec_ = std::make_unique<RabitQCodec>(bits_);
+        codec_->Fit(projected.data(), size_, dim_);
+        code_bytes_ = codec_->CodeBytes();
+        codes_.Reserve(size_ * code_bytes_ + RabitQCodec::kCodePadding);
+        code_norms_.resize(size_);
+        std::vector<float> decoded(dim_);
+        double squared_error = 0.0;
+        for (std::size_t position = 0; position < size_; ++position) {
+            const float* row = projected.data() + static_cast<std::size_t>(position_ids_[position]) * dim_;
+            codec_->EncodeTo(row, Code(position));
+            code_norms_[position] = codec_->CodeNorm(Code(position));
+            codec_->DecodeTo(Code(position), decoded.data());
+            squared_error += ann_common::L2Sqr(row, decoded.data(), dim_);
+        }
+        quantization_mse_ = static_cast<float>(squared_error / static_cast<double>(size_));
     }
 
-    RabitQCodec codec(bits_);
-    codec.Fit(projected);
+    if (!storage.path.empty()) {
+        const std::size_t row_bytes = dim_ * sizeof(float);
+        const std::size_t block_bytes = BlockStorage::AlignBlockBytes(block_size_ * row_bytes);
+        const std::size_t block_count = (size_ + block_size_ - 1) / block_size_;
+        BlockStorage::Write(storage.path, block_bytes, block_count, [&](const std::size_t block, std::uint8_t* out) {
+            const std::size_t end = std::min(size_, (block + 1) * block_size_);
+            for (std::size_t position = block * block_size_; position < end; ++position) {
+                std::memcpy(out, Row(position_ids_[position]), row_bytes);
+                out += row_bytes;
+            }
+        });
+        storage_ = BlockStorage::Open(storage.path, block_bytes, storage);
+        if (cache.capacity_bytes >= block_bytes) {
+            cache_ = std::make_unique<BlockCache>(block_bytes, cache);
+            PinLargestLists(cache.pinned_lists);
+        }
+        io_ = std::make_unique<AsyncDiskIoScheduler>(
+            *storage_, cache_.get(), AsyncIoOptions{.queue_depth = storage.queue_depth});
+    }
+}
 
-    quant_codes_.reserve(projected.size());
-    decoded_vectors_.reserve(projected.size());
-    block_ids_.reserve(projected.size());
-    for (std::size_t idx = 0; idx < projected.size(); ++idx) {
-        const auto code = codec.Encode(projected[idx]);
-        quant_codes_.push_back(code);
-        decoded_vectors_.push_back(codec.Decode(code));
-        block_ids_.push_back(idx / block_size_);
+void DualEngineIndex::PinLargestLists(const std::size_t list_count) {
+    std::vector<std::size_t> lists(ListCount());
+    std::iota(lists.begin(), lists.end(), 0);
+    const std::size_t pin = std::min(list_count, lists.size());
+    std::partial_sort(
+        lists.begin(), lists.begin() + static_cast<long>(pin), lists.end(),
+        [this](const std::size_t lhs, const std::size_t rhs) {
+            return list_offsets_[lhs + 1] - list_offsets_[lhs] > list_offsets_[rhs + 1] - list_offsets_[rhs];
+        });
+    const std::size_t block_bytes = storage_->BlockBytes();
+    AlignedBuffer buffer;
+    for (std::size_t idx = 0; idx < pin; ++idx) {
+        const std::size_t list = lists[idx];
+        if (list_offsets_[list] == list_offsets_[list + 1]) {
+            continue;
+        }
+        const BlockRun run{
+            .first_block = BlockOf(list_offsets_[list]),
+            .block_count = BlockOf(list_offsets_[list + 1] - 1) - BlockOf(list_offsets_[list]) + 1};
+        buffer.Reserve(run.block_count * block_bytes);
+        storage_->Read({run}, buffer.Data());
+        for (std::size_t block = 0; block < run.block_count; ++block) {
+            cache_->Pin(run.first_block + block, buffer.Data() + block * block_bytes);
+        }
     }
 }
 
 std::vector<SearchHit> DualEngineIndex::SearchMemory(const std::vector<float>& query, const std::size_t top_k) const {
-    std::vector<float> distances(vectors_.size(), std::numeric_limits<float>::max());
-    for (std::size_t idx = 0; idx < vectors_.size(); ++idx) {
-        distances[idx] = L2(query, vectors_[idx]);
+    if (query.size() != dim_) {
+        return {};
+    }
+    return SearchMemoryBatch({query}, top_k).front();
+}
+
+std::vector<std::vector<SearchHit>> DualEngineIndex::SearchMemoryBatch(
+    const std::vector<std::vector<float>>& queries,
+    const std::size_t top_k,
+    const std::size_t num_threads) const {
+    std::vector<std::vector<SearchHit>> results(queries.size());
+    std::vector<std::size_t> valid;
+    valid.reserve(queries.size());
+    for (std::size_t idx = 0; idx < queries.size(); ++idx) {
+        if (queries[idx].size() == dim_) {
+            valid.push_back(idx);
+        }
+    }
+    if (valid.empty() || size_ == 0 || top_k == 0) {
+        return results;
+    }
+
+    const auto query_start = std::chrono::steady_clock::now();
+    const std::size_t query_count = valid.size();
+    std::vector<float> packed(query_count * dim_);
+    for (std::size_t slot = 0; slot < query_count; ++slot) {
+        std::copy(queries[valid[slot]].begin(), queries[valid[slot]].end(), packed.begin() + slot * dim_);
+    }
+
+    const std::size_t block_count = (size_ + kDataBlockRows - 1) / kDataBlockRows;
+    const std::size_t hardware = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    const std::size_t useful = std::max<std::size_t>(1, size_ * query_count / kMinScanPerThread);
+    // A lone query is scanned inline: SearchMemory would otherwise start and
+    // join threads on every call once the collection is large enough.
+    const std::size_t workers =
+        query_count == 1 ? 1 : std::min({num_threads > 0 ? num_threads : hardware, useful, block_count});
+
+    // Each worker claims whole data blocks and keeps its own heaps, so the
+    // scan shares nothing but the block counter.
+    std::atomic<std::size_t> next_block{0};
+    std::vector<std::vector<BoundedHits>> partial(workers);
+    auto scan = [&](const std::size_t worker) {
+        std::vector<BoundedHits>& heaps = partial[worker];
+        heaps.assign(query_count, BoundedHits(top_k));
+        std::vector<float> dots(kQueryTile * kDataBlockRows);
+        for (std::size_t block = next_block.fetch_add(1); block < block_count; block = next_block.fetch_add(1)) {
+            const std::size_t first = block * kDataBlockRows;
+            const std::size_t rows = std::min(kDataBlockRows, size_ - first);
+            for (std::size_t tile = 0; tile < query_count; tile += kQueryTile) {
+                const std::size_t tile_size = std::min(kQueryTile, query_count - tile);
+                ann_common::InnerProductBlock(
+                    packed.data() + tile * dim_, tile_size, dim_, Row(static_cast<std::uint32_t>(first)), rows, dim_,
+                    dim_, dots.data(), kDataBlockRows);
+                // ||q||^2 is the same for every row, so ranking skips it.
+                for (std::size_t lane = 0; lane < tile_size; ++lane) {
+                    BoundedHits& heap = heaps[tile + lane];
+                    const float* lane_dots = dots.data() + lane * kDataBlockRows;
+                    float threshold = heap.Threshold();
+                    for (std::size_t row = 0; row < rows; ++row) {
+                        const float partial_distance = norms_[first + row] - 2.0F * lane_dots[row];
+                        if (partial_distance < threshold) {
+                            heap.Push(static_cast<std::uint32_t>(first + row), partial_distance);
+                            threshold = heap.Threshold();
+                        }
+                    }
+                }
+            }
+        }
+    };
+    if (workers == 1) {
+        scan(0);
+    } else {
+        std::vector<std::thread> threads;
+        threads.reserve(workers - 1);
+        for (std::size_t worker = 1; worker < workers; ++worker) {
+            threads.emplace_back(scan, worker);
+        }
+        scan(0);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
     }
-    return TopKFromDistances(distances, top_k);
+
+    const auto topk_start = std::chrono::steady_clock::now();
+    for (std::size_t slot = 0; slot < query_count; ++slot) {
+        std::vector<SearchHit> hits;
+        hits.reserve(workers * top_k);
+        for (const auto& heaps : partial) {
+            const auto& worker_hits = heaps[slot].Hits();
+            hits.insert(hits.end(), worker_hits.begin(), worker_hits.end());
+        }
+        const std::size_t keep = std::min(top_k, hits.size());
+        std::partial_sort(hits.begin(), hits.begin() + static_cast<long>(keep), hits.end(), CloserHit);
+        hits.resize(keep);
+        const float query_norm = ann_common::InnerProduct(packed.data() + slot * dim_, packed.data() + slot * dim_, dim_);
+        for (SearchHit& hit : hits) {
+            hit.distance = std::max(0.0F, hit.distance + query_norm);
+        }
+        results[valid[slot]] = ToL2Distances(std::move(hits));
+    }
+
+    // The scan fuses distance and top-k, so "distance" covers both and
+    // "topk_reduce" is the cross-worker merge; samples are per-query shares.
+    const auto end = std::chrono::steady_clock::now();
+    auto share = [query_count](const std::chrono::steady_clock::duration elapsed) {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+               query_count;
+    };
+    const EngineMetrics& metrics = Metrics();
+    for (std::size_t slot = 0; slot < query_count; ++slot) {
+        metrics.memory_distance.Record(share(topk_start - query_start));
+        metrics.memory_topk.Record(share(end - topk_start));
+        metrics.memory_query.Record(share(end - query_start));
+    }
+    return results;
 }
 
 std::vector<SearchHit> DualEngineIndex::SearchDisk(
     const std::vector<float>& query,
     const std::size_t top_k,
-    const std::size_t rerank_k) const {
-    if (vectors_.empty()) {
+    const std::size_t rerank_k,
+    const std::size_t nprobe,
+    DiskSearchStats* stats,
+    const std::chrono::microseconds io_deadline) const {
+    if (size_ == 0 || query.size() != dim_) {
         return {};
     }
 
-    std::vector<IoRequest> requests;
-    requests.reserve(vectors_.size());
-    for (std::size_t idx = 0; idx < vectors_.size(); ++idx) {
-        requests.push_back(IoRequest{.node_id = static_cast<std::uint32_t>(idx), .block_id = block_ids_[idx]});
+    const EngineMetrics& metrics = Metrics();
+    const auto query_start = std::chrono::steady_clock::now();
+    const std::size_t nlist = ListCount();
+    const std::size_t probe_count = std::clamp<std::size_t>(nprobe, 1, nlist);
+    std::vector<SearchHit> lists(nlist);
+    {
+        const ann_common::ScopedLatency probe_timer(metrics.disk_probe);
+        std::vector<float> centroid_dist(nlist);
+        ann_common::DistanceBatch(
+            ann_common::Metric::kL2Sqr, query.data(), centroids_.data(), nlist, dim_, dim_, centroid_dist.data());
+        for (std::size_t list = 0; list < nlist; ++list) {
+            lists[list] = SearchHit{.id = static_cast<std::uint32_t>(list), .distance = centroid_dist[list]};
+        }
+        lists = TopKHits(std::move(lists), probe_count);
     }
 
-    DiskIoBatchScheduler scheduler(/*max_batch_size=*/16);
-    const std::vector<IoRequest> ordered = scheduler.Execute(requests);
-
-    std::vector<float> coarse_dist(vectors_.size(), std::numeric_limits<float>::max());
-    for (const auto& request : ordered) {
-        const std::uint32_t id = request.node_id;
-        coarse_dist[id] = L2(query, decoded_vectors_[id]);
+    // Codes are resident, so coarse scoring reads no blocks. Coarse hits
+    // carry disk positions until rerank maps them to row ids.
+    // In 1-bit mode `errors` holds each coarse hit's error bound.
+    std::vector<SearchHit> coarse;
+    std::vector<float> errors;
+    {
+        const ann_common::ScopedLatency distance_timer(metrics.disk_distance);
+        // Each posting list is one contiguous run of the code arena.
+        std::vector<float> distances;
+        if (binary_) {
+            std::vector<float> rotated_query(dim_);
+            binary_->Rotate(query.data(), 1, rotated_query.data());
+            for (const SearchHit& list : lists) {
+                const std::size_t begin = list_offsets_[list.id];
+                const std::size_t count = list_offsets_[list.id + 1] - begin;
+                const RabitQBinaryQuery prepared = binary_->PrepareQuery(rotated_query.data(), RotatedCentroid(list.id));
+                distances.resize(count);
+                errors.resize(coarse.size() + count);
+                binary_->EstimateBatch(
+                    prepared, Code(begin), factors_.data() + begin, count, distances.data(),
+                    errors.data() + coarse.size());
+                for (std::size_t idx = 0; idx < count; ++idx) {
+                    coarse.push_back(
+                        SearchHit{.id = static_cast<std::uint32_t>(begin + idx), .distance = distances[idx]});
+                }
+            }
+        } else {
+            std::vector<float> projected(dim_);
+            projector_.TransformBatch(query.data(), 1, projected.data());
+            const AdcQuery prepared = codec_->PrepareQuery(projected.data());
+            for (const SearchHit& list : lists) {
+                const std::size_t begin = list_offsets_[list.id];
+                const std::size_t count = list_offsets_[list.id + 1] - begin;
+                distances.resize(count);
+                codec_->L2SqrBatch(prepared, Code(begin), code_norms_.data() + begin, count, distances.data());
+                for (std::size_t idx = 0; idx < count; ++idx) {
+                    coarse.push_back(
+                        SearchHit{.id = static_cast<std::uint32_t>(begin + idx), .distance = distances[idx]});
+                }
+            }
+        }
+    }
+    if (stats) {
+        stats->scanned = coarse.size();
     }
 
-    const auto coarse_top = TopKFromDistances(coarse_dist, std::max(top_k, rerank_k));
+    // 1-bit mode reranks in two rounds: `coarse_top` first, then whichever
+    // of `bounded` (distances are lower bounds) can still make the top_k.
+    std::vector<SearchHit> coarse_top;
+    std::vector<SearchHit> bounded;
+    {
+        const ann_common::ScopedLatency topk_timer(metrics.disk_topk);
+        if (binary_) {
+            SplitByEstimate(coarse, errors, top_k, &coarse_top, &bounded);
+        } else {
+            coarse_top = TopKHits(std::move(coarse), std::max(top_k, rerank_k));
+        }
+    }
+    const IoClock::time_point deadline = query_start + io_deadline;
+    std::uint64_t wait_ns = 0;
+    std::uint64_t rerank_ns = 0;
     std::vector<SearchHit> reranked;
     reranked.reserve(coarse_top.size());
-    for (const auto& hit : coarse_top) {
-        reranked.push_back(SearchHit{.id = hit.id, .distance = L2(query, vectors_[hit.id])});
+    Rerank(query, coarse_top, deadline, &reranked, &wait_ns, &rerank_ns);
+    std::size_t reranked_count = coarse_top.size();
+    if (!bounded.empty()) {
+        // As in RaBitQ, the exact k-th distance so far caps the true one, so
+        // only hits whose lower bound is below it still need a read; rerank_k
+        // caps the reads, lowest lower bounds first.
+        const auto filter_start = std::chrono::steady_clock::now();
+        reranked = TopKHits(std::move(reranked), top_k);
+        const float cutoff = reranked.size() < top_k ? std::numeric_limits<float>::max() : reranked.back().distance;
+        const auto last = std::remove_if(
+            bounded.begin(), bounded.end(), [cutoff](const SearchHit& hit) { return hit.distance >= cutoff; });
+        bounded.erase(last, bounded.end());
+        bounded = TopKHits(std::move(bounded), rerank_k > coarse_top.size() ? rerank_k - coarse_top.size() : 0);
+        rerank_ns += ann_common::NanosSince(filter_start);
+        Rerank(query, bounded, deadline, &reranked, &wait_ns, &rerank_ns);
+        reranked_count += bounded.size();
+    }
+    if (stats) {
+        stats->reranked = reranked_count;
     }
 
-    std::sort(
-        reranked.begin(),
-        reranked.end(),
-        [](const SearchHit& lhs, const SearchHit& rhs) { return lhs.distance < rhs.distance; });
-    if (reranked.size() > top_k) {
-        reranked.resize(top_k);
+    const auto topk_start = std::chrono::steady_clock::now();
+    reranked = TopKHits(std::move(reranked), top_k);
+    if (storage_) {
+        metrics.disk_io.Record(wait_ns);
+    }
+    metrics.disk_rerank.Record(rerank_ns + ann_common::NanosSince(topk_start));
+    metrics.disk_query.Record(ann_common::NanosSince(query_start));
+    return ToL2Distances(std::move(reranked));
+}
+
+void DualEngineIndex::Rerank(
+    const std::vector<float>& query,
+    const std::vector<SearchHit>& candidates,
+    const IoClock::time_point deadline,
+    std::vector<SearchHit>* out,
+    std::uint64_t* wait_ns,
+    std::uint64_t* rerank_ns) const {
+    if (candidates.empty()) {
+        return;
+    }
+    if (!storage_) {
+        const auto rerank_start = std::chrono::steady_clock::now();
+        for (const auto& hit : candidates) {
+            const std::uint32_t id = position_ids_[hit.id];
+            out->push_back(SearchHit{.id = id, .distance = L2Sqr(query, Row(id))});
+        }
+        *rerank_ns += ann_common::NanosSince(rerank_start);
+        return;
+    }
+
+    // Full vectors for rerank come off the block file: one request per
+    // candidate, submitted at once and reranked extent by extent as they land,
+    // so distances overlap the reads still in flight.
+    std::vector<IoRequest> rerank_requests;
+    rerank_requests.reserve(candidates.size());
+    for (const auto& hit : candidates) {
+        rerank_requests.push_back(IoRequest{.node_id = hit.id, .block_id = BlockOf(hit.id)});
+    }
+    const std::vector<IoRequest> ordered = DiskIoBatchScheduler().Execute(rerank_requests);
+    Metrics().io_requests.Add(ordered.size());
+    ExtentPoller poller;
+    std::size_t pending = io_->Submit(ordered, deadline, &poller);
+
+    bool failed = false;
+    std::vector<std::uint64_t> done_blocks;
+    for (; pending > 0; --pending) {
+        const auto wait_start = std::chrono::steady_clock::now();
+        const ExtentCompletion extent = poller.Next();
+        const auto rerank_start = std::chrono::steady_clock::now();
+        *wait_ns += static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(rerank_start - wait_start).count());
+        if (extent.data == nullptr) {
+            failed = true;
+            continue;
+        }
+        // Requests are in block order; a coalesced extent may also carry
+        // blocks this query did not ask for, or already got from the cache.
+        for (std::size_t block = 0; block < extent.run.block_count; ++block) {
+            const std::uint64_t block_id = extent.run.first_block + block;
+            if (std::find(done_blocks.begin(), done_blocks.end(), block_id) != done_blocks.end()) {
+                continue;
+            }
+            done_blocks.push_back(block_id);
+            auto request = std::lower_bound(
+                ordered.begin(), ordered.end(), block_id,
+                [](const IoRequest& lhs, const std::uint64_t rhs) { return lhs.block_id < rhs; });
+            const std::uint8_t* base = extent.data.get() + block * storage_->BlockBytes();
+            for (; request != ordered.end() && request->block_id == block_id; ++request) {
+                const auto* row = reinterpret_cast<const float*>(
+                    base + (request->node_id % block_size_) * dim_ * sizeof(float));
+                out->push_back(SearchHit{.id = position_ids_[request->node_id], .distance = L2Sqr(query, row)});
+            }
+        }
+        *rerank_ns += ann_common::NanosSince(rerank_start);
+    }
+    if (failed) {
+        throw std::runtime_error("disk path: block read failed");
     }
-    return reranked;
 }
 
 EvaluationMetrics DualEngineIndex::Evaluate(
     const std::vector<std::vector<float>>& queries,
     const std::size_t top_k,
-    const std::size_t rerank_k) const {
+    const std::size_t rerank_k,
+    const std::size_t nprobe) const {
     EvaluationMetrics metrics;
-    if (queries.empty() || vectors_.empty()) {
+    if (queries.empty() || size_ == 0) {
         return metrics;
     }
 
     std::vector<std::uint64_t> memory_latency;
+    std::vector<std::uint64_t> memory_batch_latency;
     std::vector<std::uint64_t> disk_latency;
     memory_latency.reserve(queries.size());
     disk_latency.reserve(queries.size());
 
-    double recall_sum = 0.0;
-
+    // Ground truth in batches: one pass over the data serves kEvaluateBatch queries.
+    std::vector<std::vector<SearchHit>> exact;
+    exact.reserve(queries.size());
+    std::uint64_t memory_total_us = 0;
+    for (std::size_t begin = 0; begin < queries.size(); begin += kEvaluateBatch) {
+        const std::size_t end = std::min(queries.size(), begin + kEvaluateBatch);
+        const std::vector<std::vector<float>> batch(
+            queries.begin() + static_cast<long>(begin), queries.begin() + static_cast<long>(end));
+        const auto start_mem = std::chrono::steady_clock::now();
+        auto batch_hits = SearchMemoryBatch(batch, top_k);
+        const auto end_mem = std::chrono::steady_clock::now();
+        const auto batch_us = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(end_mem - start_mem).count());
+        memory_total_us += batch_us;
+        memory_batch_latency.push_back(batch_us);
+        for (auto& hits : batch_hits) {
+            exact.push_back(std::move(hits));
+        }
+    }
     for (const auto& query : queries) {
         const auto start_mem = std::chrono::steady_clock::now();
-        const auto exact = SearchMemory(query, top_k);
+        SearchMemory(query, top_k);
         const auto end_mem = std::chrono::steady_clock::now();
+        memory_latency.push_back(
+            std::chrono::duration_cast<std::chrono::microseconds>(end_mem - start_mem).count());
+    }
 
+    const BlockCacheStats cache_before = cache_ ? cache_->Stats() : BlockCacheStats{};
+    double recall_sum = 0.0;
+    std::size_t scanned_total = 0;
+    std::size_t reranked_total = 0;
+    for (std::size_t q = 0; q < queries.size(); ++q) {
+        DiskSearchStats stats;
         const auto start_disk = std::chrono::steady_clock::now();
-        const auto approx = SearchDisk(query, top_k, rerank_k);
+        const auto approx = SearchDisk(queries[q], top_k, rerank_k, nprobe, &stats);
+        scanned_total += stats.scanned;
+        reranked_total += stats.reranked;
         const auto end_disk = std::chrono::steady_clock::now();
-
-        memory_latency.push_back(
-            std::chrono::duration_cast<std::chrono::microseconds>(end_mem - start_mem).count());
         disk_latency.push_back(
             std::chrono::duration_cast<std::chrono::microseconds>(end_disk - start_disk).count());
 
         std::unordered_set<std::uint32_t> exact_ids;
-        for (const auto& hit : exact) {
+        for (const auto& hit : exact[q]) {
             exact_ids.insert(hit.id);
         }
 
@@ -190,7 +711,23 @@ EvaluationMetrics DualEngineIndex::Evaluate(
 
     metrics.recall_at_k = recall_sum / static_cast<double>(queries.size());
     metrics.memory_p95_us = P95(memory_latency);
+    metrics.memory_batch_p95_us = P95(memory_batch_latency);
+    metrics.memory_qps = memory_total_us > 0
+                             ? static_cast<double>(queries.size()) * 1e6 / static_cast<double>(memory_total_us)
+                             : 0.0;
     metrics.disk_p95_us = P95(disk_latency);
+    metrics.disk_scan_fraction =
+        static_cast<double>(scanned_total) / (static_cast<double>(queries.size()) * static_cast<double>(size_));
+    metrics.quantization_mse = quantization_mse_;
+    metrics.disk_reranked_per_query = static_cast<double>(reranked_total) / static_cast<double>(queries.size());
+    metrics.code_bytes_per_vector = code_bytes_ + (binary_ ? sizeof(RabitQFactors) : sizeof(float));
+    metrics.unpacked_bytes_per_vector = dim_ * (sizeof(std::uint8_t) + sizeof(float));
+    if (cache_) {
+        BlockCacheStats delta = cache_->Stats();
+        delta.hits -= cache_before.hits;
+        delta.misses -= cache_before.misses;
+        metrics.disk_cache_hit_rate = delta.HitRate();
+    }
     return metrics;
 }
 
@@ -2,44 +2,552 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <limits>
+#include <random>
 #include <stdexcept>
+#include <utility>
+
+#include "distance.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define OPENGAUSS_X86_DISPATCH 1
+#include <immintrin.h>
+#else
+#define OPENGAUSS_X86_DISPATCH 0
+#endif
 
 namespace opengauss_demo {
 
-OpqProjector::OpqProjector(const std::size_t dim)
-    : dim_(dim), rotation_(dim, std::vector<float>(dim, 0.0F)) {
-    for (std::size_t idx = 0; idx < dim_; ++idx) {
-        rotation_[idx][idx] = 1.0F;
+namespace {
+
+constexpr std::size_t kGroupDims = 8;
+
+// The `bits`-byte group starting at `offset`, little endian. Reads a whole
+// word when it stays inside the code, otherwise only the bytes that exist.
+inline std::uint64_t LoadGroup(const std::uint8_t* code, const std::size_t offset, const std::size_t code_bytes) {
+    std::uint64_t word = 0;
+    if (offset + sizeof(word) <= code_bytes) {
+        std::memcpy(&word, code + offset, sizeof(word));
+    } else {
+        std::memcpy(&word, code + offset, code_bytes - offset);
+    }
+    return word;
+}
+
+// Query dimensions per SIMD step: one 32-byte register of unpacked codes.
+constexpr std::size_t kAdcChunkDims = 32;
+
+// Integer dot of `weights` with dimensions [first, dim) of `code`.
+std::int32_t TailDot(
+    const std::int8_t* weights,
+    const std::uint8_t* code,
+    const std::size_t first,
+    const std::size_t dim,
+    const unsigned bits,
+    const std::size_t code_bytes) {
+    const std::uint64_t mask = (std::uint64_t{1} << bits) - 1;
+    std::int32_t dot = 0;
+    for (std::size_t group = first; group < dim; group += kGroupDims) {
+        const std::uint64_t word = LoadGroup(code, group / kGroupDims * bits, code_bytes);
+        const std::size_t lanes = std::min(kGroupDims, dim - group);
+        for (std::size_t lane = 0; lane < lanes; ++lane) {
+            dot += weights[group + lane] * static_cast<std::int32_t>((word >> (lane * bits)) & mask);
+        }
+    }
+    return dot;
+}
+
+using AdcL2SqrFn = void (*)(
+    const AdcQuery& query,
+    const std::uint8_t* codes,
+    const float* norms,
+    std::size_t count,
+    std::size_t dim,
+    unsigned bits,
+    std::size_t code_bytes,
+    float* out);
+
+void AdcL2SqrScalar(
+    const AdcQuery& query,
+    const std::uint8_t* codes,
+    const float* norms,
+    const std::size_t count,
+    const std::size_t dim,
+    const unsigned bits,
+    const std::size_t code_bytes,
+    float* out) {
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        const std::int32_t dot = TailDot(query.weights.data(), codes + idx * code_bytes, 0, dim, bits, code_bytes);
+        out[idx] = query.bias + norms[idx] - 2.0F * query.scale * static_cast<float>(dot);
+    }
+}
+
+#if OPENGAUSS_X86_DISPATCH
+
+__attribute__((target("avx2"))) inline std::int32_t HorizontalSumAvx2(const __m256i value) {
+    const __m128i half = _mm_add_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+    const __m128i pair = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtsi128_si32(_mm_add_epi32(pair, _mm_shuffle_epi32(pair, _MM_SHUFFLE(2, 3, 0, 1))));
+}
+
+// Shuffle and multiplier that unpack 16 dimensions of `bits`-bit codes from
+// the 2 * bits bytes holding them into one 16-bit lane each.
+struct UnpackPlan {
+    alignas(32) std::int8_t shuffle[32];
+    alignas(32) std::uint16_t multiplier[16];
+};
+
+UnpackPlan MakeUnpackPlan(const unsigned bits) {
+    UnpackPlan plan{};
+    for (unsigned dim = 0; dim < 16; ++dim) {
+        const unsigned bit = dim * bits;
+        // Lane dim sits in 128-bit half dim / 8; both halves see the same 16
+        // source bytes, so the byte indices are absolute.
+        plan.shuffle[2 * dim] = static_cast<std::int8_t>(bit / 8);
+        plan.shuffle[2 * dim + 1] = static_cast<std::int8_t>(bit / 8 + 1);
+        // Moves the field to the top of the lane, dropping the bits above it.
+        plan.multiplier[dim] = static_cast<std::uint16_t>(1U << (16 - bits - bit % 8));
+    }
+    return plan;
+}
+
+// Plans for 5- to 7-bit codes, built on first use.
+const UnpackPlan& PlanFor(const unsigned bits) {
+    static const UnpackPlan plans[] = {MakeUnpackPlan(5), MakeUnpackPlan(6), MakeUnpackPlan(7)};
+    return plans[bits - 5];
+}
+
+// Dimensions [first, first + 16) as 16-bit lanes: each lane gathers the two
+// bytes its field spans (pshufb), shifts the field to the top (mullo by a
+// per-lane power of two) and back down (srli). Reads 16 bytes, up to
+// RabitQCodec::kCodePadding past the code.
+__attribute__((target("avx2"))) inline __m256i UnpackWordsAvx2(
+    const std::uint8_t* code,
+    const std::size_t first,
+    const unsigned bits,
+    const __m256i shuffle,
+    const __m256i multiplier) {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(code + first / 8 * bits));
+    const __m256i pairs = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(bytes), shuffle);
+    return _mm256_srli_epi16(_mm256_mullo_epi16(pairs, multiplier), static_cast<int>(16 - bits));
+}
+
+__attribute__((target("avx2"))) void AdcL2SqrWordsAvx2(
+    const AdcQuery& query,
+    const std::uint8_t* codes,
+    const float* norms,
+    const std::size_t count,
+    const std::size_t dim,
+    const unsigned bits,
+    const std::size_t code_bytes,
+    float* out) {
+    constexpr std::size_t kStepDims = 16;
+    const UnpackPlan& plan = PlanFor(bits);
+    const __m256i shuffle = _mm256_load_si256(reinterpret_cast<const __m256i*>(plan.shuffle));
+    const __m256i multiplier = _mm256_load_si256(reinterpret_cast<const __m256i*>(plan.multiplier));
+    const std::size_t full = dim / kStepDims * kStepDims;
+    const std::int16_t* weights = query.word_weights.data();
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        const std::uint8_t* code = codes + idx * code_bytes;
+        __m256i acc = _mm256_setzero_si256();
+        for (std::size_t first = 0; first < full; first += kStepDims) {
+            const __m256i step_weights = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + first));
+            acc = _mm256_add_epi32(
+                acc, _mm256_madd_epi16(UnpackWordsAvx2(code, first, bits, shuffle, multiplier), step_weights));
+        }
+        std::int32_t dot = HorizontalSumAvx2(acc);
+        if (full < dim) {
+            dot += TailDot(query.weights.data(), code, full, dim, bits, code_bytes);
+        }
+        out[idx] = query.bias + norms[idx] - 2.0F * query.scale * static_cast<float>(dot);
+    }
+}
+
+// 4-bit codes: dimensions [first, first + 32) are 16 bytes whose low nibbles
+// are the even dimensions and high nibbles the odd ones; AdcQuery::
+// nibble_weights is permuted to match, so no shuffle is needed.
+__attribute__((target("avx2"))) inline __m256i UnpackNibblesAvx2(const std::uint8_t* code, const std::size_t first) {
+    const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(code + first / 2));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    const __m128i low = _mm_and_si128(packed, mask);
+    const __m128i high = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+    return _mm256_set_m128i(high, low);
+}
+
+// u8 codes x s8 weights: maddubs sums adjacent pairs to s16 (at most
+// 2 * 15 * 127, so no saturation) and madd widens them to s32.
+__attribute__((target("avx2"))) void AdcL2SqrNibblesAvx2(
+    const AdcQuery& query,
+    const std::uint8_t* codes,
+    const float* norms,
+    const std::size_t count,
+    const std::size_t dim,
+    const unsigned bits,
+    const std::size_t code_bytes,
+    float* out) {
+    const std::size_t full = dim / kAdcChunkDims * kAdcChunkDims;
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        const std::uint8_t* code = codes + idx * code_bytes;
+        __m256i acc = _mm256_setzero_si256();
+        for (std::size_t first = 0; first < full; first += kAdcChunkDims) {
+            const __m256i chunk_weights =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(query.nibble_weights.data() + first));
+            acc = _mm256_add_epi32(
+                acc, _mm256_madd_epi16(_mm256_maddubs_epi16(UnpackNibblesAvx2(code, first), chunk_weights), ones));
+        }
+        std::int32_t dot = HorizontalSumAvx2(acc);
+        if (full < dim) {
+            dot += TailDot(query.weights.data(), code, full, dim, bits, code_bytes);
+        }
+        out[idx] = query.bias + norms[idx] - 2.0F * query.scale * static_cast<float>(dot);
+    }
+}
+
+#endif
+
+AdcL2SqrFn SelectAdcL2Sqr(const unsigned bits) {
+#if OPENGAUSS_X86_DISPATCH
+    static const bool avx2 = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    if (avx2) {
+        return bits == 4 ? AdcL2SqrNibblesAvx2 : AdcL2SqrWordsAvx2;
+    }
+#endif
+    (void)bits;
+    return AdcL2SqrScalar;
+}
+
+// Counts that turn one sign code into the RaBitQ estimate; the same body is
+// compiled for plain x86-64 and, under dispatch, with the popcnt instruction.
+using BinaryEstimateFn = void (*)(
+    const RabitQBinaryQuery& query,
+    const std::uint8_t* codes,
+    const RabitQFactors* factors,
+    std::size_t count,
+    std::size_t dim,
+    std::size_t words,
+    float* distance,
+    float* error);
+
+inline void BinaryEstimateLoop(
+    const RabitQBinaryQuery& query,
+    const std::uint8_t* codes,
+    const RabitQFactors* factors,
+    const std::size_t count,
+    const std::size_t dim,
+    const std::size_t words,
+    float* distance,
+    float* error) {
+    static_assert(RabitQBinaryCodec::kQueryBits == 4, "plane loop below is unrolled for 4-bit queries");
+    const std::uint64_t* planes = query.planes.data();
+    const float inv_sqrt_dim = 1.0F / std::sqrt(static_cast<float>(dim));
+    const float bound_scale =
+        RabitQBinaryCodec::kErrorEpsilon / std::sqrt(static_cast<float>(std::max<std::size_t>(dim, 2) - 1));
+    // sum_d q'_d, from the same levels the code side sees.
+    const float query_sum = static_cast<float>(dim) * query.lower + query.step * query.level_sum;
+    const float query_norm = query.residual_norm;
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        const std::uint8_t* code = codes + idx * words * sizeof(std::uint64_t);
+        std::uint32_t ones = 0;
+        std::uint32_t weighted = 0;
+        for (std::size_t word = 0; word < words; ++word) {
+            std::uint64_t sign = 0;
+            std::memcpy(&sign, code + word * sizeof(sign), sizeof(sign));
+            ones += static_cast<std::uint32_t>(__builtin_popcountll(sign));
+            weighted += static_cast<std::uint32_t>(__builtin_popcountll(sign & planes[word]));
+            weighted += static_cast<std::uint32_t>(__builtin_popcountll(sign & planes[words + word])) << 1U;
+            weighted += static_cast<std::uint32_t>(__builtin_popcountll(sign & planes[2 * words + word])) << 2U;
+            weighted += static_cast<std::uint32_t>(__builtin_popcountll(sign & planes[3 * words + word])) << 3U;
+        }
+        // <o_bar, q'> = sum_d (2 b_d - 1) q'_d / sqrt(D).
+        const float signed_dot =
+            2.0F * (query.lower * static_cast<float>(ones) + query.step * static_cast<float>(weighted)) - query_sum;
+        const RabitQFactors& factor = factors[idx];
+        const float cosine = signed_dot * inv_sqrt_dim / factor.alignment;
+        const float cross = 2.0F * factor.residual_norm * query_norm;
+        distance[idx] = factor.residual_norm * factor.residual_norm + query_norm * query_norm - cross * cosine;
+        const float alignment_sq = factor.alignment * factor.alignment;
+        error[idx] = cross * bound_scale * std::sqrt(std::max(0.0F, 1.0F - alignment_sq)) / factor.alignment;
     }
 }
 
+void BinaryEstimateGeneric(
+    const RabitQBinaryQuery& query,
+    const std::uint8_t* codes,
+    const RabitQFactors* factors,
+    const std::size_t count,
+    const std::size_t dim,
+    const std::size_t words,
+    float* distance,
+    float* error) {
+    BinaryEstimateLoop(query, codes, factors, count, dim, words, distance, error);
+}
+
+#if OPENGAUSS_X86_DISPATCH
+
+__attribute__((target("popcnt"))) void BinaryEstimatePopcnt(
+    const RabitQBinaryQuery& query,
+    const std::uint8_t* codes,
+    const RabitQFactors* factors,
+    const std::size_t count,
+    const std::size_t dim,
+    const std::size_t words,
+    float* distance,
+    float* error) {
+    BinaryEstimateLoop(query, codes, factors, count, dim, words, distance, error);
+}
+
+#endif
+
+BinaryEstimateFn SelectBinaryEstimate() {
+#if OPENGAUSS_X86_DISPATCH
+    static const bool popcnt = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("popcnt") != 0;
+    }();
+    if (popcnt) {
+        return BinaryEstimatePopcnt;
+    }
+#endif
+    return BinaryEstimateGeneric;
+}
+
+// Input rows per InnerProductBlock call in OpqProjector::TransformBatch:
+// the tile and the matrix stay cache resident together.
+constexpr std::size_t kTransformTile = 64;
+
+// Vectors the Hadamard transform carries through each butterfly together,
+// interleaved so element d of every vector shares one contiguous row. Every
+// pass, even the stride-1 ones, is then a plain loop over lanes.
+constexpr std::size_t kHadamardLanes = 8;
+
+// In-place orthonormal Walsh-Hadamard transform of `length` (a power of two)
+// interleaved rows: log2(length) butterfly passes, then a 1/sqrt(length) scale.
+void FwhtInterleaved(float* tile, const std::size_t length) {
+    for (std::size_t half = 1; half < length; half *= 2) {
+        for (std::size_t first = 0; first < length; first += 2 * half) {
+            for (std::size_t idx = first; idx < first + half; ++idx) {
+                float* lhs = tile + idx * kHadamardLanes;
+                float* rhs = tile + (idx + half) * kHadamardLanes;
+                for (std::size_t lane = 0; lane < kHadamardLanes; ++lane) {
+                    const float left = lhs[lane];
+                    const float right = rhs[lane];
+                    lhs[lane] = left + right;
+                    rhs[lane] = left - right;
+                }
+            }
+        }
+    }
+    const float scale = 1.0F / std::sqrt(static_cast<float>(length));
+    for (std::size_t idx = 0; idx < length * kHadamardLanes; ++idx) {
+        tile[idx] *= scale;
+    }
+}
+
+// Orthogonal Procrustes: the rotation R = U V^T closest to `target` (dim x dim,
+// row-major) with target = U S V^T, by one-sided Jacobi SVD. Jacobi rotates
+// pairs of columns of target (kept as rows of its transpose) until all are
+// orthogonal, accumulating the rotations in V^T. False when target is rank
+// deficient and U is not determined.
+bool ProcrustesRotation(const std::vector<float>& target, const std::size_t dim, std::vector<float>* rotation) {
+    constexpr int kMaxSweeps = 30;
+    constexpr double kTolerance = 1e-10;
+    // columns[j] = target column j, which converges to s_j u_j; basis[j] = v_j.
+    std::vector<double> columns(dim * dim);
+    std::vector<double> basis(dim * dim, 0.0);
+    for (std::size_t row = 0; row < dim; ++row) {
+        for (std::size_t col = 0; col < dim; ++col) {
+            columns[col * dim + row] = target[row * dim + col];
+        }
+        basis[row * dim + row] = 1.0;
+    }
+    auto rotate = [dim](double* lhs, double* rhs, const double cosine, const double sine) {
+        for (std::size_t idx = 0; idx < dim; ++idx) {
+            const double left = lhs[idx];
+            const double right = rhs[idx];
+            lhs[idx] = cosine * left - sine * right;
+            rhs[idx] = sine * left + cosine * right;
+        }
+    };
+    for (int sweep = 0; sweep < kMaxSweeps; ++sweep) {
+        bool rotated = false;
+        for (std::size_t p = 0; p + 1 < dim; ++p) {
+            for (std::size_t q = p + 1; q < dim; ++q) {
+                double* col_p = columns.data() + p * dim;
+                double* col_q = columns.data() + q * dim;
+                double alpha = 0.0;
+                double beta = 0.0;
+                double gamma = 0.0;
+                for (std::size_t idx = 0; idx < dim; ++idx) {
+                    alpha += col_p[idx] * col_p[idx];
+                    beta += col_q[idx] * col_q[idx];
+                    gamma += col_p[idx] * col_q[idx];
+                }
+                if (std::fabs(gamma) <= kTolerance * std::sqrt(alpha * beta)) {
+                    continue;
+                }
+                rotated = true;
+                const double zeta = (beta - alpha) / (2.0 * gamma);
+                const double tangent = (zeta >= 0.0 ? 1.0 : -1.0) / (std::fabs(zeta) + std::sqrt(1.0 + zeta * zeta));
+                const double cosine = 1.0 / std::sqrt(1.0 + tangent * tangent);
+                const double sine = cosine * tangent;
+                rotate(col_p, col_q, cosine, sine);
+                rotate(basis.data() + p * dim, basis.data() + q * dim, cosine, sine);
+            }
+        }
+        if (!rotated) {
+            break;
+        }
+    }
+
+    double largest = 0.0;
+    std::vector<double> singular(dim);
+    for (std::size_t col = 0; col < dim; ++col) {
+        double norm = 0.0;
+        for (std::size_t idx = 0; idx < dim; ++idx) {
+            norm += columns[col * dim + idx] * columns[col * dim + idx];
+        }
+        singular[col] = std::sqrt(norm);
+        largest = std::max(largest, singular[col]);
+    }
+    for (const double value : singular) {
+        if (value <= 1e-9 * largest) {
+            return false;
+        }
+    }
+    // R[r][c] = sum_j u_j[r] v_j[c].
+    rotation->assign(dim * dim, 0.0F);
+    for (std::size_t row = 0; row < dim; ++row) {
+        for (std::size_t col = 0; col < dim; ++col) {
+            double value = 0.0;
+            for (std::size_t j = 0; j < dim; ++j) {
+                value += columns[j * dim + row] / singular[j] * basis[j * dim + col];
+            }
+            (*rotation)[row * dim + col] = static_cast<float>(value);
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+const char* RotationKindName(const RotationKind kind) {
+    switch (kind) {
+        case RotationKind::kIdentity:
+            return "identity";
+        case RotationKind::kOpq:
+            return "opq";
+        case RotationKind::kHadamard:
+            return "hadamard";
+    }
+    return "unknown";
+}
+
+OpqProjector::OpqProjector(const std::size_t dim) : dim_(dim) {}
+
+OpqProjector OpqProjector::RandomHadamard(const std::size_t dim, const std::uint32_t seed) {
+    OpqProjector projector(dim);
+    if (dim == 0) {
+        return projector;
+    }
+    projector.kind_ = Kind::kHadamard;
+    projector.hadamard_block_ = std::size_t{1};
+    while (projector.hadamard_block_ * 2 <= dim) {
+        projector.hadamard_block_ *= 2;
+    }
+    std::mt19937 rng(seed);
+    std::bernoulli_distribution flip(0.5);
+    projector.signs_.resize(kHadamardRounds * dim);
+    for (float& sign : projector.signs_) {
+        sign = flip(rng) ? -1.0F : 1.0F;
+    }
+    return projector;
+}
+
 void OpqProjector::SetRotationMatrix(const std::vector<std::vector<float>>& matrix) {
     if (matrix.size() != dim_) {
         throw std::invalid_argument("OPQ matrix row mismatch");
     }
+    std::vector<float> flat;
+    flat.reserve(dim_ * dim_);
     for (const auto& row : matrix) {
         if (row.size() != dim_) {
             throw std::invalid_argument("OPQ matrix column mismatch");
         }
+        flat.insert(flat.end(), row.begin(), row.end());
     }
-    rotation_ = matrix;
+    SetRotationMatrix(std::move(flat));
+}
+
+void OpqProjector::SetRotationMatrix(std::vector<float> matrix) {
+    if (matrix.size() != dim_ * dim_) {
+        throw std::invalid_argument("OPQ matrix size mismatch");
+    }
+    kind_ = Kind::kDense;
+    rotation_ = std::move(matrix);
+    signs_.clear();
+    hadamard_block_ = 0;
 }
 
 std::vector<float> OpqProjector::Transform(const std::vector<float>& input) const {
     if (input.size() != dim_) {
         throw std::invalid_argument("OPQ input dim mismatch");
     }
+    std::vector<float> output(dim_);
+    TransformBatch(input.data(), 1, output.data());
+    return output;
+}
 
-    std::vector<float> output(dim_, 0.0F);
-    for (std::size_t row = 0; row < dim_; ++row) {
-        float value = 0.0F;
-        for (std::size_t col = 0; col < dim_; ++col) {
-            value += rotation_[row][col] * input[col];
+void OpqProjector::TransformBatch(const float* input, const std::size_t count, float* output) const {
+    switch (kind_) {
+        case Kind::kIdentity:
+            std::memcpy(output, input, count * dim_ * sizeof(float));
+            return;
+        case Kind::kDense:
+            // output = input * R^T, a tile of input rows at a time.
+            for (std::size_t begin = 0; begin < count; begin += kTransformTile) {
+                const std::size_t rows = std::min(kTransformTile, count - begin);
+                ann_common::InnerProductBlock(
+                    input + begin * dim_, rows, dim_, rotation_.data(), dim_, dim_, dim_, output + begin * dim_, dim_);
+            }
+            return;
+        case Kind::kHadamard: {
+            std::vector<float> tile(dim_ * kHadamardLanes);
+            for (std::size_t begin = 0; begin < count; begin += kHadamardLanes) {
+                const std::size_t lanes = std::min(kHadamardLanes, count - begin);
+                std::fill(tile.begin(), tile.end(), 0.0F);
+                for (std::size_t lane = 0; lane < lanes; ++lane) {
+                    const float* vector = input + (begin + lane) * dim_;
+                    for (std::size_t idx = 0; idx < dim_; ++idx) {
+                        tile[idx * kHadamardLanes + lane] = vector[idx];
+                    }
+                }
+                for (std::size_t round = 0; round < kHadamardRounds; ++round) {
+                    const float* signs = signs_.data() + round * dim_;
+                    for (std::size_t idx = 0; idx < dim_; ++idx) {
+                        for (std::size_t lane = 0; lane < kHadamardLanes; ++lane) {
+                            tile[idx * kHadamardLanes + lane] *= signs[idx];
+                        }
+                    }
+                    FwhtInterleaved(tile.data(), hadamard_block_);
+                    if (hadamard_block_ < dim_) {
+                        FwhtInterleaved(tile.data() + (dim_ - hadamard_block_) * kHadamardLanes, hadamard_block_);
+                    }
+                }
+                for (std::size_t lane = 0; lane < lanes; ++lane) {
+                    float* vector = output + (begin + lane) * dim_;
+                    for (std::size_t idx = 0; idx < dim_; ++idx) {
+                        vector[idx] = tile[idx * kHadamardLanes + lane];
+                    }
+                }
+            }
+            return;
         }
-        output[row] = value;
     }
-    return output;
 }
 
 RabitQCodec::RabitQCodec(const std::uint8_t bits) : bits_(bits), dim_(0) {
@@ -52,8 +560,24 @@ void RabitQCodec::Fit(const std::vector<std::vector<float>>& training_vectors) {
     if (training_vectors.empty()) {
         throw std::invalid_argument("RabitQ Fit requires non-empty training set");
     }
+    const std::size_t dim = training_vectors.front().size();
+    std::vector<float> flat;
+    flat.reserve(training_vectors.size() * dim);
+    for (const auto& vector : training_vectors) {
+        if (vector.size() != dim) {
+            throw std::invalid_argument("RabitQ Fit dimension mismatch");
+        }
+        flat.insert(flat.end(), vector.begin(), vector.end());
+    }
+    Fit(flat.data(), training_vectors.size(), dim);
+}
+
+void RabitQCodec::Fit(const float* vectors, const std::size_t count, const std::size_t dim) {
+    if (count == 0) {
+        throw std::invalid_argument("RabitQ Fit requires non-empty training set");
+    }
 
-    dim_ = training_vectors.front().size();
+    dim_ = dim;
     if (dim_ == 0) {
         throw std::invalid_argument("RabitQ Fit requires non-zero dimension");
     }
@@ -61,10 +585,8 @@ void RabitQCodec::Fit(const std::vector<std::vector<float>>& training_vectors) {
     min_per_dim_.assign(dim_, std::numeric_limits<float>::max());
     std::vector<float> max_per_dim(dim_, std::numeric_limits<float>::lowest());
 
-    for (const auto& vector : training_vectors) {
-        if (vector.size() != dim_) {
-            throw std::invalid_argument("RabitQ Fit dimension mismatch");
-        }
+    for (std::size_t row = 0; row < count; ++row) {
+        const float* vector = vectors + row * dim_;
         for (std::size_t idx = 0; idx < dim_; ++idx) {
             min_per_dim_[idx] = std::min(min_per_dim_[idx], vector[idx]);
             max_per_dim[idx] = std::max(max_per_dim[idx], vector[idx]);
@@ -73,40 +595,112 @@ void RabitQCodec::Fit(const std::vector<std::vector<float>>& training_vectors) {
 
     const float levels = static_cast<float>((1U << bits_) - 1U);
     scale_per_dim_.assign(dim_, 1.0F);
+    weight_per_dim_.assign(dim_, 1.0F);
     for (std::size_t idx = 0; idx < dim_; ++idx) {
         const float span = std::max(1e-6F, max_per_dim[idx] - min_per_dim_[idx]);
         scale_per_dim_[idx] = levels / span;
+        weight_per_dim_[idx] = 1.0F / (scale_per_dim_[idx] * scale_per_dim_[idx]);
     }
 }
 
 std::vector<std::uint8_t> RabitQCodec::Encode(const std::vector<float>& vector) const {
-    if (dim_ == 0 || min_per_dim_.empty() || scale_per_dim_.empty()) {
-        throw std::logic_error("RabitQ codec is not fitted");
-    }
     if (vector.size() != dim_) {
         throw std::invalid_argument("RabitQ Encode dim mismatch");
     }
+    std::vector<std::uint8_t> code(CodeBytes(), 0U);
+    EncodeTo(vector.data(), code.data());
+    return code;
+}
+
+void RabitQCodec::EncodeTo(const float* vector, std::uint8_t* out) const {
+    if (dim_ == 0 || min_per_dim_.empty() || scale_per_dim_.empty()) {
+        throw std::logic_error("RabitQ codec is not fitted");
+    }
 
     const float levels = static_cast<float>((1U << bits_) - 1U);
-    std::vector<std::uint8_t> code(dim_, 0U);
+    std::memset(out, 0, CodeBytes());
     for (std::size_t idx = 0; idx < dim_; ++idx) {
         const float normalized = (vector[idx] - min_per_dim_[idx]) * scale_per_dim_[idx];
-        const float clamped = std::clamp(normalized, 0.0F, levels);
-        code[idx] = static_cast<std::uint8_t>(std::lround(clamped));
+        const auto level = static_cast<unsigned>(std::lround(std::clamp(normalized, 0.0F, levels)));
+        // A field spans at most two bytes since bits <= 7.
+        const std::size_t bit = idx * bits_;
+        const unsigned shifted = level << (bit % 8);
+        out[bit / 8] |= static_cast<std::uint8_t>(shifted);
+        if ((bit % 8) + bits_ > 8) {
+            out[bit / 8 + 1] |= static_cast<std::uint8_t>(shifted >> 8);
+        }
     }
-    return code;
 }
 
 std::vector<float> RabitQCodec::Decode(const std::vector<std::uint8_t>& code) const {
-    if (dim_ == 0 || code.size() != dim_) {
-        throw std::invalid_argument("RabitQ Decode dim mismatch");
+    if (dim_ == 0 || code.size() != CodeBytes()) {
+        throw std::invalid_argument("RabitQ Decode size mismatch");
     }
 
     std::vector<float> vector(dim_, 0.0F);
+    DecodeTo(code.data(), vector.data());
+    return vector;
+}
+
+void RabitQCodec::DecodeTo(const std::uint8_t* code, float* out) const {
+    const std::uint64_t mask = (std::uint64_t{1} << bits_) - 1;
     for (std::size_t idx = 0; idx < dim_; ++idx) {
-        vector[idx] = static_cast<float>(code[idx]) / scale_per_dim_[idx] + min_per_dim_[idx];
+        const std::uint64_t word = LoadGroup(code, idx / kGroupDims * bits_, CodeBytes());
+        const auto level = static_cast<float>((word >> (idx % kGroupDims * bits_)) & mask);
+        out[idx] = level / scale_per_dim_[idx] + min_per_dim_[idx];
     }
-    return vector;
+}
+
+AdcQuery RabitQCodec::PrepareQuery(const float* query) const {
+    // ||x - q||^2 = sum_d w_d (q'_d - c_d)^2 with q' the query in code space;
+    // the c_d^2 part is the code's norm and the q'_d^2 part a constant.
+    AdcQuery prepared;
+    const std::size_t padded = (dim_ + kAdcChunkDims - 1) / kAdcChunkDims * kAdcChunkDims;
+    std::vector<float> cross(dim_);
+    float max_abs = 0.0F;
+    for (std::size_t idx = 0; idx < dim_; ++idx) {
+        const float code_space = (query[idx] - min_per_dim_[idx]) * scale_per_dim_[idx];
+        prepared.bias += weight_per_dim_[idx] * code_space * code_space;
+        cross[idx] = weight_per_dim_[idx] * code_space;
+        max_abs = std::max(max_abs, std::fabs(cross[idx]));
+    }
+    prepared.scale = max_abs > 0.0F ? max_abs / 127.0F : 1.0F;
+    prepared.weights.assign(padded, 0);
+    for (std::size_t idx = 0; idx < dim_; ++idx) {
+        prepared.weights[idx] = static_cast<std::int8_t>(std::lround(cross[idx] / prepared.scale));
+    }
+    if (bits_ != 4) {
+        prepared.word_weights.assign(prepared.weights.begin(), prepared.weights.end());
+    } else {
+        prepared.nibble_weights.assign(padded, 0);
+        for (std::size_t first = 0; first < padded; first += kAdcChunkDims) {
+            for (std::size_t pair = 0; pair < kAdcChunkDims / 2; ++pair) {
+                prepared.nibble_weights[first + pair] = prepared.weights[first + 2 * pair];
+                prepared.nibble_weights[first + kAdcChunkDims / 2 + pair] = prepared.weights[first + 2 * pair + 1];
+            }
+        }
+    }
+    return prepared;
+}
+
+float RabitQCodec::CodeNorm(const std::uint8_t* code) const {
+    const std::uint64_t mask = (std::uint64_t{1} << bits_) - 1;
+    float norm = 0.0F;
+    for (std::size_t idx = 0; idx < dim_; ++idx) {
+        const std::uint64_t word = LoadGroup(code, idx / kGroupDims * bits_, CodeBytes());
+        const auto level = static_cast<float>((word >> (idx % kGroupDims * bits_)) & mask);
+        norm += weight_per_dim_[idx] * level * level;
+    }
+    return norm;
+}
+
+void RabitQCodec::L2SqrBatch(
+    const AdcQuery& query,
+    const std::uint8_t* codes,
+    const float* norms,
+    const std::size_t count,
+    float* out) const {
+    SelectAdcL2Sqr(bits_)(query, codes, norms, count, dim_, bits_, CodeBytes(), out);
 }
 
 std::size_t RabitQCodec::Dim() const {
@@ -117,4 +711,205 @@ std::uint8_t RabitQCodec::Bits() const {
     return bits_;
 }
 
+std::size_t RabitQCodec::CodeBytes() const {
+    return (dim_ * bits_ + 7) / 8;
+}
+
+OpqProjector TrainOpq(
+    const float* samples,
+    const std::size_t count,
+    const std::size_t dim,
+    const std::uint8_t bits,
+    const std::size_t iterations,
+    float* error) {
+    OpqProjector best(dim);
+    if (count == 0 || dim == 0) {
+        return best;
+    }
+    float best_error = std::numeric_limits<float>::max();
+    OpqProjector current(dim);
+    RabitQCodec codec(bits);
+    std::vector<float> rotated(count * dim);
+    std::vector<float> decoded(count * dim);
+    std::vector<std::uint8_t> code;
+    // Transposed sample and decodes, so sum_i y_i x_i^T is one block of dot
+    // products over the sample.
+    std::vector<float> samples_t(dim * count);
+    std::vector<float> decoded_t(dim * count);
+    for (std::size_t row = 0; row < count; ++row) {
+        for (std::size_t col = 0; col < dim; ++col) {
+            samples_t[col * count + row] = samples[row * dim + col];
+        }
+    }
+    std::vector<float> target(dim * dim);
+    std::vector<float> rotation;
+
+    for (std::size_t iteration = 0;; ++iteration) {
+        current.TransformBatch(samples, count, rotated.data());
+        codec.Fit(rotated.data(), count, dim);
+        code.resize(codec.CodeBytes());
+        double total = 0.0;
+        for (std::size_t row = 0; row < count; ++row) {
+            codec.EncodeTo(rotated.data() + row * dim, code.data());
+            codec.DecodeTo(code.data(), decoded.data() + row * dim);
+            total += ann_common::L2Sqr(rotated.data() + row * dim, decoded.data() + row * dim, dim);
+        }
+        const auto mean_error = static_cast<float>(total / static_cast<double>(count));
+        if (mean_error < best_error) {
+            best_error = mean_error;
+            best = current;
+        }
+        if (iteration == iterations) {
+            break;
+        }
+
+        for (std::size_t row = 0; row < count; ++row) {
+            for (std::size_t col = 0; col < dim; ++col) {
+                decoded_t[col * count + row] = decoded[row * dim + col];
+            }
+        }
+        // target[r][c] = sum_i y_i[r] x_i[c].
+        ann_common::InnerProductBlock(
+            decoded_t.data(), dim, count, samples_t.data(), dim, count, count, target.data(), dim);
+        if (!ProcrustesRotation(target, dim, &rotation)) {
+            break;
+        }
+        current.SetRotationMatrix(rotation);
+    }
+    if (error) {
+        *error = best_error;
+    }
+    return best;
+}
+
+std::vector<std::vector<float>> RandomOrthogonalMatrix(const std::size_t dim, const std::uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> gaussian(0.0, 1.0);
+    std::vector<std::vector<double>> rows(dim, std::vector<double>(dim));
+    for (std::size_t row = 0; row < dim; ++row) {
+        double norm = 0.0;
+        // A Gaussian row is almost surely independent of the earlier ones;
+        // redraw in the degenerate case.
+        while (norm < 1e-6) {
+            for (double& value : rows[row]) {
+                value = gaussian(rng);
+            }
+            for (std::size_t prev = 0; prev < row; ++prev) {
+                double dot = 0.0;
+                for (std::size_t col = 0; col < dim; ++col) {
+                    dot += rows[row][col] * rows[prev][col];
+                }
+                for (std::size_t col = 0; col < dim; ++col) {
+                    rows[row][col] -= dot * rows[prev][col];
+                }
+            }
+            norm = 0.0;
+            for (const double value : rows[row]) {
+                norm += value * value;
+            }
+            norm = std::sqrt(norm);
+        }
+        for (double& value : rows[row]) {
+            value /= norm;
+        }
+    }
+
+    std::vector<std::vector<float>> matrix(dim, std::vector<float>(dim));
+    for (std::size_t row = 0; row < dim; ++row) {
+        std::transform(rows[row].begin(), rows[row].end(), matrix[row].begin(), [](const double value) {
+            return static_cast<float>(value);
+        });
+    }
+    return matrix;
+}
+
+RabitQBinaryCodec::RabitQBinaryCodec(const std::size_t dim, const std::uint32_t seed, const RotationKind rotation)
+    : dim_(dim), words_((dim + 63) / 64), rotation_(dim) {
+    if (dim_ == 0) {
+        throw std::invalid_argument("RabitQ binary codec requires non-zero dimension");
+    }
+    if (rotation == RotationKind::kHadamard) {
+        rotation_ = OpqProjector::RandomHadamard(dim_, seed);
+    } else {
+        rotation_.SetRotationMatrix(RandomOrthogonalMatrix(dim_, seed));
+    }
+}
+
+void RabitQBinaryCodec::Rotate(const float* vectors, const std::size_t count, float* out) const {
+    rotation_.TransformBatch(vectors, count, out);
+}
+
+RabitQFactors RabitQBinaryCodec::EncodeTo(
+    const float* rotated, const float* rotated_centroid, std::uint8_t* out) const {
+    std::vector<std::uint64_t> signs(words_, 0);
+    double norm_sq = 0.0;
+    double abs_sum = 0.0;
+    for (std::size_t idx = 0; idx < dim_; ++idx) {
+        const float residual = rotated[idx] - rotated_centroid[idx];
+        norm_sq += static_cast<double>(residual) * residual;
+        abs_sum += std::fabs(residual);
+        if (residual > 0.0F) {
+            signs[idx / 64] |= std::uint64_t{1} << (idx % 64);
+        }
+    }
+    std::memcpy(out, signs.data(), CodeBytes());
+
+    RabitQFactors factors;
+    const double norm = std::sqrt(norm_sq);
+    if (norm > 0.0) {
+        // <o_bar, o> = sum_d |o_d| / sqrt(D) for the unit residual o.
+        factors.residual_norm = static_cast<float>(norm);
+        factors.alignment = static_cast<float>(abs_sum / (norm * std::sqrt(static_cast<double>(dim_))));
+    }
+    return factors;
+}
+
+RabitQBinaryQuery RabitQBinaryCodec::PrepareQuery(const float* rotated_query, const float* rotated_centroid) const {
+    RabitQBinaryQuery prepared;
+    prepared.planes.assign(kQueryBits * words_, 0);
+    std::vector<float> unit(dim_);
+    double norm_sq = 0.0;
+    for (std::size_t idx = 0; idx < dim_; ++idx) {
+        unit[idx] = rotated_query[idx] - rotated_centroid[idx];
+        norm_sq += static_cast<double>(unit[idx]) * unit[idx];
+    }
+    if (norm_sq == 0.0) {
+        return prepared;
+    }
+    prepared.residual_norm = static_cast<float>(std::sqrt(norm_sq));
+    float upper = std::numeric_limits<float>::lowest();
+    prepared.lower = std::numeric_limits<float>::max();
+    for (float& value : unit) {
+        value /= prepared.residual_norm;
+        prepared.lower = std::min(prepared.lower, value);
+        upper = std::max(upper, value);
+    }
+
+    const auto top_level = static_cast<float>((1U << kQueryBits) - 1U);
+    prepared.step = std::max(upper - prepared.lower, 1e-12F) / top_level;
+    std::uint32_t level_sum = 0;
+    for (std::size_t idx = 0; idx < dim_; ++idx) {
+        const auto level = static_cast<std::uint32_t>(
+            std::lround(std::clamp((unit[idx] - prepared.lower) / prepared.step, 0.0F, top_level)));
+        level_sum += level;
+        for (unsigned plane = 0; plane < kQueryBits; ++plane) {
+            if ((level >> plane) & 1U) {
+                prepared.planes[plane * words_ + idx / 64] |= std::uint64_t{1} << (idx % 64);
+            }
+        }
+    }
+    prepared.level_sum = static_cast<float>(level_sum);
+    return prepared;
+}
+
+void RabitQBinaryCodec::EstimateBatch(
+    const RabitQBinaryQuery& query,
+    const std::uint8_t* codes,
+    const RabitQFactors* factors,
+    const std::size_t count,
+    float* distance,
+    float* error) const {
+    SelectBinaryEstimate()(query, codes, factors, count, dim_, words_, distance, error);
+}
+
 }  // namespace opengauss_demo
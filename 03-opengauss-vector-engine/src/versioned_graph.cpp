@@ -2,7 +2,9 @@
 
 #include <mutex>
 #include <queue>
-#include <unordered_set>
+
+#include "metrics.h"
+#include "visited_table.h"
 
 namespace opengauss_demo {
 
@@ -34,27 +36,34 @@ std::vector<std::uint32_t> VersionedGraph::TraverseWithOcc(
         return {};
     }
 
+    static ann_common::Counter& occ_retries = ann_common::EngineCounter(
+        "ann_occ_retries_total", "opengauss", "Neighbor reads retried after a concurrent version bump.");
+    static ann_common::Counter& occ_failures = ann_common::EngineCounter(
+        "ann_occ_read_failures_total", "opengauss", "Nodes skipped after exhausting OCC read retries.");
+
     std::vector<std::uint32_t> visited_order;
     visited_order.reserve(max_steps);
 
     std::queue<std::uint32_t> frontier;
-    std::unordered_set<std::uint32_t> dedup;
+    const ann_common::ScopedVisitedTable dedup(neighbors_.size());
+    std::vector<std::uint32_t> neighbors;
     frontier.push(entrypoint);
-    dedup.insert(entrypoint);
+    dedup->TestAndSet(entrypoint);
 
     while (!frontier.empty() && visited_order.size() < max_steps) {
         const std::uint32_t node = frontier.front();
         frontier.pop();
 
-        std::vector<std::uint32_t> neighbors;
         bool read_ok = false;
         for (std::size_t retry = 0; retry < max_retries; ++retry) {
             if (TryReadNeighbors(node, &neighbors)) {
                 read_ok = true;
                 break;
             }
+            occ_retries.Add();
         }
         if (!read_ok) {
+            occ_failures.Add();
             continue;
         }
 
@@ -63,7 +72,7 @@ std::vector<std::uint32_t> VersionedGraph::TraverseWithOcc(
             if (next >= neighbors_.size()) {
                 continue;
             }
-            if (dedup.insert(next).second) {
+            if (dedup->TestAndSet(next)) {
                 frontier.push(next);
             }
         }
@@ -0,0 +1,35 @@
+#ifndef ANN_BENCHMARKS_VECS_IO_H_
+#define ANN_BENCHMARKS_VECS_IO_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ann_bench {
+
+// Row-major `rows` x `dim` matrix.
+template <typename T>
+struct VecsMatrix {
+    std::size_t rows{0};
+    std::size_t dim{0};
+    std::vector<T> data;
+
+    const T* Row(const std::size_t row) const { return data.data() + row * dim; }
+};
+
+// TEXMEX formats (SIFT1M, GIST1M, ...): every record is an int32 dim followed
+// by `dim` values (float32 for .fvecs, uint8 for .bvecs, int32 for .ivecs).
+// `max_rows` = 0 reads the whole file. Throws std::runtime_error on I/O errors
+// or records whose dim differs from the first one.
+VecsMatrix<float> LoadFvecs(const std::string& path, std::size_t max_rows = 0);
+// Bytes are widened to float so both engines can consume SIFT1B-style bases.
+VecsMatrix<float> LoadBvecs(const std::string& path, std::size_t max_rows = 0);
+VecsMatrix<std::int32_t> LoadIvecs(const std::string& path, std::size_t max_rows = 0);
+
+// Picks LoadFvecs or LoadBvecs from the file extension.
+VecsMatrix<float> LoadVectors(const std::string& path, std::size_t max_rows = 0);
+
+}  // namespace ann_bench
+
+#endif  // ANN_BENCHMARKS_VECS_IO_H_
@@ -0,0 +1,507 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "async_graph_searcher.h"
+#include "distance.h"
+#include "dual_engine_index.h"
+#include "metrics.h"
+#include "vamana_builder.h"
+#include "vecs_io.h"
+
+namespace {
+
+using ann_bench::VecsMatrix;
+
+struct Options {
+    std::string base_path;
+    std::string query_path;
+    std::string gt_path;
+    std::string out_path;
+    std::size_t synthetic{20000};
+    std::size_t dim{64};
+    std::size_t queries{200};
+    std::size_t max_base{0};
+    std::size_t k{10};
+    std::vector<std::size_t> max_visit{500, 2000};
+    std::vector<std::size_t> batch_size{8};
+    std::vector<std::size_t> ef{16, 32, 64, 128};
+    std::vector<std::size_t> bits{4, 6};
+    std::vector<opengauss_demo::RotationKind> rotation{opengauss_demo::RotationKind::kOpq};
+    std::vector<std::size_t> rerank_k{16, 32, 64, 128};
+    std::vector<std::size_t> nprobe{4, 16, 64};
+    std::size_t nlist{0};
+    // Disk path reranks from this block file when set.
+    std::string block_file;
+    std::string io_backend{"auto"};
+    std::size_t queue_depth{32};
+    // Block cache in front of the block file; 0 MiB disables it.
+    std::size_t cache_mb{0};
+    std::size_t pin_lists{0};
+    // Concurrent disk-path queries; they share reads of common blocks.
+    std::size_t disk_threads{1};
+    bool run_graph{true};
+    bool run_dual{true};
+};
+
+struct Dataset {
+    VecsMatrix<float> base;
+    VecsMatrix<float> queries;
+    // `k` nearest base ids per query.
+    std::vector<std::vector<std::uint32_t>> truth;
+};
+
+struct SweepResult {
+    double recall{0.0};
+    double qps{0.0};
+    std::uint64_t p50_us{0};
+    std::uint64_t p95_us{0};
+    std::uint64_t p99_us{0};
+};
+
+std::vector<std::size_t> ParseList(const std::string& value) {
+    std::vector<std::size_t> values;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        values.push_back(static_cast<std::size_t>(std::stoul(item)));
+    }
+    return values;
+}
+
+std::vector<opengauss_demo::RotationKind> ParseRotations(const std::string& value) {
+    std::vector<opengauss_demo::RotationKind> kinds;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (item == "identity") {
+            kinds.push_back(opengauss_demo::RotationKind::kIdentity);
+        } else if (item == "opq") {
+            kinds.push_back(opengauss_demo::RotationKind::kOpq);
+        } else if (item == "hadamard") {
+            kinds.push_back(opengauss_demo::RotationKind::kHadamard);
+        } else {
+            throw std::invalid_argument("unknown rotation " + item);
+        }
+    }
+    return kinds;
+}
+
+void PrintUsage() {
+    std::cerr << "usage: ann_bench [--base F.fvecs|F.bvecs --query F.fvecs|F.bvecs [--gt F.ivecs]]\n"
+                 "                 [--synthetic N --dim D --queries Q] [--max-base N] [--k K]\n"
+                 "                 [--max-visit L] [--batch-size L] [--ef L] [--bits L] [--rerank-k L]\n"
+                 "                 [--rotation identity,opq,hadamard] [--nlist N] [--nprobe L]\n"
+                 "                 [--block-file F [--io-backend auto|pread|io_uring] [--queue-depth N]\n"
+                 "                  [--cache-mb N [--pin-lists N]]] [--disk-threads N]\n"
+                 "                 [--engines graph,dual] [--out results.csv]\n"
+                 "L is a comma-separated sweep list. Without --base a clustered synthetic set is used.\n";
+}
+
+Options ParseOptions(const int argc, char** argv) {
+    Options options;
+    for (int arg = 1; arg < argc; ++arg) {
+        const std::string flag = argv[arg];
+        if (flag == "--help" || flag == "-h") {
+            PrintUsage();
+            std::exit(0);
+        }
+        if (arg + 1 >= argc) {
+            throw std::invalid_argument("missing value for " + flag);
+        }
+        const std::string value = argv[++arg];
+        if (flag == "--base") {
+            options.base_path = value;
+        } else if (flag == "--query") {
+            options.query_path = value;
+        } else if (flag == "--gt") {
+            options.gt_path = value;
+        } else if (flag == "--out") {
+            options.out_path = value;
+        } else if (flag == "--synthetic") {
+            options.synthetic = std::stoul(value);
+        } else if (flag == "--dim") {
+            options.dim = std::stoul(value);
+        } else if (flag == "--queries") {
+            options.queries = std::stoul(value);
+        } else if (flag == "--max-base") {
+            options.max_base = std::stoul(value);
+        } else if (flag == "--k") {
+            options.k = std::stoul(value);
+        } else if (flag == "--max-visit") {
+            options.max_visit = ParseList(value);
+        } else if (flag == "--batch-size") {
+            options.batch_size = ParseList(value);
+        } else if (flag == "--ef") {
+            options.ef = ParseList(value);
+        } else if (flag == "--bits") {
+            options.bits = ParseList(value);
+        } else if (flag == "--rotation") {
+            options.rotation = ParseRotations(value);
+        } else if (flag == "--rerank-k") {
+            options.rerank_k = ParseList(value);
+        } else if (flag == "--nlist") {
+            options.nlist = std::stoul(value);
+        } else if (flag == "--nprobe") {
+            options.nprobe = ParseList(value);
+        } else if (flag == "--block-file") {
+            options.block_file = value;
+        } else if (flag == "--io-backend") {
+            options.io_backend = value;
+        } else if (flag == "--queue-depth") {
+            options.queue_depth = std::stoul(value);
+        } else if (flag == "--cache-mb") {
+            options.cache_mb = std::stoul(value);
+        } else if (flag == "--pin-lists") {
+            options.pin_lists = std::stoul(value);
+        } else if (flag == "--disk-threads") {
+            options.disk_threads = std::max<std::size_t>(1, std::stoul(value));
+        } else if (flag == "--engines") {
+            options.run_graph = value.find("graph") != std::string::npos;
+            options.run_dual = value.find("dual") != std::string::npos;
+        } else {
+            throw std::invalid_argument("unknown flag " + flag);
+        }
+    }
+    if (options.base_path.empty() != options.query_path.empty()) {
+        throw std::invalid_argument("--base and --query must be given together");
+    }
+    return options;
+}
+
+// Gaussian blobs: uniform random data has no neighborhood structure, which
+// makes every index look equally bad.
+VecsMatrix<float> ClusteredVectors(std::mt19937* rng, const std::size_t rows, const std::size_t dim, const std::vector<float>& centers) {
+    const std::size_t clusters = centers.size() / dim;
+    std::uniform_int_distribution<std::size_t> pick(0, clusters - 1);
+    std::normal_distribution<float> noise(0.0F, 0.1F);
+    VecsMatrix<float> matrix;
+    matrix.rows = rows;
+    matrix.dim = dim;
+    matrix.data.reserve(rows * dim);
+    for (std::size_t row = 0; row < rows; ++row) {
+        const float* center = centers.data() + pick(*rng) * dim;
+        for (std::size_t d = 0; d < dim; ++d) {
+            matrix.data.push_back(center[d] + noise(*rng));
+        }
+    }
+    return matrix;
+}
+
+std::vector<std::vector<std::uint32_t>> ExactTruth(const VecsMatrix<float>& base, const VecsMatrix<float>& queries, const std::size_t k) {
+    std::vector<std::vector<std::uint32_t>> truth(queries.rows);
+    std::vector<float> distances(base.rows);
+    std::vector<std::pair<float, std::uint32_t>> scored(base.rows);
+    const std::size_t keep = std::min(k, base.rows);
+    for (std::size_t q = 0; q < queries.rows; ++q) {
+        ann_common::DistanceBatch(
+            ann_common::Metric::kL2Sqr, queries.Row(q), base.data.data(), base.rows, base.dim, base.dim, distances.data());
+        for (std::size_t idx = 0; idx < base.rows; ++idx) {
+            scored[idx] = {distances[idx], static_cast<std::uint32_t>(idx)};
+        }
+        std::partial_sort(scored.begin(), scored.begin() + static_cast<long>(keep), scored.end());
+        for (std::size_t idx = 0; idx < keep; ++idx) {
+            truth[q].push_back(scored[idx].second);
+        }
+    }
+    return truth;
+}
+
+Dataset LoadDataset(const Options& options) {
+    Dataset dataset;
+    if (options.base_path.empty()) {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> center_dist(0.0F, 1.0F);
+        std::vector<float> centers(100 * options.dim);
+        for (float& value : centers) {
+            value = center_dist(rng);
+        }
+        dataset.base = ClusteredVectors(&rng, options.synthetic, options.dim, centers);
+        dataset.queries = ClusteredVectors(&rng, options.queries, options.dim, centers);
+    } else {
+        dataset.base = ann_bench::LoadVectors(options.base_path, options.max_base);
+        dataset.queries = ann_bench::LoadVectors(options.query_path, options.queries);
+        if (dataset.base.dim != dataset.queries.dim) {
+            throw std::runtime_error("base and query dims differ");
+        }
+    }
+
+    // A ground-truth file indexes the full base, so it is only usable untruncated.
+    if (!options.gt_path.empty() && options.max_base == 0) {
+        const auto gt = ann_bench::LoadIvecs(options.gt_path, dataset.queries.rows);
+        if (gt.rows < dataset.queries.rows || gt.dim < options.k) {
+            throw std::runtime_error("ground truth has fewer rows or neighbors than requested");
+        }
+        dataset.truth.resize(dataset.queries.rows);
+        for (std::size_t q = 0; q < dataset.queries.rows; ++q) {
+            dataset.truth[q].assign(gt.Row(q), gt.Row(q) + options.k);
+        }
+    } else {
+        dataset.truth = ExactTruth(dataset.base, dataset.queries, options.k);
+    }
+    return dataset;
+}
+
+std::uint64_t Percentile(std::vector<std::uint64_t> values, const double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[static_cast<std::size_t>(static_cast<double>(values.size() - 1) * p)];
+}
+
+// Runs every query once on `threads` threads that claim queries in order.
+template <typename SearchFn>
+SweepResult RunQueries(const Dataset& dataset, const std::size_t k, SearchFn&& search, const std::size_t threads = 1) {
+    std::vector<std::uint64_t> latency(dataset.queries.rows);
+    std::atomic<std::size_t> hits{0};
+    std::atomic<std::size_t> next{0};
+    auto worker = [&] {
+        for (std::size_t q = next.fetch_add(1); q < dataset.queries.rows; q = next.fetch_add(1)) {
+            const auto start = std::chrono::steady_clock::now();
+            const std::vector<std::uint32_t> ids = search(q);
+            latency[q] = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+                    .count());
+            const auto& truth = dataset.truth[q];
+            std::size_t found = 0;
+            for (const std::uint32_t id : ids) {
+                found += std::find(truth.begin(), truth.end(), id) != truth.end() ? 1 : 0;
+            }
+            hits += found;
+        }
+    };
+    const auto sweep_start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (std::size_t thread = 1; thread < threads; ++thread) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - sweep_start).count();
+
+    SweepResult result;
+    result.recall = static_cast<double>(hits.load()) / static_cast<double>(dataset.queries.rows * k);
+    result.qps = seconds > 0.0 ? static_cast<double>(dataset.queries.rows) / seconds : 0.0;
+    result.p50_us = Percentile(latency, 0.50);
+    result.p95_us = Percentile(latency, 0.95);
+    result.p99_us = Percentile(latency, 0.99);
+    return result;
+}
+
+void WriteRow(std::ostream& out, const std::string& engine, const std::string& params, const std::size_t k, const SweepResult& result) {
+    out << engine << "," << params << "," << k << "," << std::fixed << std::setprecision(4) << result.recall << ","
+        << std::setprecision(1) << result.qps << "," << result.p50_us << "," << result.p95_us << "," << result.p99_us
+        << std::endl;
+}
+
+void RunGraph(const Dataset& dataset, const Options& options, std::ostream& out) {
+    using knowhere_demo::Candidate;
+    using knowhere_demo::SearchParams;
+    using knowhere_demo::SearchRequest;
+
+    const auto build_start = std::chrono::steady_clock::now();
+    auto index = knowhere_demo::VamanaBuilder().Build(dataset.base.data.data(), dataset.base.rows, dataset.base.dim);
+    knowhere_demo::AsyncGraphSearcher searcher(std::move(index.graph));
+    searcher.BuildEntryPoints();
+    std::cerr << "graph: built in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count() << "s\n";
+
+    std::vector<SearchRequest> requests(dataset.queries.rows);
+    for (std::size_t q = 0; q < requests.size(); ++q) {
+        requests[q].query.assign(dataset.queries.Row(q), dataset.queries.Row(q) + dataset.queries.dim);
+        requests[q].top_k = options.k;
+    }
+    for (const std::size_t max_visit : options.max_visit) {
+        for (const std::size_t batch_size : options.batch_size) {
+            for (const std::size_t ef : options.ef) {
+                const SearchParams params{.max_visit = max_visit, .batch_size = batch_size, .ef = ef};
+                const SweepResult result = RunQueries(dataset, options.k, [&](const std::size_t q) {
+                    std::vector<std::uint32_t> ids;
+                    for (const Candidate& candidate : searcher.Search(requests[q], params)) {
+                        ids.push_back(candidate.id);
+                    }
+                    return ids;
+                });
+                WriteRow(
+                    out,
+                    "async_graph",
+                    "max_visit=" + std::to_string(max_visit) + ";batch_size=" + std::to_string(batch_size) +
+                        ";ef=" + std::to_string(ef),
+                    options.k,
+                    result);
+            }
+        }
+    }
+}
+
+// Disk-path counters are registered by the async scheduler when the index opens its block file.
+std::uint64_t DiskCounter(const std::string& name) {
+    return ann_common::EngineCounter(name, "opengauss", "").Value();
+}
+
+void RunDual(const Dataset& dataset, const Options& options, std::ostream& out) {
+    std::vector<std::vector<float>> base(dataset.base.rows);
+    for (std::size_t row = 0; row < base.size(); ++row) {
+        base[row].assign(dataset.base.Row(row), dataset.base.Row(row) + dataset.base.dim);
+    }
+    std::vector<std::vector<float>> queries(dataset.queries.rows);
+    for (std::size_t q = 0; q < queries.size(); ++q) {
+        queries[q].assign(dataset.queries.Row(q), dataset.queries.Row(q) + dataset.queries.dim);
+    }
+    auto to_ids = [](const std::vector<opengauss_demo::SearchHit>& hits) {
+        std::vector<std::uint32_t> ids;
+        ids.reserve(hits.size());
+        for (const auto& hit : hits) {
+            ids.push_back(hit.id);
+        }
+        return ids;
+    };
+
+    bool exact_done = false;
+    std::vector<std::pair<std::size_t, opengauss_demo::RotationKind>> configs;
+    for (const std::size_t bits : options.bits) {
+        for (const opengauss_demo::RotationKind rotation : options.rotation) {
+            configs.emplace_back(bits, rotation);
+        }
+    }
+    for (const auto& [bits, rotation] : configs) {
+        opengauss_demo::DualEngineIndex index(dataset.base.dim, static_cast<std::uint8_t>(bits), {.kind = rotation});
+        opengauss_demo::BlockStorageOptions storage{.path = options.block_file, .queue_depth = options.queue_depth};
+        if (options.io_backend == "pread") {
+            storage.backend = opengauss_demo::IoBackend::kPread;
+        } else if (options.io_backend == "io_uring") {
+            storage.backend = opengauss_demo::IoBackend::kIoUring;
+        }
+        const auto build_start = std::chrono::steady_clock::now();
+        index.Build(
+            base, /*block_size=*/64, {.nlist = options.nlist}, storage,
+            {.capacity_bytes = options.cache_mb << 20, .pinned_lists = options.pin_lists});
+        std::cerr << "dual: bits=" << bits << " rotation=" << opengauss_demo::RotationKindName(rotation) << " build "
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count()
+                  << "s, quantization mse=" << index.QuantizationMse() << "\n";
+        if (index.Storage() != nullptr) {
+            std::cerr << "dual: block file " << options.block_file << " ("
+                      << opengauss_demo::IoBackendName(index.Storage()->Backend())
+                      << (index.Storage()->DirectIo() ? ", O_DIRECT" : ", buffered") << ")\n";
+        }
+        if (index.Cache() != nullptr) {
+            std::cerr << "dual: block cache " << index.Cache()->CapacityBlocks() << " blocks, "
+                      << index.Cache()->Stats().pinned_blocks << " pinned\n";
+        }
+        if (!exact_done) {
+            WriteRow(out, "dual_memory", "exact", options.k, RunQueries(dataset, options.k, [&](const std::size_t q) {
+                         return to_ids(index.SearchMemory(queries[q], options.k));
+                     }));
+            // All queries in one SearchMemoryBatch call; each query's latency is the call's.
+            const auto batch_start = std::chrono::steady_clock::now();
+            const auto batch_hits = index.SearchMemoryBatch(queries, options.k);
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batch_start).count();
+            std::size_t hits = 0;
+            for (std::size_t q = 0; q < batch_hits.size(); ++q) {
+                for (const std::uint32_t id : to_ids(batch_hits[q])) {
+                    const auto& truth = dataset.truth[q];
+                    hits += std::find(truth.begin(), truth.end(), id) != truth.end() ? 1 : 0;
+                }
+            }
+            SweepResult batch;
+            batch.recall = static_cast<double>(hits) / static_cast<double>(queries.size() * options.k);
+            batch.qps = seconds > 0.0 ? static_cast<double>(queries.size()) / seconds : 0.0;
+            batch.p50_us = batch.p95_us = batch.p99_us = static_cast<std::uint64_t>(seconds * 1e6);
+            WriteRow(out, "dual_memory", "exact_batch=" + std::to_string(queries.size()), options.k, batch);
+            exact_done = true;
+        }
+        for (const std::size_t nprobe : options.nprobe) {
+            for (const std::size_t rerank_k : options.rerank_k) {
+                const auto cache_before =
+                    index.Cache() != nullptr ? index.Cache()->Stats() : opengauss_demo::BlockCacheStats{};
+                const std::uint64_t coalesced_before = DiskCounter("ann_disk_coalesced_extents_total");
+                const std::uint64_t late_before = DiskCounter("ann_disk_deadline_misses_total");
+                std::atomic<std::size_t> reranked{0};
+                const SweepResult result = RunQueries(
+                    dataset, options.k,
+                    [&](const std::size_t q) {
+                        opengauss_demo::DiskSearchStats stats;
+                        auto hits = index.SearchDisk(queries[q], options.k, rerank_k, nprobe, &stats);
+                        reranked.fetch_add(stats.reranked, std::memory_order_relaxed);
+                        return to_ids(hits);
+                    },
+                    options.disk_threads);
+                WriteRow(
+                    out,
+                    "dual_disk",
+                    "bits=" + std::to_string(bits) + ";rotation=" + opengauss_demo::RotationKindName(rotation) +
+                        ";nlist=" + std::to_string(index.ListCount()) +
+                        ";nprobe=" + std::to_string(nprobe) + ";rerank_k=" + std::to_string(rerank_k) +
+                        ";threads=" + std::to_string(options.disk_threads),
+                    options.k,
+                    result);
+                std::cerr << "dual: nprobe=" << nprobe << " rerank_k=" << rerank_k << " reranked/query="
+                          << static_cast<double>(reranked.load()) / static_cast<double>(queries.size()) << "\n";
+                if (index.Cache() != nullptr) {
+                    auto cache = index.Cache()->Stats();
+                    cache.hits -= cache_before.hits;
+                    cache.misses -= cache_before.misses;
+                    std::cerr << "dual: nprobe=" << nprobe << " rerank_k=" << rerank_k
+                              << " cache hit rate=" << cache.HitRate() << "\n";
+                }
+                if (index.Storage() != nullptr) {
+                    std::cerr << "dual: nprobe=" << nprobe << " rerank_k=" << rerank_k << " coalesced extents="
+                              << DiskCounter("ann_disk_coalesced_extents_total") - coalesced_before
+                              << " deadline misses=" << DiskCounter("ann_disk_deadline_misses_total") - late_before
+                              << "\n";
+                }
+            }
+        }
+    }
+}
+
+}  // namespace
+
+// Recall@k vs QPS and p50/p95/p99 latency for AsyncGraphSearcher and
+// DualEngineIndex over a parameter sweep, written as CSV.
+int main(int argc, char** argv) {
+    try {
+        const Options options = ParseOptions(argc, argv);
+        const Dataset dataset = LoadDataset(options);
+        std::cerr << "dataset: base=" << dataset.base.rows << " queries=" << dataset.queries.rows
+                  << " dim=" << dataset.base.dim << (options.base_path.empty() ? " (synthetic)" : "") << "\n";
+
+        std::ofstream file;
+        if (!options.out_path.empty()) {
+            file.open(options.out_path);
+            if (!file) {
+                throw std::runtime_error("cannot write " + options.out_path);
+            }
+        }
+        std::ostream& out = options.out_path.empty() ? std::cout : file;
+        out << "engine,params,k,recall,qps,p50_us,p95_us,p99_us" << std::endl;
+        if (options.run_graph) {
+            RunGraph(dataset, options, out);
+        }
+        if (options.run_dual) {
+            RunDual(dataset, options, out);
+        }
+    } catch (const std::exception& error) {
+        std::cerr << "ann_bench: " << error.what() << "\n";
+        PrintUsage();
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "vecs_io.h"
+
+#include <fstream>
+#include <stdexcept>
+
+namespace ann_bench {
+
+namespace {
+
+template <typename Stored, typename T>
+VecsMatrix<T> LoadVecs(const std::string& path, const std::size_t max_rows) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    VecsMatrix<T> matrix;
+    std::vector<Stored> record;
+    std::int32_t dim = 0;
+    while ((max_rows == 0 || matrix.rows < max_rows) && in.read(reinterpret_cast<char*>(&dim), sizeof(dim))) {
+        if (dim <= 0 || (matrix.rows > 0 && static_cast<std::size_t>(dim) != matrix.dim)) {
+            throw std::runtime_error("inconsistent vector dim in " + path);
+        }
+        matrix.dim = static_cast<std::size_t>(dim);
+        record.resize(matrix.dim);
+        if (!in.read(reinterpret_cast<char*>(record.data()), static_cast<std::streamsize>(matrix.dim * sizeof(Stored)))) {
+            throw std::runtime_error("truncated record in " + path);
+        }
+        matrix.data.insert(matrix.data.end(), record.begin(), record.end());
+        ++matrix.rows;
+    }
+    if (matrix.rows == 0) {
+        throw std::runtime_error("no vectors in " + path);
+    }
+    return matrix;
+}
+
+bool EndsWith(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}  // namespace
+
+VecsMatrix<float> LoadFvecs(const std::string& path, const std::size_t max_rows) {
+    return LoadVecs<float, float>(path, max_rows);
+}
+
+VecsMatrix<float> LoadBvecs(const std::string& path, const std::size_t max_rows) {
+    return LoadVecs<std::uint8_t, float>(path, max_rows);
+}
+
+VecsMatrix<std::int32_t> LoadIvecs(const std::string& path, const std::size_t max_rows) {
+    return LoadVecs<std::int32_t, std::int32_t>(path, max_rows);
+}
+
+VecsMatrix<float> LoadVectors(const std::string& path, const std::size_t max_rows) {
+    if (EndsWith(path, ".bvecs")) {
+        return LoadBvecs(path, max_rows);
+    }
+    if (EndsWith(path, ".fvecs")) {
+        return LoadFvecs(path, max_rows);
+    }
+    throw std::runtime_error("expected a .fvecs or .bvecs file: " + path);
+}
+
+}  // namespace ann_bench
@@ -0,0 +1,83 @@
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "distance.h"
+
+namespace {
+
+using ann_common::DistanceKernels;
+using ann_common::SimdLevel;
+
+constexpr std::size_t kRows = 4096;
+constexpr std::size_t kRepeats = 20;
+
+std::vector<float> RandomMatrix(std::mt19937* rng, std::size_t rows, std::size_t dim) {
+    std::normal_distribution<float> dist(0.0F, 1.0F);
+    std::vector<float> values(rows * dim);
+    for (float& value : values) {
+        value = dist(*rng);
+    }
+    return values;
+}
+
+template <typename Fn>
+double NanosPerDistance(Fn&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t rep = 0; rep < kRepeats; ++rep) {
+        fn();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double total_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    return total_ns / static_cast<double>(kRepeats * kRows);
+}
+
+}  // namespace
+
+int main() {
+    const std::vector<std::size_t> dims = {32, 96, 128, 256, 768, 960};
+    const std::vector<SimdLevel> levels = {SimdLevel::kScalar, SimdLevel::kAvx2, SimdLevel::kAvx512};
+
+    std::cout << "Detected SIMD level: " << ann_common::SimdLevelName(ann_common::DetectSimdLevel()) << "\n";
+    std::cout << "level,dim,l2sqr_ns,ip_ns,cosine_ns,l2sqr_batch_ns,ip_batch_ns\n";
+
+    std::mt19937 rng(7);
+    volatile float sink = 0.0F;
+    for (const std::size_t dim : dims) {
+        const std::vector<float> base = RandomMatrix(&rng, kRows, dim);
+        const std::vector<float> query = RandomMatrix(&rng, 1, dim);
+        std::vector<float> out(kRows);
+
+        for (const SimdLevel level : levels) {
+            const DistanceKernels* kernels = ann_common::KernelsFor(level);
+            if (kernels == nullptr) {
+                continue;
+            }
+
+            auto single = [&](ann_common::DistanceFn fn) {
+                return NanosPerDistance([&] {
+                    float acc = 0.0F;
+                    for (std::size_t row = 0; row < kRows; ++row) {
+                        acc += fn(query.data(), base.data() + row * dim, dim);
+                    }
+                    sink = sink + acc;
+                });
+            };
+            auto batch = [&](ann_common::DistanceBatchFn fn) {
+                return NanosPerDistance([&] {
+                    fn(query.data(), base.data(), kRows, dim, dim, out.data());
+                    sink = sink + out[kRows - 1];
+                });
+            };
+
+            std::cout << ann_common::SimdLevelName(level) << "," << dim << "," << std::fixed << std::setprecision(2)
+                      << single(kernels->l2_sqr) << "," << single(kernels->inner_product) << ","
+                      << single(kernels->cosine) << "," << batch(kernels->l2_sqr_batch) << ","
+                      << batch(kernels->inner_product_batch) << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+#ifndef ANN_COMMON_DISTANCE_H_
+#define ANN_COMMON_DISTANCE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ann_common {
+
+enum class Metric {
+    kL2Sqr,
+    kInnerProduct,
+    kCosine,
+};
+
+enum class SimdLevel {
+    kScalar,
+    kAvx2,
+    kAvx512,
+};
+
+using DistanceFn = float (*)(const float* lhs, const float* rhs, std::size_t dim);
+using DistanceBatchFn = void (*)(
+    const float* query,
+    const float* base,
+    std::size_t count,
+    std::size_t dim,
+    std::size_t stride,
+    float* out);
+using InnerProductBlockFn = void (*)(
+    const float* queries,
+    std::size_t query_count,
+    std::size_t query_stride,
+    const float* base,
+    std::size_t count,
+    std::size_t stride,
+    std::size_t dim,
+    float* out,
+    std::size_t out_stride);
+
+// One instruction-set flavour of every kernel. `inner_product` returns the raw
+// dot product; `cosine` returns 1 - cos(lhs, rhs).
+struct DistanceKernels {
+    SimdLevel level{SimdLevel::kScalar};
+    DistanceFn l2_sqr{nullptr};
+    DistanceFn inner_product{nullptr};
+    DistanceFn cosine{nullptr};
+    DistanceBatchFn l2_sqr_batch{nullptr};
+    DistanceBatchFn inner_product_batch{nullptr};
+    InnerProductBlockFn inner_product_block{nullptr};
+};
+
+// Highest level supported by both the compiler and the running CPU (CPUID).
+SimdLevel DetectSimdLevel();
+const char* SimdLevelName(SimdLevel level);
+
+// Kernel table picked once at startup for DetectSimdLevel().
+const DistanceKernels& ActiveKernels();
+// Table for a specific level, or nullptr when the CPU/compiler cannot run it.
+const DistanceKernels* KernelsFor(SimdLevel level);
+
+inline float L2Sqr(const float* lhs, const float* rhs, const std::size_t dim) {
+    return ActiveKernels().l2_sqr(lhs, rhs, dim);
+}
+
+inline float InnerProduct(const float* lhs, const float* rhs, const std::size_t dim) {
+    return ActiveKernels().inner_product(lhs, rhs, dim);
+}
+
+inline float CosineDistance(const float* lhs, const float* rhs, const std::size_t dim) {
+    return ActiveKernels().cosine(lhs, rhs, dim);
+}
+
+// Ranking distance for `metric`: smaller is closer for every metric
+// (squared L2, negated inner product, 1 - cosine). No sqrt is taken.
+float Distance(Metric metric, const float* lhs, const float* rhs, std::size_t dim);
+
+// One query against `count` rows starting at `base`, `stride` floats apart.
+void DistanceBatch(
+    Metric metric,
+    const float* query,
+    const float* base,
+    std::size_t count,
+    std::size_t dim,
+    std::size_t stride,
+    float* out);
+
+// All-pairs dot products of a query block against a row block, the X * Q^T
+// inner step of GEMM-style exact search: out[q * out_stride + row] =
+// <queries[q], base[row]>. Register-tiled, so each row load is shared by
+// several queries; callers size the blocks to stay cache resident.
+inline void InnerProductBlock(
+    const float* queries,
+    const std::size_t query_count,
+    const std::size_t query_stride,
+    const float* base,
+    const std::size_t count,
+    const std::size_t stride,
+    const std::size_t dim,
+    float* out,
+    const std::size_t out_stride) {
+    ActiveKernels().inner_product_block(queries, query_count, query_stride, base, count, stride, dim, out, out_stride);
+}
+
+// Rows a gather prefetches ahead of the one being scored by default.
+inline constexpr std::size_t kGatherPrefetchDistance = 2;
+
+// Hints every cache line of a `dim`-float row into L1. A gathered row is one
+// random access per line, which the hardware prefetchers do not follow.
+inline void PrefetchRow(const float* row, const std::size_t dim) {
+    constexpr std::size_t kFloatsPerLine = 64 / sizeof(float);
+    for (std::size_t offset = 0; offset < dim; offset += kFloatsPerLine) {
+        __builtin_prefetch(row + offset, /*rw=*/0, /*locality=*/3);
+    }
+}
+
+// One query against the rows `ids[0..count)` of a row-major matrix. While a
+// row is scored, row `ids[idx + prefetch_distance]` is prefetched (0 disables);
+// callers that can issue the first rows earlier should do so themselves.
+void DistanceGather(
+    Metric metric,
+    const float* query,
+    const float* base,
+    std::size_t stride,
+    const std::uint32_t* ids,
+    std::size_t count,
+    std::size_t dim,
+    float* out,
+    std::size_t prefetch_distance = kGatherPrefetchDistance);
+
+}  // namespace ann_common
+
+#endif  // ANN_COMMON_DISTANCE_H_
@@ -0,0 +1,28 @@
+#ifndef ANN_COMMON_KMEANS_H_
+#define ANN_COMMON_KMEANS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ann_common {
+
+// Lloyd's k-means on squared L2. `data` is `count` rows, `stride` floats apart.
+// Centroids start from `k` distinct random rows; a cluster that empties is
+// re-seeded from a random row. Returns row-major `k` x `dim` centroids
+// (fewer rows when count < k).
+std::vector<float> TrainKMeans(
+    const float* data,
+    std::size_t count,
+    std::size_t dim,
+    std::size_t stride,
+    std::size_t k,
+    std::size_t iterations,
+    std::uint32_t seed = 42);
+
+// Index of the centroid closest to `vec`.
+std::size_t NearestCentroid(const float* centroids, std::size_t k, std::size_t dim, const float* vec);
+
+}  // namespace ann_common
+
+#endif  // ANN_COMMON_KMEANS_H_
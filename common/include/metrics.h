@@ -0,0 +1,153 @@
+#ifndef ANN_COMMON_METRICS_H_
+#define ANN_COMMON_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ann_common {
+
+// Every metric is split into shards on separate cache lines; a thread always
+// records into the same shard, so concurrent recorders rarely share a line and
+// the hot path is a single relaxed atomic add.
+inline constexpr std::size_t kMetricShards = 16;
+
+inline std::size_t MetricShard() {
+    static std::atomic<std::size_t> next_shard{0};
+    thread_local const std::size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+inline std::uint64_t NanosSince(const std::chrono::steady_clock::time_point start) {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+class Counter {
+public:
+    void Add(const std::uint64_t delta = 1) {
+        shards_[MetricShard()].value.fetch_add(delta, std::memory_order_relaxed);
+    }
+    std::uint64_t Value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> value{0};
+    };
+    std::array<Shard, kMetricShards> shards_{};
+};
+
+// HDR-style log-linear histogram of nanosecond latencies: each power-of-two
+// range is split into 2^kSubBucketBits linear buckets, so a recorded value is
+// known to within 1/16 (6.25%). Values from 2^kMaxBits ns (~18 min) clamp.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr std::size_t kSubBuckets = std::size_t{1} << kSubBucketBits;
+    static constexpr int kMaxBits = 40;
+    static constexpr std::size_t kBucketCount = static_cast<std::size_t>(kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+    struct Snapshot {
+        std::vector<std::uint64_t> counts;
+        std::uint64_t count{0};
+        std::uint64_t sum_ns{0};
+
+        // Upper bound of the bucket holding the p-quantile (p in [0, 1]).
+        std::uint64_t ValueAtQuantile(double p) const;
+        // Samples strictly below `nanos`; exact when `nanos` is a power of two.
+        std::uint64_t CountBelow(std::uint64_t nanos) const;
+    };
+
+    LatencyHistogram();
+
+    void Record(const std::uint64_t nanos) {
+        Shard& shard = shards_[MetricShard()];
+        shard.counts[BucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum_ns.fetch_add(nanos, std::memory_order_relaxed);
+    }
+
+    Snapshot Snap() const;
+
+    static std::size_t BucketIndex(std::uint64_t nanos) {
+        constexpr std::uint64_t kMaxValue = (std::uint64_t{1} << kMaxBits) - 1;
+        nanos = nanos < kMaxValue ? nanos : kMaxValue;
+        if (nanos < kSubBuckets) {
+            return static_cast<std::size_t>(nanos);
+        }
+        const int msb = 63 - __builtin_clzll(nanos);
+        const int shift = msb - kSubBucketBits;
+        return static_cast<std::size_t>(msb - kSubBucketBits + 1) * kSubBuckets +
+               static_cast<std::size_t>((nanos >> shift) - kSubBuckets);
+    }
+    // Exclusive upper bound of bucket `index`.
+    static std::uint64_t BucketUpperBound(std::size_t index);
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<std::uint64_t>, kBucketCount> counts{};
+        std::atomic<std::uint64_t> sum_ns{0};
+    };
+    std::unique_ptr<Shard[]> shards_;
+};
+
+// Records the lifetime of the scope into `histogram`.
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram& histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() { histogram_.Record(NanosSince(start_)); }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Process-wide set of named series. Lookup takes a mutex and is meant to run
+// once per call site (cache the returned reference); recording never locks.
+class MetricsRegistry {
+public:
+    static MetricsRegistry& Global();
+
+    // `labels` is the Prometheus label body, e.g. engine="knowhere",stage="io".
+    // The first registration of a family sets its help text. References stay
+    // valid for the registry's lifetime.
+    Counter& GetCounter(const std::string& name, const std::string& labels, const std::string& help);
+    LatencyHistogram& GetHistogram(const std::string& name, const std::string& labels, const std::string& help);
+
+    // Prometheus text exposition format 0.0.4. Histograms are exported in
+    // seconds with power-of-two `le` buckets from ~1us to ~69s.
+    std::string DumpPrometheus() const;
+
+private:
+    struct Series {
+        std::string name;
+        std::string labels;
+        std::string help;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<LatencyHistogram> histogram;
+    };
+
+    Series* Find(const std::string& name, const std::string& labels);
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Series>> series_;
+};
+
+// Families shared by both engines:
+//   ann_search_stage_seconds{engine,stage}  per-stage latency histogram
+//   <name>{engine}                          event counters (*_total)
+LatencyHistogram& StageLatency(const std::string& engine, const std::string& stage);
+Counter& EngineCounter(const std::string& name, const std::string& engine, const std::string& help);
+
+}  // namespace ann_common
+
+#endif  // ANN_COMMON_METRICS_H_
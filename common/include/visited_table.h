@@ -0,0 +1,93 @@
+#ifndef ANN_COMMON_VISITED_TABLE_H_
+#define ANN_COMMON_VISITED_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ann_common {
+
+// Visited set for graph traversal, meant to be reused across queries.
+// Epoch mode keeps one 16-bit stamp per node and clears in O(1) by bumping the
+// current epoch. Bitset mode (picked automatically above kBitsetThreshold
+// nodes) keeps one bit per node and clears only the words the last traversal
+// touched.
+class VisitedTable {
+public:
+    enum class Mode {
+        kEpoch,
+        kBitset,
+    };
+
+    static constexpr std::size_t kBitsetThreshold = std::size_t{1} << 26;
+
+    VisitedTable() = default;
+
+    // Starts a new traversal over ids in [0, node_count). Allocates only when
+    // the table has to grow or switch mode.
+    void Reset(std::size_t node_count);
+    void Reset(std::size_t node_count, Mode mode);
+
+    // Marks `id` visited; returns true if it was not visited before.
+    bool TestAndSet(const std::uint32_t id) {
+        if (mode_ == Mode::kEpoch) {
+            if (epochs_[id] == epoch_) {
+                return false;
+            }
+            epochs_[id] = epoch_;
+            return true;
+        }
+        std::uint64_t& word = bits_[id >> 6];
+        const std::uint64_t mask = std::uint64_t{1} << (id & 63U);
+        if ((word & mask) != 0) {
+            return false;
+        }
+        if (word == 0) {
+            touched_words_.push_back(id >> 6);
+        }
+        word |= mask;
+        return true;
+    }
+
+    bool Contains(const std::uint32_t id) const {
+        if (mode_ == Mode::kEpoch) {
+            return epochs_[id] == epoch_;
+        }
+        return (bits_[id >> 6] >> (id & 63U) & 1U) != 0;
+    }
+
+    Mode GetMode() const { return mode_; }
+    std::size_t Capacity() const { return capacity_; }
+
+private:
+    Mode mode_{Mode::kEpoch};
+    std::size_t capacity_{0};
+    std::uint16_t epoch_{0};
+    std::vector<std::uint16_t> epochs_;
+    std::vector<std::uint64_t> bits_;
+    std::vector<std::uint32_t> touched_words_;
+};
+
+// Borrows a VisitedTable from a per-thread stack and resets it for
+// `node_count` nodes. Tables are returned on destruction and reused by the next
+// traversal on the same thread; nesting (e.g. a worker that runs another
+// search while waiting) gets its own table.
+class ScopedVisitedTable {
+public:
+    explicit ScopedVisitedTable(std::size_t node_count);
+    ~ScopedVisitedTable();
+
+    ScopedVisitedTable(const ScopedVisitedTable&) = delete;
+    ScopedVisitedTable& operator=(const ScopedVisitedTable&) = delete;
+
+    VisitedTable& operator*() const { return *table_; }
+    VisitedTable* operator->() const { return table_; }
+
+private:
+    VisitedTable* table_;
+};
+
+}  // namespace ann_common
+
+#endif  // ANN_COMMON_VISITED_TABLE_H_
@@ -0,0 +1,635 @@
+#include "distance.h"
+
+#include <cmath>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define ANN_COMMON_X86_DISPATCH 1
+#include <immintrin.h>
+#else
+#define ANN_COMMON_X86_DISPATCH 0
+#endif
+
+namespace ann_common {
+
+namespace {
+
+constexpr std::size_t kPrefetchRows = 2;
+
+float CosineFromParts(const float dot, const float lhs_norm_sqr, const float rhs_norm_sqr) {
+    const float denom = std::sqrt(lhs_norm_sqr * rhs_norm_sqr);
+    if (denom <= 0.0F) {
+        return 1.0F;
+    }
+    return 1.0F - dot / denom;
+}
+
+// ---- scalar fallback --------------------------------------------------------
+
+float L2SqrScalar(const float* lhs, const float* rhs, const std::size_t dim) {
+    float acc0 = 0.0F;
+    float acc1 = 0.0F;
+    float acc2 = 0.0F;
+    float acc3 = 0.0F;
+    std::size_t idx = 0;
+    for (; idx + 4 <= dim; idx += 4) {
+        const float d0 = lhs[idx] - rhs[idx];
+        const float d1 = lhs[idx + 1] - rhs[idx + 1];
+        const float d2 = lhs[idx + 2] - rhs[idx + 2];
+        const float d3 = lhs[idx + 3] - rhs[idx + 3];
+        acc0 += d0 * d0;
+        acc1 += d1 * d1;
+        acc2 += d2 * d2;
+        acc3 += d3 * d3;
+    }
+    for (; idx < dim; ++idx) {
+        const float diff = lhs[idx] - rhs[idx];
+        acc0 += diff * diff;
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+}
+
+float InnerProductScalar(const float* lhs, const float* rhs, const std::size_t dim) {
+    float acc0 = 0.0F;
+    float acc1 = 0.0F;
+    float acc2 = 0.0F;
+    float acc3 = 0.0F;
+    std::size_t idx = 0;
+    for (; idx + 4 <= dim; idx += 4) {
+        acc0 += lhs[idx] * rhs[idx];
+        acc1 += lhs[idx + 1] * rhs[idx + 1];
+        acc2 += lhs[idx + 2] * rhs[idx + 2];
+        acc3 += lhs[idx + 3] * rhs[idx + 3];
+    }
+    for (; idx < dim; ++idx) {
+        acc0 += lhs[idx] * rhs[idx];
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+}
+
+float CosineScalar(const float* lhs, const float* rhs, const std::size_t dim) {
+    float dot = 0.0F;
+    float lhs_norm = 0.0F;
+    float rhs_norm = 0.0F;
+    for (std::size_t idx = 0; idx < dim; ++idx) {
+        dot += lhs[idx] * rhs[idx];
+        lhs_norm += lhs[idx] * lhs[idx];
+        rhs_norm += rhs[idx] * rhs[idx];
+    }
+    return CosineFromParts(dot, lhs_norm, rhs_norm);
+}
+
+void L2SqrBatchScalar(
+    const float* query,
+    const float* base,
+    const std::size_t count,
+    const std::size_t dim,
+    const std::size_t stride,
+    float* out) {
+    for (std::size_t row = 0; row < count; ++row) {
+        out[row] = L2SqrScalar(query, base + row * stride, dim);
+    }
+}
+
+void InnerProductBatchScalar(
+    const float* query,
+    const float* base,
+    const std::size_t count,
+    const std::size_t dim,
+    const std::size_t stride,
+    float* out) {
+    for (std::size_t row = 0; row < count; ++row) {
+        out[row] = InnerProductScalar(query, base + row * stride, dim);
+    }
+}
+
+void InnerProductBlockScalar(
+    const float* queries,
+    const std::size_t query_count,
+    const std::size_t query_stride,
+    const float* base,
+    const std::size_t count,
+    const std::size_t stride,
+    const std::size_t dim,
+    float* out,
+    const std::size_t out_stride) {
+    for (std::size_t q = 0; q < query_count; ++q) {
+        for (std::size_t row = 0; row < count; ++row) {
+            out[q * out_stride + row] = InnerProductScalar(queries + q * query_stride, base + row * stride, dim);
+        }
+    }
+}
+
+#if ANN_COMMON_X86_DISPATCH
+
+// ---- AVX2 + FMA -------------------------------------------------------------
+
+__attribute__((target("avx2,fma"))) inline float HorizontalSum256(const __m256 value) {
+    const __m128 low = _mm256_castps256_ps128(value);
+    const __m128 high = _mm256_extractf128_ps(value, 1);
+    __m128 sum = _mm_add_ps(low, high);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma"))) inline float L2SqrAvx2(const float* lhs, const float* rhs, const std::size_t dim) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    std::size_t idx = 0;
+    for (; idx + 16 <= dim; idx += 16) {
+        const __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(lhs + idx), _mm256_loadu_ps(rhs + idx));
+        const __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(lhs + idx + 8), _mm256_loadu_ps(rhs + idx + 8));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+    }
+    for (; idx + 8 <= dim; idx += 8) {
+        const __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(lhs + idx), _mm256_loadu_ps(rhs + idx));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+    }
+    float sum = HorizontalSum256(_mm256_add_ps(acc0, acc1));
+    for (; idx < dim; ++idx) {
+        const float diff = lhs[idx] - rhs[idx];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma"))) inline float InnerProductAvx2(
+    const float* lhs,
+    const float* rhs,
+    const std::size_t dim) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    std::size_t idx = 0;
+    for (; idx + 16 <= dim; idx += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(lhs + idx), _mm256_loadu_ps(rhs + idx), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(lhs + idx + 8), _mm256_loadu_ps(rhs + idx + 8), acc1);
+    }
+    for (; idx + 8 <= dim; idx += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(lhs + idx), _mm256_loadu_ps(rhs + idx), acc0);
+    }
+    float sum = HorizontalSum256(_mm256_add_ps(acc0, acc1));
+    for (; idx < dim; ++idx) {
+        sum += lhs[idx] * rhs[idx];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma"))) float CosineAvx2(const float* lhs, const float* rhs, const std::size_t dim) {
+    __m256 dot = _mm256_setzero_ps();
+    __m256 lhs_norm = _mm256_setzero_ps();
+    __m256 rhs_norm = _mm256_setzero_ps();
+    std::size_t idx = 0;
+    for (; idx + 8 <= dim; idx += 8) {
+        const __m256 a = _mm256_loadu_ps(lhs + idx);
+        const __m256 b = _mm256_loadu_ps(rhs + idx);
+        dot = _mm256_fmadd_ps(a, b, dot);
+        lhs_norm = _mm256_fmadd_ps(a, a, lhs_norm);
+        rhs_norm = _mm256_fmadd_ps(b, b, rhs_norm);
+    }
+    float dot_sum = HorizontalSum256(dot);
+    float lhs_sum = HorizontalSum256(lhs_norm);
+    float rhs_sum = HorizontalSum256(rhs_norm);
+    for (; idx < dim; ++idx) {
+        dot_sum += lhs[idx] * rhs[idx];
+        lhs_sum += lhs[idx] * lhs[idx];
+        rhs_sum += rhs[idx] * rhs[idx];
+    }
+    return CosineFromParts(dot_sum, lhs_sum, rhs_sum);
+}
+
+__attribute__((target("avx2,fma"))) float L2SqrAvx2Fn(const float* lhs, const float* rhs, const std::size_t dim) {
+    return L2SqrAvx2(lhs, rhs, dim);
+}
+
+__attribute__((target("avx2,fma"))) float InnerProductAvx2Fn(const float* lhs, const float* rhs, const std::size_t dim) {
+    return InnerProductAvx2(lhs, rhs, dim);
+}
+
+__attribute__((target("avx2,fma"))) void L2SqrBatchAvx2(
+    const float* query,
+    const float* base,
+    const std::size_t count,
+    const std::size_t dim,
+    const std::size_t stride,
+    float* out) {
+    for (std::size_t row = 0; row < count; ++row) {
+        if (row + kPrefetchRows < count) {
+            _mm_prefetch(reinterpret_cast<const char*>(base + (row + kPrefetchRows) * stride), _MM_HINT_T0);
+        }
+        out[row] = L2SqrAvx2(query, base + row * stride, dim);
+    }
+}
+
+__attribute__((target("avx2,fma"))) void InnerProductBatchAvx2(
+    const float* query,
+    const float* base,
+    const std::size_t count,
+    const std::size_t dim,
+    const std::size_t stride,
+    float* out) {
+    for (std::size_t row = 0; row < count; ++row) {
+        if (row + kPrefetchRows < count) {
+            _mm_prefetch(reinterpret_cast<const char*>(base + (row + kPrefetchRows) * stride), _MM_HINT_T0);
+        }
+        out[row] = InnerProductAvx2(query, base + row * stride, dim);
+    }
+}
+
+// 4 queries x 2 rows per tile: each loaded row chunk feeds four FMAs and each
+// query chunk two, so the tile does 8 FMAs per 6 loads instead of 1 per 2.
+__attribute__((target("avx2,fma"))) void InnerProductBlockAvx2(
+    const float* queries,
+    const std::size_t query_count,
+    const std::size_t query_stride,
+    const float* base,
+    const std::size_t count,
+    const std::size_t stride,
+    const std::size_t dim,
+    float* out,
+    const std::size_t out_stride) {
+    std::size_t q = 0;
+    for (; q + 4 <= query_count; q += 4) {
+        const float* q0 = queries + q * query_stride;
+        const float* q1 = q0 + query_stride;
+        const float* q2 = q1 + query_stride;
+        const float* q3 = q2 + query_stride;
+        std::size_t row = 0;
+        for (; row + 2 <= count; row += 2) {
+            const float* r0 = base + row * stride;
+            const float* r1 = r0 + stride;
+            __m256 acc[8];
+            for (__m256& value : acc) {
+                value = _mm256_setzero_ps();
+            }
+            std::size_t idx = 0;
+            for (; idx + 8 <= dim; idx += 8) {
+                const __m256 x0 = _mm256_loadu_ps(r0 + idx);
+                const __m256 x1 = _mm256_loadu_ps(r1 + idx);
+                const __m256 y0 = _mm256_loadu_ps(q0 + idx);
+                const __m256 y1 = _mm256_loadu_ps(q1 + idx);
+                const __m256 y2 = _mm256_loadu_ps(q2 + idx);
+                const __m256 y3 = _mm256_loadu_ps(q3 + idx);
+                acc[0] = _mm256_fmadd_ps(y0, x0, acc[0]);
+                acc[1] = _mm256_fmadd_ps(y0, x1, acc[1]);
+                acc[2] = _mm256_fmadd_ps(y1, x0, acc[2]);
+                acc[3] = _mm256_fmadd_ps(y1, x1, acc[3]);
+                acc[4] = _mm256_fmadd_ps(y2, x0, acc[4]);
+                acc[5] = _mm256_fmadd_ps(y2, x1, acc[5]);
+                acc[6] = _mm256_fmadd_ps(y3, x0, acc[6]);
+                acc[7] = _mm256_fmadd_ps(y3, x1, acc[7]);
+            }
+            const float* tile_queries[4] = {q0, q1, q2, q3};
+            for (std::size_t lane = 0; lane < 4; ++lane) {
+                float dot0 = HorizontalSum256(acc[2 * lane]);
+                float dot1 = HorizontalSum256(acc[2 * lane + 1]);
+                for (std::size_t tail = idx; tail < dim; ++tail) {
+                    dot0 += tile_queries[lane][tail] * r0[tail];
+                    dot1 += tile_queries[lane][tail] * r1[tail];
+                }
+                out[(q + lane) * out_stride + row] = dot0;
+                out[(q + lane) * out_stride + row + 1] = dot1;
+            }
+        }
+        for (; row < count; ++row) {
+            const float* r0 = base + row * stride;
+            out[q * out_stride + row] = InnerProductAvx2(q0, r0, dim);
+            out[(q + 1) * out_stride + row] = InnerProductAvx2(q1, r0, dim);
+            out[(q + 2) * out_stride + row] = InnerProductAvx2(q2, r0, dim);
+            out[(q + 3) * out_stride + row] = InnerProductAvx2(q3, r0, dim);
+        }
+    }
+    for (; q < query_count; ++q) {
+        for (std::size_t row = 0; row < count; ++row) {
+            out[q * out_stride + row] = InnerProductAvx2(queries + q * query_stride, base + row * stride, dim);
+        }
+    }
+}
+
+// ---- AVX-512F ---------------------------------------------------------------
+
+__attribute__((target("avx512f"))) inline __mmask16 TailMask(const std::size_t remaining) {
+    return static_cast<__mmask16>((1U << remaining) - 1U);
+}
+
+// _mm512_reduce_add_ps extracts through _mm256_undefined_pd, which GCC 12
+// flags with -Wall as an uninitialized read. Extracting with a zero merge
+// source avoids that and compiles to the same vextractf64x4.
+__attribute__((target("avx512f"))) inline float HorizontalSum512(const __m512 value) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m512d wide = _mm512_castps_pd(value);
+    const __m256 low = _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(zero, 0xFF, wide, 0));
+    const __m256 high = _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(zero, 0xFF, wide, 1));
+    const __m256 half = _mm256_add_ps(low, high);
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(half), _mm256_extractf128_ps(half, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx512f"))) inline float L2SqrAvx512(const float* lhs, const float* rhs, const std::size_t dim) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    std::size_t idx = 0;
+    for (; idx + 32 <= dim; idx += 32) {
+        const __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(lhs + idx), _mm512_loadu_ps(rhs + idx));
+        const __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(lhs + idx + 16), _mm512_loadu_ps(rhs + idx + 16));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+    }
+    for (; idx + 16 <= dim; idx += 16) {
+        const __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(lhs + idx), _mm512_loadu_ps(rhs + idx));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+    }
+    if (idx < dim) {
+        const __mmask16 mask = TailMask(dim - idx);
+        const __m512 d0 = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, lhs + idx), _mm512_maskz_loadu_ps(mask, rhs + idx));
+        acc1 = _mm512_fmadd_ps(d0, d0, acc1);
+    }
+    return HorizontalSum512(_mm512_add_ps(acc0, acc1));
+}
+
+__attribute__((target("avx512f"))) inline float InnerProductAvx512(
+    const float* lhs,
+    const float* rhs,
+    const std::size_t dim) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    std::size_t idx = 0;
+    for (; idx + 32 <= dim; idx += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(lhs + idx), _mm512_loadu_ps(rhs + idx), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(lhs + idx + 16), _mm512_loadu_ps(rhs + idx + 16), acc1);
+    }
+    for (; idx + 16 <= dim; idx += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(lhs + idx), _mm512_loadu_ps(rhs + idx), acc0);
+    }
+    if (idx < dim) {
+        const __mmask16 mask = TailMask(dim - idx);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, lhs + idx), _mm512_maskz_loadu_ps(mask, rhs + idx), acc1);
+    }
+    return HorizontalSum512(_mm512_add_ps(acc0, acc1));
+}
+
+__attribute__((target("avx512f"))) float CosineAvx512(const float* lhs, const float* rhs, const std::size_t dim) {
+    __m512 dot = _mm512_setzero_ps();
+    __m512 lhs_norm = _mm512_setzero_ps();
+    __m512 rhs_norm = _mm512_setzero_ps();
+    for (std::size_t idx = 0; idx < dim; idx += 16) {
+        const __mmask16 mask = dim - idx >= 16 ? static_cast<__mmask16>(0xFFFF) : TailMask(dim - idx);
+        const __m512 a = _mm512_maskz_loadu_ps(mask, lhs + idx);
+        const __m512 b = _mm512_maskz_loadu_ps(mask, rhs + idx);
+        dot = _mm512_fmadd_ps(a, b, dot);
+        lhs_norm = _mm512_fmadd_ps(a, a, lhs_norm);
+        rhs_norm = _mm512_fmadd_ps(b, b, rhs_norm);
+    }
+    return CosineFromParts(
+        HorizontalSum512(dot), HorizontalSum512(lhs_norm), HorizontalSum512(rhs_norm));
+}
+
+__attribute__((target("avx512f"))) float L2SqrAvx512Fn(const float* lhs, const float* rhs, const std::size_t dim) {
+    return L2SqrAvx512(lhs, rhs, dim);
+}
+
+__attribute__((target("avx512f"))) float InnerProductAvx512Fn(const float* lhs, const float* rhs, const std::size_t dim) {
+    return InnerProductAvx512(lhs, rhs, dim);
+}
+
+__attribute__((target("avx512f"))) void L2SqrBatchAvx512(
+    const float* query,
+    const float* base,
+    const std::size_t count,
+    const std::size_t dim,
+    const std::size_t stride,
+    float* out) {
+    for (std::size_t row = 0; row < count; ++row) {
+        if (row + kPrefetchRows < count) {
+            _mm_prefetch(reinterpret_cast<const char*>(base + (row + kPrefetchRows) * stride), _MM_HINT_T0);
+        }
+        out[row] = L2SqrAvx512(query, base + row * stride, dim);
+    }
+}
+
+__attribute__((target("avx512f"))) void InnerProductBatchAvx512(
+    const float* query,
+    const float* base,
+    const std::size_t count,
+    const std::size_t dim,
+    const std::size_t stride,
+    float* out) {
+    for (std::size_t row = 0; row < count; ++row) {
+        if (row + kPrefetchRows < count) {
+            _mm_prefetch(reinterpret_cast<const char*>(base + (row + kPrefetchRows) * stride), _MM_HINT_T0);
+        }
+        out[row] = InnerProductAvx512(query, base + row * stride, dim);
+    }
+}
+
+__attribute__((target("avx512f"))) void InnerProductBlockAvx512(
+    const float* queries,
+    const std::size_t query_count,
+    const std::size_t query_stride,
+    const float* base,
+    const std::size_t count,
+    const std::size_t stride,
+    const std::size_t dim,
+    float* out,
+    const std::size_t out_stride) {
+    std::size_t q = 0;
+    for (; q + 4 <= query_count; q += 4) {
+        const float* q0 = queries + q * query_stride;
+        const float* q1 = q0 + query_stride;
+        const float* q2 = q1 + query_stride;
+        const float* q3 = q2 + query_stride;
+        std::size_t row = 0;
+        for (; row + 2 <= count; row += 2) {
+            const float* r0 = base + row * stride;
+            const float* r1 = r0 + stride;
+            __m512 acc[8];
+            for (__m512& value : acc) {
+                value = _mm512_setzero_ps();
+            }
+            for (std::size_t idx = 0; idx < dim; idx += 16) {
+                const __mmask16 mask = dim - idx >= 16 ? static_cast<__mmask16>(0xFFFF) : TailMask(dim - idx);
+                const __m512 x0 = _mm512_maskz_loadu_ps(mask, r0 + idx);
+                const __m512 x1 = _mm512_maskz_loadu_ps(mask, r1 + idx);
+                const __m512 y0 = _mm512_maskz_loadu_ps(mask, q0 + idx);
+                const __m512 y1 = _mm512_maskz_loadu_ps(mask, q1 + idx);
+                const __m512 y2 = _mm512_maskz_loadu_ps(mask, q2 + idx);
+                const __m512 y3 = _mm512_maskz_loadu_ps(mask, q3 + idx);
+                acc[0] = _mm512_fmadd_ps(y0, x0, acc[0]);
+                acc[1] = _mm512_fmadd_ps(y0, x1, acc[1]);
+                acc[2] = _mm512_fmadd_ps(y1, x0, acc[2]);
+                acc[3] = _mm512_fmadd_ps(y1, x1, acc[3]);
+                acc[4] = _mm512_fmadd_ps(y2, x0, acc[4]);
+                acc[5] = _mm512_fmadd_ps(y2, x1, acc[5]);
+                acc[6] = _mm512_fmadd_ps(y3, x0, acc[6]);
+                acc[7] = _mm512_fmadd_ps(y3, x1, acc[7]);
+            }
+            for (std::size_t lane = 0; lane < 4; ++lane) {
+                out[(q + lane) * out_stride + row] = HorizontalSum512(acc[2 * lane]);
+                out[(q + lane) * out_stride + row + 1] = HorizontalSum512(acc[2 * lane + 1]);
+            }
+        }
+        for (; row < count; ++row) {
+            const float* r0 = base + row * stride;
+            out[q * out_stride + row] = InnerProductAvx512(q0, r0, dim);
+            out[(q + 1) * out_stride + row] = InnerProductAvx512(q1, r0, dim);
+            out[(q + 2) * out_stride + row] = InnerProductAvx512(q2, r0, dim);
+            out[(q + 3) * out_stride + row] = InnerProductAvx512(q3, r0, dim);
+        }
+    }
+    for (; q < query_count; ++q) {
+        for (std::size_t row = 0; row < count; ++row) {
+            out[q * out_stride + row] = InnerProductAvx512(queries + q * query_stride, base + row * stride, dim);
+        }
+    }
+}
+
+#endif  // ANN_COMMON_X86_DISPATCH
+
+constexpr DistanceKernels kScalarKernels{
+    SimdLevel::kScalar,
+    L2SqrScalar,
+    InnerProductScalar,
+    CosineScalar,
+    L2SqrBatchScalar,
+    InnerProductBatchScalar,
+    InnerProductBlockScalar};
+
+#if ANN_COMMON_X86_DISPATCH
+constexpr DistanceKernels kAvx2Kernels{
+    SimdLevel::kAvx2,
+    L2SqrAvx2Fn,
+    InnerProductAvx2Fn,
+    CosineAvx2,
+    L2SqrBatchAvx2,
+    InnerProductBatchAvx2,
+    InnerProductBlockAvx2};
+constexpr DistanceKernels kAvx512Kernels{
+    SimdLevel::kAvx512,
+    L2SqrAvx512Fn,
+    InnerProductAvx512Fn,
+    CosineAvx512,
+    L2SqrBatchAvx512,
+    InnerProductBatchAvx512,
+    InnerProductBlockAvx512};
+#endif
+
+}  // namespace
+
+SimdLevel DetectSimdLevel() {
+#if ANN_COMMON_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::kAvx512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SimdLevel::kAvx2;
+    }
+#endif
+    return SimdLevel::kScalar;
+}
+
+const char* SimdLevelName(const SimdLevel level) {
+    switch (level) {
+        case SimdLevel::kAvx512:
+            return "avx512";
+        case SimdLevel::kAvx2:
+            return "avx2";
+        case SimdLevel::kScalar:
+            break;
+    }
+    return "scalar";
+}
+
+const DistanceKernels* KernelsFor(const SimdLevel level) {
+    const SimdLevel supported = DetectSimdLevel();
+    if (static_cast<int>(level) > static_cast<int>(supported)) {
+        return nullptr;
+    }
+    switch (level) {
+#if ANN_COMMON_X86_DISPATCH
+        case SimdLevel::kAvx512:
+            return &kAvx512Kernels;
+        case SimdLevel::kAvx2:
+            return &kAvx2Kernels;
+#endif
+        default:
+            return &kScalarKernels;
+    }
+}
+
+const DistanceKernels& ActiveKernels() {
+    static const DistanceKernels& kernels = *KernelsFor(DetectSimdLevel());
+    return kernels;
+}
+
+float Distance(const Metric metric, const float* lhs, const float* rhs, const std::size_t dim) {
+    const DistanceKernels& kernels = ActiveKernels();
+    switch (metric) {
+        case Metric::kInnerProduct:
+            return -kernels.inner_product(lhs, rhs, dim);
+        case Metric::kCosine:
+            return kernels.cosine(lhs, rhs, dim);
+        case Metric::kL2Sqr:
+            break;
+    }
+    return kernels.l2_sqr(lhs, rhs, dim);
+}
+
+void DistanceBatch(
+    const Metric metric,
+    const float* query,
+    const float* base,
+    const std::size_t count,
+    const std::size_t dim,
+    const std::size_t stride,
+    float* out) {
+    const DistanceKernels& kernels = ActiveKernels();
+    switch (metric) {
+        case Metric::kL2Sqr:
+            kernels.l2_sqr_batch(query, base, count, dim, stride, out);
+            return;
+        case Metric::kInnerProduct:
+            kernels.inner_product_batch(query, base, count, dim, stride, out);
+            for (std::size_t row = 0; row < count; ++row) {
+                out[row] = -out[row];
+            }
+            return;
+        case Metric::kCosine:
+            for (std::size_t row = 0; row < count; ++row) {
+                out[row] = kernels.cosine(query, base + row * stride, dim);
+            }
+            return;
+    }
+}
+
+void DistanceGather(
+    const Metric metric,
+    const float* query,
+    const float* base,
+    const std::size_t stride,
+    const std::uint32_t* ids,
+    const std::size_t count,
+    const std::size_t dim,
+    float* out,
+    const std::size_t prefetch_distance) {
+    const DistanceKernels& kernels = ActiveKernels();
+    DistanceFn kernel = kernels.l2_sqr;
+    float sign = 1.0F;
+    if (metric == Metric::kInnerProduct) {
+        kernel = kernels.inner_product;
+        sign = -1.0F;
+    } else if (metric == Metric::kCosine) {
+        kernel = kernels.cosine;
+    }
+
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        if (prefetch_distance > 0 && idx + prefetch_distance < count) {
+            PrefetchRow(base + static_cast<std::size_t>(ids[idx + prefetch_distance]) * stride, dim);
+        }
+        out[idx] = sign * kernel(query, base + static_cast<std::size_t>(ids[idx]) * stride, dim);
+    }
+}
+
+}  // namespace ann_common
@@ -0,0 +1,80 @@
+#include "kmeans.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+#include "distance.h"
+
+namespace ann_common {
+
+std::vector<float> TrainKMeans(
+    const float* data,
+    const std::size_t count,
+    const std::size_t dim,
+    const std::size_t stride,
+    std::size_t k,
+    const std::size_t iterations,
+    const std::uint32_t seed) {
+    k = std::min(k, count);
+    std::vector<float> centroids(k * dim);
+    if (k == 0 || dim == 0) {
+        return centroids;
+    }
+
+    std::mt19937 rng(seed);
+    std::vector<std::size_t> rows(count);
+    std::iota(rows.begin(), rows.end(), 0);
+    for (std::size_t c = 0; c < k; ++c) {
+        std::swap(rows[c], rows[c + rng() % (count - c)]);
+        std::copy(data + rows[c] * stride, data + rows[c] * stride + dim, centroids.begin() + c * dim);
+    }
+
+    std::uniform_int_distribution<std::size_t> row_dist(0, count - 1);
+    std::vector<float> distances(k);
+    std::vector<double> sums(k * dim);
+    std::vector<std::size_t> sizes(k);
+    for (std::size_t iter = 0; iter < iterations; ++iter) {
+        std::fill(sums.begin(), sums.end(), 0.0);
+        std::fill(sizes.begin(), sizes.end(), 0);
+        for (std::size_t row = 0; row < count; ++row) {
+            const float* vec = data + row * stride;
+            DistanceBatch(Metric::kL2Sqr, vec, centroids.data(), k, dim, dim, distances.data());
+            const auto best = static_cast<std::size_t>(
+                std::min_element(distances.begin(), distances.end()) - distances.begin());
+            ++sizes[best];
+            double* sum = sums.data() + best * dim;
+            for (std::size_t d = 0; d < dim; ++d) {
+                sum[d] += vec[d];
+            }
+        }
+        for (std::size_t c = 0; c < k; ++c) {
+            float* centroid = centroids.data() + c * dim;
+            if (sizes[c] == 0) {
+                const float* vec = data + row_dist(rng) * stride;
+                std::copy(vec, vec + dim, centroid);
+                continue;
+            }
+            const double inv = 1.0 / static_cast<double>(sizes[c]);
+            for (std::size_t d = 0; d < dim; ++d) {
+                centroid[d] = static_cast<float>(sums[c * dim + d] * inv);
+            }
+        }
+    }
+    return centroids;
+}
+
+std::size_t NearestCentroid(const float* centroids, const std::size_t k, const std::size_t dim, const float* vec) {
+    std::size_t best = 0;
+    float best_distance = 0.0F;
+    for (std::size_t c = 0; c < k; ++c) {
+        const float distance = L2Sqr(vec, centroids + c * dim, dim);
+        if (c == 0 || distance < best_distance) {
+            best = c;
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+}  // namespace ann_common
@@ -0,0 +1,178 @@
+#include "metrics.h"
+
+#include <cstdio>
+#include <sstream>
+
+namespace ann_common {
+
+namespace {
+
+// Exported `le` bounds are 2^kFirstLeBits .. 2^kLastLeBits ns: bucket edges of
+// the HDR layout, so cumulative counts are exact.
+constexpr int kFirstLeBits = 10;
+constexpr int kLastLeBits = 36;
+
+std::string FormatSeconds(const double seconds) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", seconds);
+    return buffer;
+}
+
+std::string WithLabels(const std::string& labels, const std::string& extra) {
+    if (labels.empty()) {
+        return "{" + extra + "}";
+    }
+    return "{" + labels + "," + extra + "}";
+}
+
+}  // namespace
+
+std::uint64_t Counter::Value() const {
+    std::uint64_t total = 0;
+    for (const Shard& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+LatencyHistogram::LatencyHistogram() : shards_(std::make_unique<Shard[]>(kMetricShards)) {}
+
+std::uint64_t LatencyHistogram::BucketUpperBound(const std::size_t index) {
+    const std::size_t group = index / kSubBuckets;
+    const std::uint64_t sub = index % kSubBuckets;
+    if (group == 0) {
+        return sub + 1;
+    }
+    const int shift = static_cast<int>(group) - 1;
+    return (kSubBuckets + sub + 1) << shift;
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::Snap() const {
+    Snapshot snapshot;
+    snapshot.counts.assign(kBucketCount, 0);
+    for (std::size_t shard_idx = 0; shard_idx < kMetricShards; ++shard_idx) {
+        const Shard& shard = shards_[shard_idx];
+        for (std::size_t bucket = 0; bucket < kBucketCount; ++bucket) {
+            snapshot.counts[bucket] += shard.counts[bucket].load(std::memory_order_relaxed);
+        }
+        snapshot.sum_ns += shard.sum_ns.load(std::memory_order_relaxed);
+    }
+    for (const std::uint64_t count : snapshot.counts) {
+        snapshot.count += count;
+    }
+    return snapshot;
+}
+
+std::uint64_t LatencyHistogram::Snapshot::ValueAtQuantile(const double p) const {
+    if (count == 0) {
+        return 0;
+    }
+    const auto rank = static_cast<std::uint64_t>(p * static_cast<double>(count - 1)) + 1;
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < counts.size(); ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return BucketUpperBound(bucket);
+        }
+    }
+    return BucketUpperBound(counts.size() - 1);
+}
+
+std::uint64_t LatencyHistogram::Snapshot::CountBelow(const std::uint64_t nanos) const {
+    std::uint64_t below = 0;
+    for (std::size_t bucket = 0; bucket < counts.size() && BucketUpperBound(bucket) <= nanos; ++bucket) {
+        below += counts[bucket];
+    }
+    return below;
+}
+
+MetricsRegistry& MetricsRegistry::Global() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Series* MetricsRegistry::Find(const std::string& name, const std::string& labels) {
+    for (const auto& series : series_) {
+        if (series->name == name && series->labels == labels) {
+            return series.get();
+        }
+    }
+    return nullptr;
+}
+
+Counter& MetricsRegistry::GetCounter(const std::string& name, const std::string& labels, const std::string& help) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    Series* series = Find(name, labels);
+    if (series == nullptr) {
+        series_.push_back(std::make_unique<Series>(Series{name, labels, help, std::make_unique<Counter>(), nullptr}));
+        series = series_.back().get();
+    }
+    return *series->counter;
+}
+
+LatencyHistogram& MetricsRegistry::GetHistogram(
+    const std::string& name,
+    const std::string& labels,
+    const std::string& help) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    Series* series = Find(name, labels);
+    if (series == nullptr) {
+        series_.push_back(
+            std::make_unique<Series>(Series{name, labels, help, nullptr, std::make_unique<LatencyHistogram>()}));
+        series = series_.back().get();
+    }
+    return *series->histogram;
+}
+
+std::string MetricsRegistry::DumpPrometheus() const {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream out;
+    std::vector<bool> done(series_.size(), false);
+    for (std::size_t first = 0; first < series_.size(); ++first) {
+        if (done[first]) {
+            continue;
+        }
+        // Families are written contiguously, in first-registration order.
+        const Series& family = *series_[first];
+        const bool is_histogram = family.histogram != nullptr;
+        out << "# HELP " << family.name << " " << family.help << "\n";
+        out << "# TYPE " << family.name << " " << (is_histogram ? "histogram" : "counter") << "\n";
+        for (std::size_t idx = first; idx < series_.size(); ++idx) {
+            const Series& series = *series_[idx];
+            if (done[idx] || series.name != family.name) {
+                continue;
+            }
+            done[idx] = true;
+            const std::string labels = series.labels.empty() ? "" : "{" + series.labels + "}";
+            if (!is_histogram) {
+                out << series.name << labels << " " << series.counter->Value() << "\n";
+                continue;
+            }
+            const LatencyHistogram::Snapshot snapshot = series.histogram->Snap();
+            for (int bits = kFirstLeBits; bits <= kLastLeBits; ++bits) {
+                const std::uint64_t bound = std::uint64_t{1} << bits;
+                out << series.name << "_bucket"
+                    << WithLabels(series.labels, "le=\"" + FormatSeconds(static_cast<double>(bound) * 1e-9) + "\"")
+                    << " " << snapshot.CountBelow(bound) << "\n";
+            }
+            out << series.name << "_bucket" << WithLabels(series.labels, "le=\"+Inf\"") << " " << snapshot.count << "\n";
+            out << series.name << "_sum" << labels << " " << FormatSeconds(static_cast<double>(snapshot.sum_ns) * 1e-9)
+                << "\n";
+            out << series.name << "_count" << labels << " " << snapshot.count << "\n";
+        }
+    }
+    return out.str();
+}
+
+LatencyHistogram& StageLatency(const std::string& engine, const std::string& stage) {
+    return MetricsRegistry::Global().GetHistogram(
+        "ann_search_stage_seconds",
+        "engine=\"" + engine + "\",stage=\"" + stage + "\"",
+        "Latency of one search stage step.");
+}
+
+Counter& EngineCounter(const std::string& name, const std::string& engine, const std::string& help) {
+    return MetricsRegistry::Global().GetCounter(name, "engine=\"" + engine + "\"", help);
+}
+
+}  // namespace ann_common
@@ -0,0 +1,75 @@
+#include "visited_table.h"
+
+#include <algorithm>
+
+namespace ann_common {
+
+namespace {
+
+struct TableStack {
+    std::vector<std::unique_ptr<VisitedTable>> tables;
+    std::size_t depth{0};
+};
+
+thread_local TableStack tls_tables;
+
+}  // namespace
+
+void VisitedTable::Reset(const std::size_t node_count) {
+    Reset(node_count, node_count > kBitsetThreshold ? Mode::kBitset : Mode::kEpoch);
+}
+
+void VisitedTable::Reset(const std::size_t node_count, const Mode mode) {
+    if (mode != mode_) {
+        mode_ = mode;
+        capacity_ = 0;
+        epochs_ = {};
+        bits_ = {};
+        touched_words_.clear();
+    }
+
+    if (mode_ == Mode::kEpoch) {
+        if (node_count > capacity_) {
+            epochs_.assign(node_count, 0);
+            capacity_ = node_count;
+            epoch_ = 0;
+        }
+        if (++epoch_ == 0) {
+            // Wrapped around: stale stamps could alias the new epoch.
+            std::fill(epochs_.begin(), epochs_.end(), 0);
+            epoch_ = 1;
+        }
+        return;
+    }
+
+    const std::size_t words = (node_count + 63) / 64;
+    if (node_count > capacity_) {
+        bits_.assign(words, 0);
+        capacity_ = words * 64;
+        touched_words_.clear();
+        return;
+    }
+    if (touched_words_.size() > bits_.size() / 8) {
+        std::fill(bits_.begin(), bits_.end(), 0);
+    } else {
+        for (const std::uint32_t word : touched_words_) {
+            bits_[word] = 0;
+        }
+    }
+    touched_words_.clear();
+}
+
+ScopedVisitedTable::ScopedVisitedTable(const std::size_t node_count) {
+    TableStack& stack = tls_tables;
+    if (stack.depth == stack.tables.size()) {
+        stack.tables.push_back(std::make_unique<VisitedTable>());
+    }
+    table_ = stack.tables[stack.depth++].get();
+    table_->Reset(node_count);
+}
+
+ScopedVisitedTable::~ScopedVisitedTable() {
+    --tls_tables.depth;
+}
+
+}  // namespace ann_common